@@ -0,0 +1,426 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "audio_engine.hpp"
+#include "audio_sink.hpp"
+#include "spsc_ring.hpp"
+#include "tempo_map.hpp"
+#include "beat_index.hpp"
+#include "midi_export.hpp"
+#include "gp_file.hpp"
+
+// the most strings a track can have, voices are numbered track*maxStrings + string
+static const int maxStrings = 7;
+// how many frames the synth renders before handing them to the sink
+static const int blockFrames = 1024;
+
+// walks through the song measure by measure and sends its events to the synth in order
+// events that lie ahead, like the ends of notes and their bends, wait in a heap until their measure is reached
+class EventScheduler {
+	public:
+		EventScheduler(GPFile &song, const TempoMap &tempoMap, int sampleRate, SpscRing<AudioEvent> &ring, std::atomic<bool> &stopped)
+			: song(song), tempoMap(tempoMap), sampleRate(sampleRate), ring(ring), stopped(stopped) { }
+
+		void run() {
+			this->sounding.assign(this->song.trackCount * maxStrings, SoundingNote{ false, 0 });
+
+			for (int trackIndex = 0; trackIndex < this->song.trackCount; trackIndex++) {
+				const TrackHeader &track = this->song.trackHeaders[trackIndex];
+				int port = std::max(std::min(track.midiPort, 4), 1) - 1;
+				int channel = std::max(std::min(track.midiChannel, 16), 1) - 1;
+				const MidiChannel &settings = this->song.midiChannels[port][channel];
+
+				add(make_event(0, audio_volume, trackIndex, 0, volumeValue(settings.volume)));
+				add(make_event(0, audio_balance, trackIndex, 0, balanceValue(settings.balance)));
+			}
+
+			for (int measureIndex = 0; measureIndex < this->song.measureCount && !this->stopped; measureIndex++) {
+				for (int trackIndex = 0; trackIndex < this->song.trackCount; trackIndex++) {
+					schedule_measure(measureIndex, trackIndex);
+				}
+
+				// the notes that ended within the measure can't be tied on to anymore
+				long long measureEnd = frame_at(this->tempoMap.measure_tick(measureIndex+1));
+				release_notes(measureEnd);
+				send_until(measureEnd);
+			}
+
+			release_notes(std::numeric_limits<long long>::max());
+			long long songEnd = frame_at(this->tempoMap.measure_tick(this->song.measureCount));
+			send_until(std::numeric_limits<long long>::max());
+			send(make_event(std::max(songEnd, this->lastFrame), audio_end, 0, 0, 0));
+		}
+
+	private:
+		struct QueuedEvent {
+			AudioEvent event;
+			long long order;	// keeps events at the same frame in the order they were added
+
+			bool operator>(const QueuedEvent &other) const {
+				if (this->event.frame != other.event.frame) {
+					return this->event.frame > other.event.frame;
+				}
+				return this->order > other.order;
+			}
+		};
+
+		struct SoundingNote {
+			bool active;
+			long long endFrame;
+		};
+
+		GPFile &song;
+		const TempoMap &tempoMap;
+		int sampleRate;
+		SpscRing<AudioEvent> &ring;
+		std::atomic<bool> &stopped;
+
+		std::priority_queue<QueuedEvent, std::vector<QueuedEvent>, std::greater<QueuedEvent>> pending;
+		long long nextOrder = 0;
+		long long lastFrame = 0;
+		std::vector<SoundingNote> sounding;
+
+		static float volumeValue(int value) {
+			return getChannelValue(value) / 127.0f;
+		}
+		static float balanceValue(int value) {
+			return std::max((getChannelValue(value) - 64) / 63.0f, -1.0f);
+		}
+
+		static AudioEvent make_event(long long frame, AudioEventType type, int track, int string, float value, int pitch = 0) {
+			return AudioEvent{ frame, (unsigned char)type, (unsigned char)track, (unsigned char)string, (unsigned char)pitch, value };
+		}
+
+		long long frame_at(long long tick) const {
+			return std::llround(this->tempoMap.tick_to_seconds(tick) * this->sampleRate);
+		}
+
+		void add(const AudioEvent &event) {
+			this->pending.push(QueuedEvent{ event, this->nextOrder++ });
+		}
+
+		// waits for room in the ring, unless the synth has given up
+		void send(const AudioEvent &event) {
+			while (!this->ring.push(event)) {
+				if (this->stopped) {
+					return;
+				}
+				std::this_thread::yield();
+			}
+			this->lastFrame = event.frame;
+		}
+
+		void send_until(long long frame) {
+			while (!this->pending.empty() && this->pending.top().event.frame < frame && !this->stopped) {
+				send(this->pending.top().event);
+				this->pending.pop();
+			}
+		}
+
+		// lets go of the notes that ended before the frame, on every track or only on the given one
+		void release_notes(long long beforeFrame, int trackIndex = -1) {
+			size_t firstVoice = trackIndex < 0 ? 0 : trackIndex * maxStrings;
+			size_t endVoice = trackIndex < 0 ? this->sounding.size() : firstVoice + maxStrings;
+			for (size_t voice = firstVoice; voice < endVoice; voice++) {
+				SoundingNote &note = this->sounding[voice];
+				if (note.active && note.endFrame < beforeFrame) {
+					add(make_event(note.endFrame, audio_note_off, voice / maxStrings, voice % maxStrings, 0));
+					note.active = false;
+				}
+			}
+		}
+
+		void schedule_measure(int measureIndex, int trackIndex) {
+			const TrackHeader &track = this->song.trackHeaders[trackIndex];
+			int stringCount = std::min(std::max(track.stringCount, 0), maxStrings);
+			const Measure &measure = this->song.get_measure(measureIndex, trackIndex);
+
+			long long measureEnd = this->tempoMap.measure_tick(measureIndex+1);
+			long long tick = this->tempoMap.measure_tick(measureIndex);
+
+			for (const Beat &beat : measure.beats) {
+				// beats that don't fit in the measure are squeezed in at its end, like in the MIDI export
+				tick = std::min(tick, measureEnd);
+				long long endTick = tick + getBeatTicks(beat);
+				long long frame = frame_at(tick);
+				long long endFrame = frame_at(endTick);
+				// like the MIDI export, so a note that's cut short doesn't ring until the next note on its string
+				release_notes(frame, trackIndex);
+
+				if (beat.beatFlags & gp_beat_has_mix_change) {
+					const MixChange &change = beat.mixTableChange;
+					if (change.volume >= 0) {
+						add(make_event(frame, audio_volume, trackIndex, 0, volumeValue(change.volume)));
+					}
+					if (change.balance >= 0) {
+						add(make_event(frame, audio_balance, trackIndex, 0, balanceValue(change.balance)));
+					}
+				}
+
+				for (int stringIndex = 0; stringIndex < stringCount && !beat.isRest; stringIndex++) {
+					if (!(beat.beatNotes.stringsPlayed & (0x40 >> stringIndex))) {
+						continue;
+					}
+					const Note &note = beat.beatNotes.strings[stringIndex];
+					SoundingNote &current = this->sounding[trackIndex*maxStrings + stringIndex];
+
+					if (note.noteType == gp_notetype_tied) {
+						if (current.active) {
+							current.endFrame = endFrame;
+						}
+						continue;
+					}
+
+					if (current.active) {
+						add(make_event(frame, audio_note_off, trackIndex, stringIndex, 0));
+					}
+					current.active = true;
+					current.endFrame = endFrame;
+					if (note.noteType == gp_notetype_dead) {
+						current.endFrame = std::min(endFrame, frame_at(tick + ticksPerQuarter/16));
+					}
+
+					int pitch = getNotePitch(track, stringIndex, note.fretNumber);
+					add(make_event(frame, audio_note_on, trackIndex, stringIndex, getNoteVelocity(note) / 127.0f, pitch));
+
+					// bend points are placed from 0 to 60 over the length of the note, 50 is a semitone
+					if ((note.noteFlags & gp_note_has_effects) && (note.noteEffectFlags & gp_notefx_bend)) {
+						for (const BendPoint &point : note.noteBend.points) {
+							long long pointFrame = frame + (current.endFrame - frame) * std::max(std::min(point.position, 60), 0) / 60;
+							add(make_event(pointFrame, audio_bend, trackIndex, stringIndex, point.value / 50.0f));
+						}
+					}
+				}
+
+				tick = endTick;
+			}
+		}
+};
+
+// a plucked string for every voice, a triangle wave that dies away
+class Synth {
+	public:
+		Synth(int trackCount, int sampleRate) : sampleRate(sampleRate) {
+			this->voices.assign(trackCount * maxStrings, Voice());
+			this->trackGains.assign(trackCount, TrackGain{ 0.5f, 0.5f });
+			this->trackVolumes.assign(trackCount, 1.0f);
+			this->trackBalances.assign(trackCount, 0.0f);
+
+			// a held note fades by 60 dB in 2 seconds, a released one in 50 ms
+			this->sustainDecay = std::pow(0.001, 1.0 / (2.0 * sampleRate));
+			this->releaseDecay = std::pow(0.001, 1.0 / (0.05 * sampleRate));
+		}
+
+		bool is_silent() const {
+			return std::none_of(this->voices.begin(), this->voices.end(), [](const Voice &voice) { return voice.active; });
+		}
+
+		void apply(const AudioEvent &event) {
+			if (event.track >= this->trackGains.size()) {
+				return;
+			}
+			Voice &voice = this->voices[event.track*maxStrings + event.string];
+
+			switch (event.type) {
+				case audio_note_on:
+					voice.active = true;
+					voice.pitch = event.pitch;
+					voice.bend = 0;
+					voice.amplitude = 0.2f * event.value;
+					voice.decay = this->sustainDecay;
+					update_frequency(voice);
+					break;
+				case audio_note_off:
+					voice.decay = this->releaseDecay;
+					break;
+				case audio_bend:
+					voice.bend = event.value;
+					update_frequency(voice);
+					break;
+				case audio_volume:
+					this->trackVolumes[event.track] = event.value;
+					update_gain(event.track);
+					break;
+				case audio_balance:
+					this->trackBalances[event.track] = event.value;
+					update_gain(event.track);
+					break;
+			}
+		}
+
+		// adds the voices to the interleaved stereo samples
+		void render(float *samples, int frameCount) {
+			for (size_t voiceIndex = 0; voiceIndex < this->voices.size(); voiceIndex++) {
+				Voice &voice = this->voices[voiceIndex];
+				if (!voice.active) {
+					continue;
+				}
+				const TrackGain &gain = this->trackGains[voiceIndex / maxStrings];
+
+				for (int frame = 0; frame < frameCount; frame++) {
+					// triangle from the phase, which goes from 0 to 1
+					float value = 4.0f * std::fabs((float)voice.phase - 0.5f) - 1.0f;
+					value *= (float)voice.amplitude;
+					samples[2*frame] += value * gain.left;
+					samples[2*frame+1] += value * gain.right;
+
+					voice.phase += voice.phaseStep;
+					if (voice.phase >= 1.0) {
+						voice.phase -= 1.0;
+					}
+					voice.amplitude *= voice.decay;
+				}
+
+				if (voice.amplitude < 0.0001) {
+					voice.active = false;
+				}
+			}
+		}
+
+	private:
+		struct Voice {
+			bool active = false;
+			float pitch = 0;
+			float bend = 0;
+			double phase = 0;
+			double phaseStep = 0;
+			double amplitude = 0;
+			double decay = 1;
+		};
+
+		struct TrackGain {
+			float left;
+			float right;
+		};
+
+		int sampleRate;
+		double sustainDecay;
+		double releaseDecay;
+		std::vector<Voice> voices;
+		std::vector<TrackGain> trackGains;
+		std::vector<float> trackVolumes;
+		std::vector<float> trackBalances;
+
+		void update_frequency(Voice &voice) {
+			double frequency = 440.0 * std::pow(2.0, (voice.pitch + voice.bend - 69) / 12.0);
+			voice.phaseStep = frequency / this->sampleRate;
+		}
+
+		// equal power panning
+		void update_gain(int track) {
+			float angle = (this->trackBalances[track] + 1) * 0.25f * 3.14159265f;
+			this->trackGains[track].left = this->trackVolumes[track] * std::cos(angle);
+			this->trackGains[track].right = this->trackVolumes[track] * std::sin(angle);
+		}
+};
+
+int renderAudio(GPFile &song, const TempoMap &tempoMap, AudioSink &sink, int sampleRate, AudioRenderStats &stats) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	SpscRing<AudioEvent> ring(4096);
+	std::atomic<bool> stopped(false);
+	int status = 0;
+
+	EventScheduler scheduler(song, tempoMap, sampleRate, ring, stopped);
+	std::thread schedulerThread(&EventScheduler::run, &scheduler);
+
+	std::thread synthThread([&] {
+		Synth synth(song.trackCount, sampleRate);
+		std::vector<float> block(blockFrames * 2, 0.0f);
+		int blockFill = 0;
+		long long frame = 0;
+
+		// renders up to the frame, handing full blocks to the sink
+		auto renderUntil = [&](long long endFrame) {
+			while (frame < endFrame && status == 0) {
+				int count = (int)std::min<long long>(blockFrames - blockFill, endFrame - frame);
+				synth.render(&block[blockFill*2], count);
+				blockFill += count;
+				frame += count;
+
+				if (blockFill == blockFrames) {
+					status = sink.write(block.data(), blockFill);
+					std::fill(block.begin(), block.end(), 0.0f);
+					blockFill = 0;
+				}
+			}
+		};
+
+		AudioEvent event;
+		while (status == 0) {
+			if (!ring.pop(event)) {
+				// offline there's nothing else to do, a real time synth would keep rendering here
+				std::this_thread::yield();
+				continue;
+			}
+			stats.events++;
+
+			renderUntil(event.frame);
+			if (event.type == audio_end) {
+				break;
+			}
+			synth.apply(event);
+		}
+
+		// let the last notes ring out, for at most two seconds
+		long long tailEnd = frame + 2*sampleRate;
+		while (!synth.is_silent() && frame < tailEnd && status == 0) {
+			renderUntil(std::min(frame + blockFrames, tailEnd));
+		}
+		if (blockFill > 0 && status == 0) {
+			status = sink.write(block.data(), blockFill);
+		}
+		if (status == 0) {
+			status = sink.finish();
+		}
+
+		stats.frames = frame;
+		stopped = true;
+	});
+
+	synthThread.join();
+	schedulerThread.join();
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return status;
+}
+
+int renderAudioFile(const std::string &filePath, const std::string &wavPath, std::ostream &output) {
+	const int sampleRate = 44100;
+
+	GPFile song;
+	if (song.read_file(filePath, gp_open_string_views|gp_open_arena|gp_open_parallel) != 0) {
+		return 1;
+	}
+	TempoMap tempoMap;
+	if (tempoMap.build(song) != 0) {
+		return 1;
+	}
+
+	NullSink nullSink;
+	WavSink wavSink(wavPath, sampleRate);
+	if (!wavPath.empty() && !wavSink.is_open()) {
+		std::cerr << wavPath << ": could not be created\n";
+		return 1;
+	}
+	AudioSink &sink = wavPath.empty() ? (AudioSink &)nullSink : (AudioSink &)wavSink;
+
+	AudioRenderStats stats;
+	if (renderAudio(song, tempoMap, sink, sampleRate, stats) != 0) {
+		std::cerr << wavPath << ": could not be written\n";
+		return 1;
+	}
+
+	double audioSeconds = (double)stats.frames / sampleRate;
+	output << "rendered " << audioSeconds << " s of audio (" << stats.events << " events) in " << stats.seconds << " s, "
+		   << audioSeconds / std::max(stats.seconds, 1e-9) << "x real time\n";
+	return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <string>
+#include <ostream>
+
+#include "gp_file.hpp"
+#include "tempo_map.hpp"
+#include "audio_sink.hpp"
+
+enum AudioEventType {
+	audio_note_on,
+	audio_note_off,
+	audio_bend,
+	audio_volume,
+	audio_balance,
+	audio_end	// after the last event of the song
+};
+
+// a change to the sound at a frame, made by the scheduler and applied by the synth
+struct AudioEvent {
+	long long frame;
+	unsigned char type;	// enum AudioEventType
+	unsigned char track;
+	unsigned char string;
+	unsigned char pitch;	// note on: the MIDI note
+	float value;	// note on: velocity from 0 to 1, bend: semitones, volume: 0 to 1, balance: -1 (left) to 1 (right)
+};
+
+struct AudioRenderStats {
+	long long frames = 0;
+	long long events = 0;
+	double seconds = 0;	// how long rendering took
+};
+
+// plays the song into the sink
+// a scheduler thread turns the song into events in order of time and passes them through a lock free ring
+// to a synth thread, which renders the audio between them, so only the scheduler ever reads the song
+// returns 1 if the sink failed
+int renderAudio(GPFile &song, const TempoMap &tempoMap, AudioSink &sink, int sampleRate, AudioRenderStats &stats);
+
+// opens a gp3 file and renders it to a WAV file, or to a NullSink if wavPath is empty,
+// then writes how long that took to the output
+int renderAudioFile(const std::string &filePath, const std::string &wavPath, std::ostream &output);
+
+#endif // !AUDIO_ENGINE_H
@@ -0,0 +1,77 @@
+#include <string>
+#include <cstdio>
+#include <algorithm>
+
+#include "audio_sink.hpp"
+
+WavSink::WavSink(const std::string &filePath, int sampleRate) : sampleRate(sampleRate) {
+	this->file = std::fopen(filePath.c_str(), "wb");
+	if (this->file != nullptr) {
+		write_header();
+	}
+}
+
+WavSink::~WavSink() {
+	if (this->file != nullptr) {
+		std::fclose(this->file);
+	}
+}
+
+// the fields are little endian no matter what the machine is
+static void putLittleEndian(unsigned char *bytes, unsigned int value, int size) {
+	for (int i = 0; i < size; i++) {
+		bytes[i] = (unsigned char)(value >> (8*i));
+	}
+}
+
+void WavSink::write_header() {
+	unsigned char header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' };
+	putLittleEndian(header + 4, 36 + this->dataBytes, 4);
+	putLittleEndian(header + 16, 16, 4);	// format chunk size
+	putLittleEndian(header + 20, 1, 2);	// integer PCM
+	putLittleEndian(header + 22, 2, 2);	// channels
+	putLittleEndian(header + 24, this->sampleRate, 4);
+	putLittleEndian(header + 28, this->sampleRate * 4, 4);	// bytes per second
+	putLittleEndian(header + 32, 4, 2);	// bytes per frame
+	putLittleEndian(header + 34, 16, 2);	// bits per sample
+	std::copy_n("data", 4, header + 36);
+	putLittleEndian(header + 40, this->dataBytes, 4);
+
+	std::fwrite(header, 1, sizeof(header), this->file);
+}
+
+int WavSink::write(const float *samples, size_t frameCount) {
+	if (this->file == nullptr) {
+		return 1;
+	}
+
+	unsigned char bytes[4096];
+	size_t sampleCount = frameCount * 2;
+	for (size_t done = 0; done < sampleCount; ) {
+		size_t count = std::min(sampleCount - done, sizeof(bytes) / 2);
+		for (size_t i = 0; i < count; i++) {
+			float sample = std::max(std::min(samples[done + i], 1.0f), -1.0f);
+			putLittleEndian(bytes + 2*i, (unsigned int)(int)(sample * 32767), 2);
+		}
+		if (std::fwrite(bytes, 2, count, this->file) != count) {
+			return 1;
+		}
+		done += count;
+	}
+	this->dataBytes += sampleCount * 2;
+	return 0;
+}
+
+int WavSink::finish() {
+	if (this->file == nullptr) {
+		return 1;
+	}
+	if (std::fseek(this->file, 0, SEEK_SET) != 0) {
+		return 1;
+	}
+	write_header();
+
+	int status = std::fclose(this->file) == 0 ? 0 : 1;
+	this->file = nullptr;
+	return status;
+}
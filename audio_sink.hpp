@@ -0,0 +1,56 @@
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <string>
+#include <cstdio>
+#include <cstddef>
+
+// where rendered audio goes, in blocks of interleaved stereo frames with samples between -1 and 1
+class AudioSink {
+	public:
+		virtual ~AudioSink() { }
+
+		// returns 1 if the frames couldn't be written
+		virtual int write(const float *samples, size_t frameCount) = 0;
+		// called once after the last block
+		virtual int finish() { return 0; }
+};
+
+// throws the audio away, for measuring how fast it's rendered
+class NullSink : public AudioSink {
+	public:
+		size_t frames_written() const { return this->framesWritten; }
+
+		int write(const float *samples, size_t frameCount) override {
+			this->framesWritten += frameCount;
+			return 0;
+		}
+
+	private:
+		size_t framesWritten = 0;
+};
+
+// writes a 16 bit stereo WAV file as the blocks come in, the sizes in the header are filled in by finish
+class WavSink : public AudioSink {
+	public:
+		WavSink(const std::string &filePath, int sampleRate);
+		~WavSink();
+
+		WavSink(const WavSink &) = delete;
+		WavSink &operator=(const WavSink &) = delete;
+
+		// false if the file couldn't be created
+		bool is_open() const { return this->file != nullptr; }
+
+		int write(const float *samples, size_t frameCount) override;
+		int finish() override;
+
+	private:
+		std::FILE *file = nullptr;
+		int sampleRate;
+		size_t dataBytes = 0;
+
+		void write_header();
+};
+
+#endif // !AUDIO_SINK_H
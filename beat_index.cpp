@@ -0,0 +1,72 @@
+#include <vector>
+#include <algorithm>
+
+#include "beat_index.hpp"
+#include "gp_file.hpp"
+
+int getBeatTicks(const Beat &beat) {
+	// the division is only read with the flag, and left as it was otherwise
+	return getBeatTicks(beat.duration, beat.beatFlags, (beat.beatFlags & gp_beat_is_tuplet) ? beat.tupletDivision : 0);
+}
+
+int getBeatTicks(int duration, int beatFlags, int tupletDivision) {
+	// gp_duration_whole is -2, so a whole note is 4 quarters and every step after it halves that
+	// the duration comes from the file, and anything outside the durations there are would shift out of range
+	duration = std::min(std::max(duration, (int)gp_duration_whole), (int)gp_duration_sixty_fourth);
+	int ticks = (ticksPerQuarter*4) >> (duration + 2);
+
+	if (beatFlags & gp_beat_is_dotted) {
+		ticks += ticks/2;
+	}
+	if ((beatFlags & gp_beat_is_tuplet) && tupletDivision > 1) {
+		// n notes in the time of the largest power of two below n: triplets in the time of 2, quintuplets of 4, ...
+		// written so that a division read from a broken file can't overflow
+		int normalNotes = 1;
+		while (normalNotes <= (tupletDivision-1)/2) {
+			normalNotes *= 2;
+		}
+		ticks = (long long)ticks * normalNotes / tupletDivision;
+	}
+	return ticks;
+}
+
+BeatIndex::BeatIndex(GPFile &song, int trackIndex) : song(song), trackIndex(trackIndex) {
+	this->measureBeats.assign(1, 0);
+	this->beatTicks.assign(1, 0);
+	count_from(0);
+}
+
+void BeatIndex::count_from(int measureIndex) {
+	this->measureBeats.resize(measureIndex+1);
+	this->beatTicks.resize(this->measureBeats[measureIndex]+1);
+
+	long long tick = this->beatTicks.back();
+	for (int m = measureIndex; m < this->song.measureCount; m++) {
+		const Measure &measure = this->song.get_measure(m, this->trackIndex);
+		for (const Beat &beat : measure.beats) {
+			tick += getBeatTicks(beat);
+			this->beatTicks.push_back(tick);
+		}
+		this->measureBeats.push_back(this->beatTicks.size()-1);
+	}
+}
+
+void BeatIndex::update_measure(int measureIndex) {
+	count_from(measureIndex);
+}
+
+BeatPosition BeatIndex::beat_at_index(int beatNumber) const {
+	beatNumber = std::max(std::min(beatNumber, beat_count()-1), 0);
+
+	// the last measure starting at or before the beat, empty measures start where the next one does
+	auto measure = std::upper_bound(this->measureBeats.begin(), this->measureBeats.end(), beatNumber) - 1;
+	int measureIndex = std::min((int)(measure - this->measureBeats.begin()), this->song.measureCount-1);
+	return BeatPosition{ measureIndex, beatNumber - *measure };
+}
+
+BeatPosition BeatIndex::beat_at_tick(long long tick) const {
+	// the last beat starting at or before the tick, the end entry is never the one found for ticks inside the track
+	auto beat = std::upper_bound(this->beatTicks.begin(), this->beatTicks.end() - 1, tick);
+	int beatNumber = std::max((int)(beat - this->beatTicks.begin()) - 1, 0);
+	return beat_at_index(beatNumber);
+}
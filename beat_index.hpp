@@ -0,0 +1,62 @@
+#ifndef BEAT_INDEX_H
+#define BEAT_INDEX_H
+
+#include <vector>
+
+#include "gp_file.hpp"
+
+// the resolution of beat positions, a quarter note is this many ticks
+const int ticksPerQuarter = 960;
+
+// how long a beat is in ticks, including dots and tuplets
+int getBeatTicks(const Beat &beat);
+// the same for a beat that hasn't been decoded, tupletDivision only counts with gp_beat_is_tuplet
+int getBeatTicks(int duration, int beatFlags, int tupletDivision);
+
+// a beat in a track
+struct BeatPosition {
+	int measureIndex;
+	int beatIndex;
+};
+
+// where every beat of a track is, counted in beats and in ticks from the start of the song,
+// so a measure, a beat number or a tick can be found with a binary search instead of stepping through the track
+class BeatIndex {
+	public:
+		// decodes every measure of the track once, a lazily opened song keeps only the last ones cached
+		BeatIndex(GPFile &song, int trackIndex);
+
+		int track_index() const { return this->trackIndex; }
+
+		// the number of beats in the track, and the length of the track in ticks
+		int beat_count() const { return this->measureBeats.back(); }
+		long long tick_count() const { return this->beatTicks.back(); }
+
+		// the number of beats before the measure, measure_first_beat(measureCount) is beat_count()
+		int measure_first_beat(int measureIndex) const { return this->measureBeats[measureIndex]; }
+		long long measure_tick(int measureIndex) const { return this->beatTicks[this->measureBeats[measureIndex]]; }
+		long long beat_tick(int measureIndex, int beatIndex) const {
+			return this->beatTicks[this->measureBeats[measureIndex] + beatIndex];
+		}
+
+		// the beat with the given number, counting from 0 through the whole track
+		BeatPosition beat_at_index(int beatNumber) const;
+		// the beat playing at the tick, ticks past the end give the last beat
+		BeatPosition beat_at_tick(long long tick) const;
+
+		// call after beats have been edited, added or removed in a measure,
+		// the positions of the measures after it are counted again
+		void update_measure(int measureIndex);
+
+	private:
+		GPFile &song;
+		int trackIndex;
+
+		std::vector<int> measureBeats;	// measureCount+1 entries
+		std::vector<long long> beatTicks;	// the start of every beat, plus the end of the track
+
+		// counts the beats from the measure to the end of the track
+		void count_from(int measureIndex);
+};
+
+#endif // !BEAT_INDEX_H
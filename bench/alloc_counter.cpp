@@ -0,0 +1,81 @@
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+
+#include "alloc_counter.hpp"
+
+static std::atomic<size_t> allocations(0);
+
+size_t allocationCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+// with glibc malloc itself can be replaced, which also counts what C libraries like ncurses allocate,
+// operator new ends up here too
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *memory, size_t size);
+	void *__libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void *memory);
+
+	void *malloc(size_t size) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		return __libc_malloc(size);
+	}
+	void *calloc(size_t count, size_t size) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		return __libc_calloc(count, size);
+	}
+	void *realloc(void *memory, size_t size) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		return __libc_realloc(memory, size);
+	}
+	void *memalign(size_t alignment, size_t size) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		return __libc_memalign(alignment, size);
+	}
+	void *aligned_alloc(size_t alignment, size_t size) {
+		return memalign(alignment, size);
+	}
+	int posix_memalign(void **memory, size_t alignment, size_t size) {
+		*memory = memalign(alignment, size);
+		return *memory ? 0 : ENOMEM;
+	}
+	void free(void *memory) {
+		__libc_free(memory);
+	}
+}
+#else
+void *operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+// std::pmr::new_delete_resource passes the alignment along, so it uses these
+void *operator new(size_t size, std::align_val_t alignment) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	size_t align = std::max((size_t)alignment, sizeof(void *));
+	if (void *memory = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept {
+	std::free(memory);
+}
+void operator delete(void *memory, size_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void *memory, std::align_val_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+	std::free(memory);
+}
+#endif
@@ -0,0 +1,10 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+
+// linking alloc_counter.cpp replaces malloc (or operator new, without glibc),
+// so every allocation in the program is counted, including the ones the song memory makes upstream
+size_t allocationCount();
+
+#endif // !ALLOC_COUNTER_H
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+
+#include "gp3_generator.hpp"
+#include "alloc_counter.hpp"
+#include "../gp_file.hpp"
+#include "../gp_read.hpp"
+#include "../tempo_map.hpp"
+#include "../midi_export.hpp"
+
+struct BenchInput {
+	std::string name;
+	std::vector<char> bytes;
+	long long beatCount = 0;
+};
+
+struct BenchMode {
+	const char *name;
+	int openFlags;
+};
+
+static const BenchMode benchModes[] = {
+	{ "eager", gp_open_default },
+	{ "views", gp_open_string_views },
+	{ "arena", gp_open_arena },
+	{ "views+arena", gp_open_string_views|gp_open_arena },
+	{ "lazy", gp_open_string_views|gp_open_lazy_measures },
+	{ "parallel", gp_open_string_views|gp_open_parallel },
+	{ "parallel+arena", gp_open_string_views|gp_open_arena|gp_open_parallel }
+};
+
+static const char *usage =
+	"usage: bench_parse [--runs N] [--threads N] [generator options] [FILE...]\n"
+	"--threads is how many threads the parallel modes decode with, one per hardware thread by default\n"
+	"without files a song is generated, the generator options are:\n"
+	"  --measures N  --tracks N  --beats N  --seed N\n"
+	"  --effects PERCENT  --bends PERCENT  --chords PERCENT  --mix PERCENT\n";
+
+// parses the input once in eager mode to count its beats, returns 1 if it isn't a valid file
+static int countBeats(BenchInput &input) {
+	gp_read::Cursor cursor(input.bytes);
+	GPFile song(cursor, gp_open_quiet);
+	if (!song.readError.empty()) {
+		std::cerr << input.name << ": " << song.readError << "\n";
+		return 1;
+	}
+
+	for (auto &measureTracks : song.measures) {
+		for (auto &measure : measureTracks) {
+			input.beatCount += measure.beatCount;
+		}
+	}
+	return 0;
+}
+
+// runs the work `runs` times, returns the fastest run in seconds and the allocations of the last one
+template <typename Work>
+static double timeRuns(int runs, size_t &allocations, Work work) {
+	double bestSeconds = 0;
+
+	for (int run = 0; run < runs; run++) {
+		size_t allocationsBefore = allocationCount();
+		auto start = std::chrono::steady_clock::now();
+		work();
+		std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+		allocations = allocationCount() - allocationsBefore;
+		if (run == 0 || seconds.count() < bestSeconds) {
+			bestSeconds = seconds.count();
+		}
+	}
+	return bestSeconds;
+}
+
+static void printRow(const BenchInput &input, const char *name, double seconds, size_t allocations) {
+	std::cout << "  " << std::left << std::setw(14) << name << std::right << std::setprecision(1)
+			  << std::setw(10) << input.bytes.size() / 1e6 / seconds
+			  << std::setw(14) << std::setprecision(0) << input.beatCount / seconds
+			  << std::setw(14) << allocations << "\n";
+}
+
+static void benchInput(const BenchInput &input, int runs, int threads) {
+	std::cout << input.name << ": " << std::fixed << std::setprecision(2)
+			  << input.bytes.size() / 1e6 << " MB, " << input.beatCount << " beats\n";
+	std::cout << "  " << std::left << std::setw(14) << "mode" << std::right
+			  << std::setw(10) << "MB/s" << std::setw(14) << "beats/s" << std::setw(14) << "allocs/file" << "\n";
+
+	size_t allocations = 0;
+	double seconds;
+
+	// lazy mode only walks the beats, but they're counted the same so the modes compare
+	for (const BenchMode &mode : benchModes) {
+		seconds = timeRuns(runs, allocations, [&]() {
+			GPFile song;
+			song.openFlags = mode.openFlags|gp_open_quiet;
+			song.parseThreadCount = threads;
+			gp_read::Cursor cursor(input.bytes);
+			song.read_song(cursor);
+		});
+		printRow(input, mode.name, seconds, allocations);
+	}
+
+	// writing back into a buffer, which is what a save costs apart from the disk
+	gp_read::Cursor cursor(input.bytes);
+	GPFile song(cursor, gp_open_quiet);
+	seconds = timeRuns(runs, allocations, [&]() {
+		std::vector<char> buffer;
+		song.write_song(buffer);
+	});
+	printRow(input, "write", seconds, allocations);
+
+	// exporting as MIDI from a parsed song, the tempo map included
+	seconds = timeRuns(runs, allocations, [&]() {
+		TempoMap tempoMap;
+		tempoMap.build(song);
+		std::vector<char> buffer;
+		writeMidi(song, tempoMap, buffer);
+	});
+	printRow(input, "midi", seconds, allocations);
+
+	// a save after changing one measure, the rest is copied from the file
+	GPFile editedSong;
+	editedSong.openFlags = gp_open_string_views|gp_open_lazy_measures|gp_open_quiet;
+	editedSong.fileBuffer = std::make_shared<std::vector<char>>(input.bytes);
+	gp_read::Cursor editedCursor(*editedSong.fileBuffer);
+	editedSong.read_song(editedCursor);
+	if (editedSong.measureCount > 0 && editedSong.trackCount > 0) {
+		editedSong.edit_measure(editedSong.measureCount / 2, 0);
+	}
+	seconds = timeRuns(runs, allocations, [&]() {
+		std::vector<char> buffer;
+		editedSong.write_changes(buffer);
+	});
+	printRow(input, "write changes", seconds, allocations);
+}
+
+int main(int argc, char const *argv[]) {
+	GeneratorSettings settings;
+	std::vector<std::string> filePaths;
+	int runs = 20;
+	int threads = 0;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+
+		int used = parseGeneratorOption(argc, argv, i, settings);
+		if (used > 0) {
+			i += used - 1;
+		}
+		else if (used < 0 || ((option == "--runs" || option == "--threads") && i+1 >= argc)) {
+			std::cerr << usage;
+			return 1;
+		}
+		else if (option == "--runs") {
+			runs = std::max(std::stoi(argv[++i]), 1);
+		}
+		else if (option == "--threads") {
+			threads = std::max(std::stoi(argv[++i]), 0);
+		}
+		else if (option == "--help" || option == "-h") {
+			std::cout << usage;
+			return 0;
+		}
+		else {
+			filePaths.push_back(option);
+		}
+	}
+
+	std::vector<BenchInput> inputs;
+	if (filePaths.empty()) {
+		BenchInput input;
+		input.name = "generated " + std::to_string(settings.measureCount) + "x" + std::to_string(settings.trackCount);
+		input.bytes = generateSong(settings);
+		inputs.push_back(std::move(input));
+	}
+	for (const std::string &filePath : filePaths) {
+		BenchInput input;
+		input.name = filePath;
+		if (gp_read::load_file(filePath, input.bytes) != 0) {
+			std::cerr << filePath << ": could not be read\n";
+			return 1;
+		}
+		inputs.push_back(std::move(input));
+	}
+
+	for (BenchInput &input : inputs) {
+		if (countBeats(input) != 0) {
+			return 1;
+		}
+		benchInput(input, runs, threads);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+
+#ifdef _WIN32
+	#include <curses.h>
+#else
+	#include <ncurses.h>
+#endif
+
+#include "gp3_generator.hpp"
+#include "alloc_counter.hpp"
+#include "../gp_file.hpp"
+#include "../gp_read.hpp"
+#include "../tempo_map.hpp"
+#include "../gpedit.hpp"
+#include "../windows.hpp"
+#include "../editing.hpp"
+#include "../stacked_view.hpp"
+#include "../perf_hud.hpp"
+
+static const char *usage =
+	"usage: bench_scroll [generator options] [FILE]\n"
+	"scrolls through the first track of the file, or of a generated song, on a terminal that isn't shown\n"
+	"and then through all of its tracks at once, and counts the allocations of every frame\n"
+	"fails if a frame allocates without printing the measures around the selection\n";
+
+// frames that allocated, but didn't print a chunk, in every pass
+static long long unexpectedFrames = 0;
+
+// presses the given key repeat times, one frame per keypress
+static void scrollPass(const char *name, int key, int repeat, void (*handleKey)(int) = handleTabKey, bool (*drawFrame)() = drawTabFrame) {
+	long long frames = 0;
+	long long allocatingFrames = 0;
+	long long passUnexpected = 0;
+	size_t allocations = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeat; i++) {
+		size_t allocationsBefore = allocationCount();
+		size_t chunksBefore = editorTimings.trackChunks.count();
+		handleKey(key);
+		drawFrame();
+		size_t frameAllocations = allocationCount() - allocationsBefore;
+
+		frames++;
+		allocations += frameAllocations;
+		if (frameAllocations > 0) {
+			allocatingFrames++;
+			if (editorTimings.trackChunks.count() == chunksBefore) {
+				passUnexpected++;
+			}
+		}
+	}
+	std::chrono::duration<double, std::micro> microseconds = std::chrono::steady_clock::now() - start;
+
+	std::cout << "  " << std::left << std::setw(14) << name << std::right << std::fixed
+			  << std::setw(10) << frames
+			  << std::setw(12) << std::setprecision(1) << microseconds.count() / frames
+			  << std::setw(14) << std::setprecision(2) << (double)allocations / frames
+			  << std::setw(16) << allocatingFrames
+			  << std::setw(12) << passUnexpected << "\n";
+	unexpectedFrames += passUnexpected;
+}
+
+int main(int argc, char const *argv[]) {
+	GeneratorSettings settings;
+	settings.measureCount = 400;
+	std::string filePath;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+
+		int used = parseGeneratorOption(argc, argv, i, settings);
+		if (used > 0) {
+			i += used - 1;
+		}
+		else if (used < 0) {
+			std::cerr << usage;
+			return 1;
+		}
+		else if (option == "--help" || option == "-h") {
+			std::cout << usage;
+			return 0;
+		}
+		else {
+			filePath = option;
+		}
+	}
+
+	// opened the way openFile does it, so the frames decode measures like in the editor
+	if (!filePath.empty()) {
+		if (openFile(filePath) != 0) {
+			return 1;
+		}
+	}
+	else {
+		songFilePath = "generated.gp3";
+		song.openFlags = gp_open_string_views|gp_open_lazy_measures;
+		song.fileBuffer = std::make_shared<std::vector<char>>(generateSong(settings));
+		gp_read::Cursor cursor(*song.fileBuffer);
+		if (song.read_song(cursor) != 0 || tempoMap.build(song) != 0) {
+			return 1;
+		}
+	}
+	if (song.trackCount == 0 || song.measureCount == 0) {
+		std::cerr << "the song has no beats to scroll through\n";
+		return 1;
+	}
+
+	long long beatCount = 0;
+	for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+		beatCount += song.get_measure(measureIndex, 0).beatCount;
+	}
+
+	// the screen goes nowhere, ncurses still does all of its work
+	FILE *screenOutput = std::fopen("/dev/null", "w");
+	FILE *screenInput = std::fopen("/dev/null", "r");
+	SCREEN *screen = newterm("xterm", screenOutput, screenInput);
+	if (screen == nullptr) {
+		std::cerr << "no terminfo entry for xterm\n";
+		return 1;
+	}
+	resizeterm(40, 120);
+
+	displaySongInfo();
+	openTabView();
+	drawTabFrame();
+
+	std::cout << songFilePath << ": " << song.measureCount << " measures, " << beatCount << " beats in track 1\n";
+	std::cout << "  " << std::left << std::setw(14) << "pass" << std::right
+			  << std::setw(10) << "frames" << std::setw(12) << "us/frame"
+			  << std::setw(14) << "allocs/frame" << std::setw(16) << "frames w/alloc" << std::setw(12) << "unexpected" << "\n";
+
+	// the first pass lays the beats out, the second one only has to show them again
+	scrollPass("right", KEY_RIGHT, beatCount);
+	scrollPass("left", KEY_LEFT, beatCount);
+	scrollPass("right again", KEY_RIGHT, beatCount);
+	scrollPass("string", KEY_DOWN, 1000);
+	scrollPass("measure", KEY_SLEFT, song.measureCount);
+
+	closeTabView();
+
+	// all tracks, only the ones on screen are printed, and scrolling between tracks reuses their rows
+	auto start = std::chrono::steady_clock::now();
+	openStackedView();
+	drawStackedFrame();
+	std::chrono::duration<double, std::micro> openMicroseconds = std::chrono::steady_clock::now() - start;
+	std::cout << "all " << song.trackCount << " tracks, first frame in " << std::setprecision(0) << openMicroseconds.count() << " us\n";
+
+	// ncurses allocates the first time it sends a terminal capability, scrolling through the tracks once
+	// sends every one the passes use
+	for (int i = 0; i < song.trackCount; i++) {
+		handleStackedKey(KEY_DOWN);
+		drawStackedFrame();
+	}
+	for (int i = 0; i < song.trackCount; i++) {
+		handleStackedKey(KEY_UP);
+		drawStackedFrame();
+	}
+
+	scrollPass("all measures", KEY_RIGHT, song.measureCount, handleStackedKey, drawStackedFrame);
+	scrollPass("all tracks", KEY_DOWN, song.trackCount, handleStackedKey, drawStackedFrame);
+	scrollPass("all tracks up", KEY_UP, song.trackCount, handleStackedKey, drawStackedFrame);
+	closeStackedView();
+
+	endwin();
+	delscreen(screen);
+	std::fclose(screenOutput);
+	std::fclose(screenInput);
+
+	if (unexpectedFrames > 0) {
+		std::cerr << unexpectedFrames << " frames allocated without printing a chunk\n";
+		return 1;
+	}
+	return 0;
+}
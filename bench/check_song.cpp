@@ -0,0 +1,389 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "gp3_generator.hpp"
+#include "alloc_counter.hpp"
+#include "../gp_file.hpp"
+#include "../gp_read.hpp"
+#include "../edit_history.hpp"
+#include "../tempo_map.hpp"
+
+struct CheckInput {
+	std::string name;
+	std::vector<char> bytes;
+};
+
+struct CheckMode {
+	const char *name;
+	int openFlags;
+	bool fewAllocations;	// allocates the same few blocks for any song, apart from the rows of its measures
+};
+
+// every way a song can be read, they all have to give the same song
+// the parallel arenas go with the number of threads, so only the arena modes on one thread have a fixed number
+static const CheckMode checkModes[] = {
+	{ "eager", gp_open_default, false },
+	{ "views", gp_open_string_views, false },
+	{ "arena", gp_open_arena, true },
+	{ "views+arena", gp_open_string_views|gp_open_arena, true },
+	{ "lazy", gp_open_string_views|gp_open_lazy_measures, false },
+	{ "parallel", gp_open_string_views|gp_open_parallel, false },
+	{ "parallel+arena", gp_open_string_views|gp_open_arena|gp_open_parallel, false }
+};
+
+// what an arena mode may allocate, the song memory and its arena, the header and offset vectors and a few strings
+static const size_t arenaAllocations = 16;
+
+static const char *usage =
+	"usage: check_song [generator options] [FILE...]\n"
+	"reads the files and a few generated songs in every open mode, and fails if one of them doesn't:\n"
+	"- write_song gives back the file byte for byte\n"
+	"- write_changes gives the same bytes as write_song after each of a row of edits\n"
+	"- undoing and redoing a row of recorded edits gives back the song written after each of them,\n"
+	"  and the tempo map updated along the way is the same as one built again\n"
+	"- the arena modes make no more than a fixed number of allocations, plus two per chunk of measure rows\n";
+
+static int failedChecks = 0;
+
+static void fail(const CheckInput &input, const CheckMode &mode, const std::string &message) {
+	std::cerr << input.name << " (" << mode.name << "): " << message << "\n";
+	failedChecks++;
+}
+
+// the first byte where two buffers differ, or the length of the shorter one
+static size_t firstDifference(const std::vector<char> &a, const std::vector<char> &b) {
+	size_t i = 0;
+	while (i < a.size() && i < b.size() && a[i] == b[i]) {
+		i++;
+	}
+	return i;
+}
+
+// reads the input the way the editor does, with the file kept for the modes that point into it
+// allocations is set to how many allocations reading the song took
+static std::unique_ptr<GPFile> readInput(const CheckInput &input, const CheckMode &mode, size_t *allocations = nullptr) {
+	auto song = std::make_unique<GPFile>();
+	song->openFlags = mode.openFlags|gp_open_quiet;
+	song->fileBuffer = std::make_shared<std::vector<char>>(input.bytes);
+	gp_read::Cursor cursor(*song->fileBuffer);
+	
+	size_t allocationsBefore = allocationCount();
+	song->read_song(cursor);
+	if (allocations) {
+		*allocations = allocationCount() - allocationsBefore;
+	}
+	return song;
+}
+
+// a song that was read cleanly is written back the way it was, so saving without edits changes nothing
+static void checkRoundTrip(const CheckInput &input, const CheckMode &mode) {
+	size_t allocations = 0;
+	std::unique_ptr<GPFile> song = readInput(input, mode, &allocations);
+	if (!song->readError.empty()) {
+		fail(input, mode, "could not be read, " + song->readError);
+		return;
+	}
+	
+	// the measure rows are the only thing that grows with the song, every chunk of them and the vectors keeping track of the chunks
+	size_t rowChunks = song->measureRows.size() / ChunkedSequence<MeasureRow>::maxChunkSize + 1;
+	size_t maxAllocations = arenaAllocations + 2*rowChunks;
+	if (mode.fewAllocations && allocations > maxAllocations) {
+		fail(input, mode, "reading the song took " + std::to_string(allocations) + " allocations, no more than " +
+			std::to_string(maxAllocations) + " are expected");
+	}
+
+	std::vector<char> written;
+	song->write_song(written);
+	if (written != input.bytes) {
+		fail(input, mode, "write_song differs from the file at byte " + std::to_string(firstDifference(written, input.bytes)) +
+			" of " + std::to_string(input.bytes.size()));
+	}
+}
+
+struct CheckEdit {
+	const char *name;
+	void (*apply)(GPFile &song);
+};
+
+// each edit is made on what the ones before it left, so the later ones land on moved and inserted measures
+static const CheckEdit checkEdits[] = {
+	{ "edit_measure", [](GPFile &song) {
+		Measure &measure = song.edit_measure(song.measureCount / 2, 0);
+		if (!measure.beats.empty()) {
+			measure.beats[0].beatFlags ^= gp_beat_is_dotted;
+		}
+	} },
+	{ "edit_measure_header", [](GPFile &song) {
+		MeasureHeader &header = song.edit_measure_header(song.measureCount - 1);
+		header.measureFlags |= gp_measure_keysig_numerator;
+		header.keysigNumerator = 7;
+	} },
+	{ "edit_track_header", [](GPFile &song) {
+		song.edit_track_header(song.trackCount - 1).capo += 2;
+	} },
+	{ "edit_song_info", [](GPFile &song) {
+		song.edit_song_info();
+		song.tempo += 10;
+	} },
+	{ "insert_measures", [](GPFile &song) {
+		song.insert_measures(std::min(3, song.measureCount), 2);
+	} },
+	{ "remove_measures", [](GPFile &song) {
+		song.remove_measures(1, 1);
+	} },
+	{ "move_measures", [](GPFile &song) {
+		song.move_measures(0, 2, song.measureCount - 2);
+	} },
+	{ "edit a moved measure", [](GPFile &song) {
+		Measure &measure = song.edit_measure(song.measureCount - 1, song.trackCount - 1);
+		if (!measure.beats.empty()) {
+			measure.beats[0].beatFlags ^= gp_beat_is_dotted;
+		}
+	} }
+};
+
+// saving only encodes what was edited and copies the rest from the file, which has to come out the same as encoding everything
+static void checkWriteChanges(const CheckInput &input, const CheckMode &mode) {
+	std::unique_ptr<GPFile> song = readInput(input, mode);
+	// the edits need a few measures to move around
+	if (!song->readError.empty() || song->measureCount < 4 || song->trackCount < 1) {
+		return;
+	}
+
+	for (const CheckEdit &edit : checkEdits) {
+		edit.apply(*song);
+
+		std::vector<char> changes;
+		std::vector<char> whole;
+		song->write_changes(changes);
+		song->write_song(whole);
+		if (changes != whole) {
+			fail(input, mode, std::string("write_changes differs from write_song after ") + edit.name + ", at byte " +
+				std::to_string(firstDifference(changes, whole)));
+			return;
+		}
+	}
+}
+
+struct CheckCommand {
+	const char *name;
+	void (*record)(GPFile &song, EditHistory &history);
+};
+
+// a beat of a measure of the track, to change its length
+static void toggleDotted(GPFile &song, EditHistory &history, int measureIndex, int trackIndex) {
+	Measure &measure = history.edit_measure(song, measureIndex, trackIndex);
+	if (!measure.beats.empty()) {
+		measure.beats[0].beatFlags ^= gp_beat_is_dotted;
+	}
+}
+
+// the same kinds of edits as above, made as commands of the history, a few of them with more than one step
+static const CheckCommand checkCommands[] = {
+	{ "edit a measure", [](GPFile &song, EditHistory &history) {
+		toggleDotted(song, history, song.measureCount / 2, 0);
+	} },
+	{ "edit the same measure twice and another track", [](GPFile &song, EditHistory &history) {
+		toggleDotted(song, history, 1, 0);
+		toggleDotted(song, history, 1, 0);
+		toggleDotted(song, history, 1, song.trackCount - 1);
+	} },
+	{ "change a time signature", [](GPFile &song, EditHistory &history) {
+		MeasureHeader &header = history.edit_measure_header(song, song.measureCount / 3);
+		header.measureFlags |= gp_measure_keysig_numerator;
+		header.keysigNumerator = 7;
+	} },
+	{ "change the time signature and beats of a measure", [](GPFile &song, EditHistory &history) {
+		MeasureHeader &header = history.edit_measure_header(song, 2);
+		header.measureFlags |= gp_measure_keysig_numerator|gp_measure_keysig_denominator;
+		header.keysigNumerator = 3;
+		header.keysigDenominator = 8;
+		toggleDotted(song, history, 2, 0);
+	} },
+	{ "insert measures and edit them", [](GPFile &song, EditHistory &history) {
+		history.insert_measures(song, 3, 2);
+		toggleDotted(song, history, 3, 0);
+		history.edit_measure_header(song, 4).measureFlags |= gp_measure_double_bar;
+	} },
+	{ "edit a measure and remove it", [](GPFile &song, EditHistory &history) {
+		toggleDotted(song, history, 1, 0);
+		history.remove_measures(song, 1, 1);
+	} },
+	{ "move measures", [](GPFile &song, EditHistory &history) {
+		history.move_measures(song, 0, 2, song.measureCount - 2);
+	} },
+	{ "edit a moved measure", [](GPFile &song, EditHistory &history) {
+		toggleDotted(song, history, song.measureCount - 1, song.trackCount - 1);
+		history.edit_measure_header(song, song.measureCount - 1).measureFlags ^= gp_measure_double_bar;
+	} }
+};
+
+// the measures and tempo segments of the two maps, the seconds included, since they're counted the same way
+static bool sameTempoMap(const TempoMap &a, const TempoMap &b) {
+	if (a.measure_count() != b.measure_count()) {
+		return false;
+	}
+	for (int i = 0; i <= a.measure_count(); i++) {
+		if (a.measure_tick(i) != b.measure_tick(i)) return false;
+	}
+	const std::vector<TempoMap::TempoSegment> &aSegments = a.tempo_segments();
+	const std::vector<TempoMap::TempoSegment> &bSegments = b.tempo_segments();
+	if (aSegments.size() != bSegments.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < aSegments.size(); i++) {
+		if (aSegments[i].tick != bSegments[i].tick || aSegments[i].tempo != bSegments[i].tempo ||
+			aSegments[i].seconds != bSegments[i].seconds) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// records the commands, then undoes them all and redoes them all, the song has to be written the same way
+// every time it gets back to the same point, and the tempo map has to follow it
+static void checkUndoRedo(const CheckInput &input, const CheckMode &mode) {
+	std::unique_ptr<GPFile> song = readInput(input, mode);
+	if (!song->readError.empty() || song->measureCount < 4 || song->trackCount < 1) {
+		return;
+	}
+
+	EditHistory history;
+	TempoMap tempoMap;
+	tempoMap.build(*song);
+	const size_t commandCount = sizeof(checkCommands) / sizeof(checkCommands[0]);
+
+	// what the song is written as before any command, and after each one
+	std::vector<std::vector<char>> written(commandCount + 1);
+	song->write_song(written[0]);
+
+	// the song is at a point after the last command applied, or before the first
+	auto checkPoint = [&](const std::string &when, size_t point) -> bool {
+		std::vector<char> whole;
+		std::vector<char> changes;
+		song->write_song(whole);
+		song->write_changes(changes);
+		if (whole != written[point]) {
+			fail(input, mode, "write_song differs " + when + ", at byte " + std::to_string(firstDifference(whole, written[point])));
+			return false;
+		}
+		if (changes != whole) {
+			fail(input, mode, "write_changes differs from write_song " + when + ", at byte " +
+				std::to_string(firstDifference(changes, whole)));
+			return false;
+		}
+
+		TempoMap built;
+		built.build(*song);
+		if (!sameTempoMap(tempoMap, built)) {
+			fail(input, mode, "the updated tempo map differs from a built one " + when);
+			return false;
+		}
+		return true;
+	};
+
+	for (size_t i = 0; i < commandCount; i++) {
+		history.begin(checkCommands[i].name);
+		checkCommands[i].record(*song, history);
+		history.commit(*song);
+		tempoMap.update_edits(*song, *history.next_undo());
+
+		song->write_song(written[i + 1]);
+		if (!checkPoint(std::string("after ") + checkCommands[i].name, i + 1)) {
+			return;
+		}
+	}
+
+	for (size_t i = commandCount; i > 0; i--) {
+		const EditCommand *command = history.undo(*song);
+		if (!command) {
+			fail(input, mode, std::string("could not undo ") + checkCommands[i - 1].name);
+			return;
+		}
+		tempoMap.update_edits(*song, *command);
+		if (!checkPoint(std::string("after undoing ") + command->name, i - 1)) {
+			return;
+		}
+	}
+
+	for (size_t i = 1; i <= commandCount; i++) {
+		const EditCommand *command = history.redo(*song);
+		if (!command) {
+			fail(input, mode, std::string("could not redo ") + checkCommands[i - 1].name);
+			return;
+		}
+		tempoMap.update_edits(*song, *command);
+		if (!checkPoint(std::string("after redoing ") + command->name, i)) {
+			return;
+		}
+	}
+}
+
+int main(int argc, char const *argv[]) {
+	GeneratorSettings settings;
+	std::vector<std::string> filePaths;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+
+		int used = parseGeneratorOption(argc, argv, i, settings);
+		if (used > 0) {
+			i += used - 1;
+		}
+		else if (used < 0) {
+			std::cerr << usage;
+			return 1;
+		}
+		else if (option == "--help" || option == "-h") {
+			std::cout << usage;
+			return 0;
+		}
+		else {
+			filePaths.push_back(option);
+		}
+	}
+
+	// the song the benches use, and one with a lot more of everything that isn't a plain note, in short measures so the tempo ramps go on across them
+	std::vector<CheckInput> inputs;
+	GeneratorSettings busySettings = settings;
+	busySettings.effectPercent = 50;
+	busySettings.bendPercent = 30;
+	busySettings.chordPercent = 30;
+	busySettings.mixChangePercent = 40;
+	busySettings.beatsPerMeasure = 2;
+	busySettings.seed = settings.seed + 1;
+	for (const GeneratorSettings &generated : { settings, busySettings }) {
+		CheckInput input;
+		input.name = "generated " + std::to_string(generated.measureCount) + "x" + std::to_string(generated.trackCount) +
+					 " seed " + std::to_string(generated.seed);
+		input.bytes = generateSong(generated);
+		inputs.push_back(std::move(input));
+	}
+	for (const std::string &filePath : filePaths) {
+		CheckInput input;
+		input.name = filePath;
+		if (gp_read::load_file(filePath, input.bytes) != 0) {
+			std::cerr << filePath << ": could not be read\n";
+			return 1;
+		}
+		inputs.push_back(std::move(input));
+	}
+
+	for (const CheckInput &input : inputs) {
+		for (const CheckMode &mode : checkModes) {
+			checkRoundTrip(input, mode);
+			checkWriteChanges(input, mode);
+			checkUndoRedo(input, mode);
+		}
+		std::cout << input.name << ": checked\n";
+	}
+
+	if (failedChecks > 0) {
+		std::cerr << failedChecks << " checks failed\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gp3_generator.hpp"
+
+static const char *usage =
+	"usage: generate_gp3 [options] OUTPUT.gp3\n"
+	"  --measures N  --tracks N  --beats N  --seed N\n"
+	"  --effects PERCENT  --bends PERCENT  --chords PERCENT  --mix PERCENT\n";
+
+int main(int argc, char const *argv[]) {
+	GeneratorSettings settings;
+	std::string outputPath;
+
+	for (int i = 1; i < argc; i++) {
+		int used = parseGeneratorOption(argc, argv, i, settings);
+		if (used > 0) {
+			i += used - 1;
+		}
+		else if (used < 0 || !outputPath.empty() || argv[i][0] == '-') {
+			std::cerr << usage;
+			return 1;
+		}
+		else {
+			outputPath = argv[i];
+		}
+	}
+	if (outputPath.empty()) {
+		std::cerr << usage;
+		return 1;
+	}
+
+	std::vector<char> bytes = generateSong(settings);
+
+	std::ofstream output(outputPath, std::ios::binary);
+	output.write(bytes.data(), bytes.size());
+	if (!output) {
+		std::cerr << "Could not write " << outputPath << ".\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include <vector>
+#include <string>
+#include <random>
+
+#include "gp3_generator.hpp"
+#include "../gp_file.hpp"
+
+// writes the gp3 primitives, the opposite of gp_read
+class SongBytes {
+	public:
+		std::vector<char> bytes;
+
+		void byte(int value) {
+			bytes.push_back((char)value);
+		}
+		void integer(int value) {
+			for (int i = 0; i < 4; i++) {
+				bytes.push_back((char)(value >> (8*i)));
+			}
+		}
+		void padded_bytestring(const std::string &value, int size) {
+			byte(value.length());
+			bytes.insert(bytes.end(), value.begin(), value.end());
+			bytes.insert(bytes.end(), size - value.length(), 0);
+		}
+		void intbytestring(const std::string &value) {
+			integer(value.length() + 1);
+			byte(value.length());
+			bytes.insert(bytes.end(), value.begin(), value.end());
+		}
+};
+
+class SongGenerator {
+	public:
+		SongGenerator(const GeneratorSettings &settings) : settings(settings), random(settings.seed) { }
+
+		std::vector<char> generate() {
+			write_header();
+			for (int i = 0; i < settings.measureCount; i++) {
+				write_measure_header(i);
+			}
+			for (int i = 0; i < settings.trackCount; i++) {
+				write_track_header(i);
+			}
+			for (int i = 0; i < settings.measureCount; i++) {
+				for (int j = 0; j < settings.trackCount; j++) {
+					write_measure();
+				}
+			}
+			return std::move(out.bytes);
+		}
+
+	private:
+		const GeneratorSettings &settings;
+		std::mt19937 random;
+		SongBytes out;
+
+		bool chance(int percent) {
+			return (int)(random() % 100) < percent;
+		}
+		int between(int low, int high) {
+			return low + random() % (high - low + 1);
+		}
+
+		void write_header() {
+			out.padded_bytestring("FICHIER GUITAR PRO v3.00", 30);
+
+			const char *metadata[] = { "Generated song", "", "gpedit bench", "", "", "", "", "" };
+			for (const char *value : metadata) {
+				out.intbytestring(value);
+			}
+			out.integer(1);	// notice lines
+			out.intbytestring("generated by bench/gp3_generator.cpp");
+
+			out.byte(0);	// triplet feel
+			out.integer(120);	// tempo
+			out.integer(0);	// key
+
+			for (int port = 0; port < 4; port++) {
+				for (int channel = 0; channel < 16; channel++) {
+					out.integer(25);	// instrument
+					out.byte(13);	// volume, from 0 to 16
+					out.byte(8);	// balance, centered
+					for (int i = 0; i < 6; i++) {	// chorus, reverb, phaser, tremolo and the two blanks
+						out.byte(0);
+					}
+				}
+			}
+
+			out.integer(settings.measureCount);
+			out.integer(settings.trackCount);
+		}
+
+		void write_measure_header(int measureIndex) {
+			unsigned char flags = 0;
+			if (measureIndex == 0) {
+				flags |= gp_measure_keysig_numerator|gp_measure_keysig_denominator;
+			}
+			if (measureIndex % 16 == 0) {
+				flags |= gp_measure_marker;
+			}
+			out.byte(flags);
+
+			if (flags & gp_measure_keysig_numerator) {
+				out.byte(settings.beatsPerMeasure);
+			}
+			if (flags & gp_measure_keysig_denominator) {
+				out.byte(8);
+			}
+			if (flags & gp_measure_marker) {
+				out.intbytestring("Section " + std::to_string(measureIndex / 16 + 1));
+				out.integer(0x0000ff);	// color
+			}
+		}
+
+		void write_track_header(int trackIndex) {
+			out.byte(0);	// flags
+			out.padded_bytestring("Track " + std::to_string(trackIndex + 1), 40);
+
+			int tuning[7] = { 64, 59, 55, 50, 45, 40, 0 };
+			out.integer(6);
+			for (int value : tuning) {
+				out.integer(value);
+			}
+
+			out.integer(1);	// midi port
+			out.integer(trackIndex % 16 + 1);	// channel
+			out.integer(trackIndex % 16 + 1);	// effects channel
+			out.integer(24);	// frets
+			out.integer(0);	// capo
+			out.integer(0xff0000);	// color
+		}
+
+		void write_measure() {
+			out.integer(settings.beatsPerMeasure);
+			for (int i = 0; i < settings.beatsPerMeasure; i++) {
+				write_beat();
+			}
+		}
+
+		void write_beat() {
+			unsigned char flags = 0;
+			if (chance(settings.chordPercent)) {
+				flags |= gp_beat_has_chord;
+			}
+			if (chance(settings.effectPercent)) {
+				flags |= gp_beat_has_effects;
+			}
+			if (chance(settings.mixChangePercent)) {
+				flags |= gp_beat_has_mix_change;
+			}
+			bool isRest = chance(5);
+			if (isRest) {
+				flags |= gp_beat_is_empty_or_rest;
+			}
+			out.byte(flags);
+
+			if (isRest) {
+				out.byte(0x02);
+			}
+			out.byte(gp_duration_eighth);
+
+			if (flags & gp_beat_has_chord) {
+				out.byte(0);	// old format
+				out.intbytestring("Am");
+				out.integer(1);	// first fret
+				int frets[6] = { 0, 1, 2, 2, 0, -1 };
+				for (int fret : frets) {
+					out.integer(fret);
+				}
+			}
+			if (flags & gp_beat_has_effects) {
+				out.byte(gp_beatfx_vibrato|gp_beatfx_strum);
+				out.byte(gp_strum_sixteenth);	// down
+				out.byte(gp_strum_none);	// up
+			}
+			if (flags & gp_beat_has_mix_change) {
+				out.byte(-1);	// instrument
+				out.byte(between(8, 16));	// volume
+				for (int i = 0; i < 5; i++) {	// balance, chorus, reverb, phaser, tremolo
+					out.byte(-1);
+				}
+				out.integer(between(80, 160));	// tempo
+				out.byte(0);	// volume duration
+				out.byte(between(0, 8));	// tempo duration, a ramp over that many beats
+			}
+
+			unsigned char stringsPlayed = isRest ? 0 : 1 + random() % 0x3f;	// any of the six strings
+			out.byte(stringsPlayed << 1);
+			for (int i = 0; i < 6; i++) {
+				if ((stringsPlayed << 1) & (0x40 >> i)) {
+					write_note();
+				}
+			}
+		}
+
+		void write_note() {
+			bool hasBend = chance(settings.bendPercent);
+
+			unsigned char flags = gp_note_has_fret;
+			if (hasBend) {
+				flags |= gp_note_has_effects;
+			}
+			out.byte(flags);
+
+			out.byte(gp_notetype_normal);
+			out.byte(between(0, 15));	// fret
+
+			if (hasBend) {
+				out.byte(gp_notefx_bend);
+				out.byte(gp_bendtype_bend);
+				out.integer(100);	// value
+				out.integer(3);	// points
+				int points[3][2] = { { 0, 0 }, { 30, 100 }, { 60, 100 } };
+				for (auto &point : points) {
+					out.integer(point[0]);	// position
+					out.integer(point[1]);	// value
+					out.byte(0);	// vibrato
+				}
+			}
+		}
+};
+
+std::vector<char> generateSong(const GeneratorSettings &settings) {
+	return SongGenerator(settings).generate();
+}
+
+int parseGeneratorOption(int argc, char const *argv[], int index, GeneratorSettings &settings) {
+	std::string option = argv[index];
+
+	int *value = nullptr;
+	if (option == "--measures") value = &settings.measureCount;
+	else if (option == "--tracks") value = &settings.trackCount;
+	else if (option == "--beats") value = &settings.beatsPerMeasure;
+	else if (option == "--effects") value = &settings.effectPercent;
+	else if (option == "--bends") value = &settings.bendPercent;
+	else if (option == "--chords") value = &settings.chordPercent;
+	else if (option == "--mix") value = &settings.mixChangePercent;
+	else if (option == "--seed") value = (int *)&settings.seed;
+	else return 0;
+
+	if (index+1 >= argc) {
+		return -1;
+	}
+	*value = std::stoi(argv[index+1]);
+	return 2;
+}
\ No newline at end of file
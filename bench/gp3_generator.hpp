@@ -0,0 +1,27 @@
+#ifndef GP3_GENERATOR_H
+#define GP3_GENERATOR_H
+
+#include <vector>
+#include <string>
+
+// what the generated song should contain
+// the percentages are per beat, except bends which are per note
+struct GeneratorSettings {
+	int measureCount = 200;
+	int trackCount = 4;
+	int beatsPerMeasure = 8;
+	int effectPercent = 10;
+	int bendPercent = 5;
+	int chordPercent = 5;
+	int mixChangePercent = 2;
+	unsigned int seed = 1;
+};
+
+// builds a valid gp3 file in memory, the same settings always give the same file
+std::vector<char> generateSong(const GeneratorSettings &settings);
+
+// reads "--measures N" style options into the settings, returns the number of arguments used,
+// or -1 if the option is one of the generator's but its value is missing
+int parseGeneratorOption(int argc, char const *argv[], int index, GeneratorSettings &settings);
+
+#endif // !GP3_GENERATOR_H
\ No newline at end of file
@@ -0,0 +1,231 @@
+#ifndef CHUNKED_SEQUENCE_H
+#define CHUNKED_SEQUENCE_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+
+// a sequence stored as a list of small chunks, with the index each chunk ends at
+// finding an element is a binary search over the chunks, and inserting or erasing only moves
+// the elements of one chunk and the chunk table, so edits near the start of a long sequence stay cheap
+// iterating goes through the chunks in order, which is as fast as a vector
+template <typename T>
+class ChunkedSequence {
+	public:
+		// chunks are split in half when they grow past this, and merged when two neighbours fit in half of it
+		static const size_t maxChunkSize = 256;
+
+		class iterator {
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = T;
+				using difference_type = std::ptrdiff_t;
+				using pointer = T *;
+				using reference = T &;
+
+				iterator(std::vector<std::vector<T>> *chunks, size_t chunk, size_t offset) : chunks(chunks), chunk(chunk), offset(offset) { }
+
+				T &operator*() const { return (*this->chunks)[this->chunk][this->offset]; }
+				T *operator->() const { return &**this; }
+				iterator &operator++() {
+					if (++this->offset == (*this->chunks)[this->chunk].size()) {
+						this->chunk++;
+						this->offset = 0;
+					}
+					return *this;
+				}
+				bool operator==(const iterator &other) const { return this->chunk == other.chunk && this->offset == other.offset; }
+				bool operator!=(const iterator &other) const { return !(*this == other); }
+
+			private:
+				std::vector<std::vector<T>> *chunks;
+				size_t chunk;
+				size_t offset;
+		};
+
+		size_t size() const { return this->chunkEnds.empty() ? 0 : this->chunkEnds.back(); }
+		bool empty() const { return size() == 0; }
+
+		iterator begin() { return iterator(&this->chunks, 0, 0); }
+		iterator end() { return iterator(&this->chunks, this->chunks.size(), 0); }
+		// the element at index onwards
+		iterator at(size_t index) {
+			if (index >= size()) {
+				return end();
+			}
+			size_t chunk = find_chunk(index);
+			return iterator(&this->chunks, chunk, index - chunk_start(chunk));
+		}
+
+		T &operator[](size_t index) {
+			size_t chunk = find_chunk(index);
+			return this->chunks[chunk][index - chunk_start(chunk)];
+		}
+		const T &operator[](size_t index) const {
+			size_t chunk = find_chunk(index);
+			return this->chunks[chunk][index - chunk_start(chunk)];
+		}
+
+		void clear() {
+			this->chunks.clear();
+			this->chunkEnds.clear();
+		}
+
+		void push_back(T value) {
+			if (this->chunks.empty() || this->chunks.back().size() >= maxChunkSize) {
+				this->chunks.emplace_back();
+				this->chunks.back().reserve(maxChunkSize);
+				this->chunkEnds.push_back(size());
+			}
+			this->chunks.back().push_back(std::move(value));
+			this->chunkEnds.back()++;
+		}
+
+		// inserts the elements before index, index can be size() to append them
+		template <typename Iterator>
+		void insert(size_t index, Iterator first, Iterator last) {
+			size_t count = std::distance(first, last);
+			if (count == 0) {
+				return;
+			}
+			// anything bigger than a chunk goes in as chunks of its own
+			if (count > maxChunkSize / 2) {
+				ChunkedSequence inserted;
+				for (; first != last; ++first) {
+					inserted.push_back(*first);
+				}
+				ChunkedSequence tail = split(index);
+				append(std::move(inserted));
+				append(std::move(tail));
+				return;
+			}
+
+			if (this->chunks.empty()) {
+				this->chunks.emplace_back();
+				this->chunkEnds.push_back(0);
+			}
+			size_t chunk = index >= size() ? this->chunks.size()-1 : find_chunk(index);
+			std::vector<T> &elements = this->chunks[chunk];
+			elements.insert(elements.begin() + (index - chunk_start(chunk)), first, last);
+			for (size_t i = chunk; i < this->chunkEnds.size(); i++) {
+				this->chunkEnds[i] += count;
+			}
+			if (elements.size() > maxChunkSize) {
+				split_chunk(chunk, elements.size() / 2);
+			}
+		}
+		void insert(size_t index, T value) {
+			insert(index, &value, &value + 1);
+		}
+
+		// erases count elements from index on
+		void erase(size_t index, size_t count = 1) {
+			count = std::min(count, size() - std::min(index, size()));
+			while (count > 0) {
+				size_t chunk = find_chunk(index);
+				std::vector<T> &elements = this->chunks[chunk];
+				size_t offset = index - chunk_start(chunk);
+				size_t erased = std::min(count, elements.size() - offset);
+
+				elements.erase(elements.begin() + offset, elements.begin() + offset + erased);
+				for (size_t i = chunk; i < this->chunkEnds.size(); i++) {
+					this->chunkEnds[i] -= erased;
+				}
+				count -= erased;
+
+				if (elements.empty()) {
+					this->chunks.erase(this->chunks.begin() + chunk);
+					this->chunkEnds.erase(this->chunkEnds.begin() + chunk);
+				}
+				else {
+					merge_chunks(chunk);
+				}
+			}
+		}
+
+		// moves the elements from index on into a new sequence
+		ChunkedSequence split(size_t index) {
+			ChunkedSequence tail;
+			if (index >= size()) {
+				return tail;
+			}
+
+			size_t chunk = find_chunk(index);
+			if (index > chunk_start(chunk)) {
+				split_chunk(chunk, index - chunk_start(chunk));
+				chunk++;
+			}
+
+			tail.chunks.assign(std::make_move_iterator(this->chunks.begin() + chunk), std::make_move_iterator(this->chunks.end()));
+			for (size_t i = chunk; i < this->chunkEnds.size(); i++) {
+				tail.chunkEnds.push_back(this->chunkEnds[i] - index);
+			}
+			this->chunks.resize(chunk);
+			this->chunkEnds.resize(chunk);
+			return tail;
+		}
+
+		// moves every element of other to the end of this one
+		void append(ChunkedSequence &&other) {
+			if (other.empty()) {
+				return;
+			}
+			size_t start = size();
+			size_t firstAppended = this->chunks.size();
+			for (size_t i = 0; i < other.chunks.size(); i++) {
+				this->chunks.push_back(std::move(other.chunks[i]));
+				this->chunkEnds.push_back(start + other.chunkEnds[i]);
+			}
+			other.clear();
+
+			if (firstAppended > 0) {
+				merge_chunks(firstAppended - 1);
+			}
+		}
+
+		// moves count elements from index on so they start at toIndex, counted as if they had been removed first
+		void move_range(size_t index, size_t count, size_t toIndex) {
+			ChunkedSequence moved = split(index);
+			ChunkedSequence after = moved.split(count);
+			append(std::move(after));
+
+			ChunkedSequence tail = split(toIndex);
+			append(std::move(moved));
+			append(std::move(tail));
+		}
+
+	private:
+		std::vector<std::vector<T>> chunks;
+		std::vector<size_t> chunkEnds;	// the index after the last element of each chunk
+
+		size_t chunk_start(size_t chunk) const {
+			return chunk == 0 ? 0 : this->chunkEnds[chunk-1];
+		}
+		size_t find_chunk(size_t index) const {
+			return std::upper_bound(this->chunkEnds.begin(), this->chunkEnds.end(), index) - this->chunkEnds.begin();
+		}
+
+		// the elements from offset on go into a new chunk after it
+		void split_chunk(size_t chunk, size_t offset) {
+			std::vector<T> &elements = this->chunks[chunk];
+			std::vector<T> tail(std::make_move_iterator(elements.begin() + offset), std::make_move_iterator(elements.end()));
+			elements.erase(elements.begin() + offset, elements.end());
+
+			this->chunks.insert(this->chunks.begin() + chunk + 1, std::move(tail));
+			this->chunkEnds.insert(this->chunkEnds.begin() + chunk, chunk_start(chunk) + this->chunks[chunk].size());
+		}
+
+		// merges the chunk with the one after it if they're both small, so the chunks don't get ever smaller
+		void merge_chunks(size_t chunk) {
+			if (chunk+1 >= this->chunks.size() || this->chunks[chunk].size() + this->chunks[chunk+1].size() > maxChunkSize / 2) {
+				return;
+			}
+			std::vector<T> &next = this->chunks[chunk+1];
+			this->chunks[chunk].insert(this->chunks[chunk].end(), std::make_move_iterator(next.begin()), std::make_move_iterator(next.end()));
+			this->chunks.erase(this->chunks.begin() + chunk + 1);
+			this->chunkEnds.erase(this->chunkEnds.begin() + chunk);
+		}
+};
+
+#endif // !CHUNKED_SEQUENCE_H
@@ -0,0 +1,190 @@
+#include "edit_history.hpp"
+
+void EditHistory::begin(const std::string &name) {
+	this->current = EditCommand();
+	this->current.name = name;
+	this->openSteps = 0;
+	this->isRecording = true;
+}
+
+bool EditHistory::is_open_step(EditStepType type, int measureIndex, int trackIndex) const {
+	for (size_t i = this->openSteps; i < this->current.steps.size(); i++) {
+		const EditStep &step = this->current.steps[i];
+		if (step.type == type && step.measureIndex == measureIndex && step.trackIndex == trackIndex) {
+			return true;
+		}
+	}
+	return false;
+}
+
+Measure &EditHistory::edit_measure(GPFile &song, int measureIndex, int trackIndex) {
+	// keeping the version makes the song copy it before the change
+	if (this->isRecording && !is_open_step(edit_step_change, measureIndex, trackIndex)) {
+		EditStep step{edit_step_change, measureIndex, trackIndex, 0, 0};
+		step.before = song.edited_measure(measureIndex, trackIndex);
+		this->current.steps.push_back(std::move(step));
+	}
+	return song.edit_measure(measureIndex, trackIndex);
+}
+
+MeasureHeader &EditHistory::edit_measure_header(GPFile &song, int measureIndex) {
+	if (this->isRecording && !is_open_step(edit_step_header, measureIndex, 0)) {
+		EditStep step{edit_step_header, measureIndex, 0, 0, 0};
+		step.headerBefore = song.edited_measure_header(measureIndex);
+		this->current.steps.push_back(std::move(step));
+	}
+	return song.edit_measure_header(measureIndex);
+}
+
+void EditHistory::finish_changes(GPFile &song) {
+	for (size_t i = this->openSteps; i < this->current.steps.size(); i++) {
+		EditStep &step = this->current.steps[i];
+		if (step.type == edit_step_header) {
+			step.headerAfter = song.edited_measure_header(step.measureIndex);
+		}
+		else {
+			step.after = song.edited_measure(step.measureIndex, step.trackIndex);
+		}
+	}
+	this->openSteps = this->current.steps.size();
+}
+
+void EditHistory::insert_measures(GPFile &song, int measureIndex, int count) {
+	if (this->isRecording) {
+		finish_changes(song);
+	}
+	std::vector<MeasureRow> rows = song.make_measure_rows(count);
+	song.insert_measure_rows(measureIndex, rows);
+
+	if (this->isRecording) {
+		EditStep step{edit_step_insert, measureIndex, 0, count, 0};
+		step.rows = std::move(rows);
+		this->current.steps.push_back(std::move(step));
+		this->openSteps++;
+	}
+}
+
+void EditHistory::remove_measures(GPFile &song, int measureIndex, int count) {
+	if (this->isRecording) {
+		finish_changes(song);
+	}
+	std::vector<MeasureRow> rows = song.remove_measures(measureIndex, count);
+
+	if (this->isRecording) {
+		EditStep step{edit_step_remove, measureIndex, 0, (int)rows.size(), 0};
+		step.rows = std::move(rows);
+		this->current.steps.push_back(std::move(step));
+		this->openSteps++;
+	}
+}
+
+void EditHistory::move_measures(GPFile &song, int measureIndex, int count, int toIndex) {
+	if (this->isRecording) {
+		finish_changes(song);
+	}
+	song.move_measures(measureIndex, count, toIndex);
+
+	if (this->isRecording) {
+		this->current.steps.push_back(EditStep{edit_step_move, measureIndex, 0, count, toIndex});
+		this->openSteps++;
+	}
+}
+
+void EditHistory::commit(GPFile &song) {
+	if (!this->isRecording) {
+		return;
+	}
+	finish_changes(song);
+	this->isRecording = false;
+	if (this->current.steps.empty()) {
+		return;
+	}
+
+	this->undoCommands.push_back(std::move(this->current));
+	this->current = EditCommand();
+	this->redoCommands.clear();
+}
+
+void EditHistory::cancel(GPFile &song) {
+	for (auto step = this->current.steps.rbegin(); step != this->current.steps.rend(); step++) {
+		undo_step(song, *step);
+	}
+	this->current = EditCommand();
+	this->isRecording = false;
+}
+
+void EditHistory::undo_step(GPFile &song, const EditStep &step) {
+	switch (step.type) {
+		case edit_step_change:
+			song.restore_measure(step.measureIndex, step.trackIndex, step.before);
+			break;
+		case edit_step_header:
+			song.restore_measure_header(step.measureIndex, step.headerBefore);
+			break;
+		case edit_step_insert:
+			song.remove_measures(step.measureIndex, step.count);
+			break;
+		case edit_step_remove:
+			song.insert_measure_rows(step.measureIndex, step.rows);
+			break;
+		case edit_step_move:
+			song.move_measures(step.toIndex, step.count, step.measureIndex);
+			break;
+	}
+}
+
+void EditHistory::redo_step(GPFile &song, const EditStep &step) {
+	switch (step.type) {
+		case edit_step_change:
+			song.restore_measure(step.measureIndex, step.trackIndex, step.after);
+			break;
+		case edit_step_header:
+			song.restore_measure_header(step.measureIndex, step.headerAfter);
+			break;
+		case edit_step_insert:
+			song.insert_measure_rows(step.measureIndex, step.rows);
+			break;
+		case edit_step_remove:
+			song.remove_measures(step.measureIndex, step.count);
+			break;
+		case edit_step_move:
+			song.move_measures(step.measureIndex, step.count, step.toIndex);
+			break;
+	}
+}
+
+const EditCommand *EditHistory::undo(GPFile &song) {
+	if (this->undoCommands.empty() || this->isRecording) {
+		return nullptr;
+	}
+
+	EditCommand &command = this->undoCommands.back();
+	for (auto step = command.steps.rbegin(); step != command.steps.rend(); step++) {
+		undo_step(song, *step);
+	}
+	this->redoCommands.push_back(std::move(command));
+	this->undoCommands.pop_back();
+	return &this->redoCommands.back();
+}
+
+const EditCommand *EditHistory::redo(GPFile &song) {
+	if (this->redoCommands.empty() || this->isRecording) {
+		return nullptr;
+	}
+
+	EditCommand &command = this->redoCommands.back();
+	for (const EditStep &step : command.steps) {
+		redo_step(song, step);
+	}
+	this->undoCommands.push_back(std::move(command));
+	this->redoCommands.pop_back();
+	return &this->undoCommands.back();
+}
+
+void EditHistory::clear() {
+	this->undoCommands.clear();
+	this->redoCommands.clear();
+	this->current = EditCommand();
+	this->openSteps = 0;
+	this->isRecording = false;
+}
@@ -0,0 +1,94 @@
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "gp_file.hpp"
+
+enum EditStepType {
+	edit_step_change,	// a measure's contents
+	edit_step_header,	// a measure's header, its time signature, marker, repeats and so on
+	edit_step_insert,
+	edit_step_remove,
+	edit_step_move
+};
+
+// one thing a command did to the song
+// the measure versions and rows are shared with the song and with the commands before and after,
+// so the history only holds a copy of each measure for every command that changed it
+struct EditStep {
+	EditStepType type;
+	int measureIndex;
+	int trackIndex;	// measure changes only
+	int count;	// inserts, removes and moves
+	int toIndex;	// moves only
+
+	// changes, nullptr is the measure as it was read
+	std::shared_ptr<Measure> before;
+	std::shared_ptr<Measure> after;
+	std::shared_ptr<MeasureHeader> headerBefore;
+	std::shared_ptr<MeasureHeader> headerAfter;
+
+	// the inserted or removed measures
+	std::vector<MeasureRow> rows;
+};
+
+struct EditCommand {
+	std::string name;	// what the command did, to show next to undo and redo
+	std::vector<EditStep> steps;
+};
+
+// unlimited undo and redo of the edits to a song's measures
+// undoing or redoing a command only swaps the versions of the measures it changed and moves the rows
+// it inserted, removed or moved, whatever the size of the measures or the song
+// has to be cleared when the song is read again, the versions point into its file
+class EditHistory {
+	public:
+		// starts recording a command, its measures have to be changed through the functions below until commit
+		void begin(const std::string &name);
+		// the measure to change, the version before the command is kept the first time it's asked for
+		Measure &edit_measure(GPFile &song, int measureIndex, int trackIndex);
+		MeasureHeader &edit_measure_header(GPFile &song, int measureIndex);
+		// the same as GPFile's, but recorded
+		void insert_measures(GPFile &song, int measureIndex, int count);
+		void remove_measures(GPFile &song, int measureIndex, int count);
+		void move_measures(GPFile &song, int measureIndex, int count, int toIndex);
+		// finishes the command, it can't be redone once another command is committed
+		// commands that didn't change anything aren't kept
+		void commit(GPFile &song);
+		// puts the song back the way it was before begin
+		void cancel(GPFile &song);
+
+		bool recording() const { return this->isRecording; }
+		bool can_undo() const { return !this->undoCommands.empty(); }
+		bool can_redo() const { return !this->redoCommands.empty(); }
+		// the commands undo and redo would apply next, nullptr if there are none
+		const EditCommand *next_undo() const { return can_undo() ? &this->undoCommands.back() : nullptr; }
+		const EditCommand *next_redo() const { return can_redo() ? &this->redoCommands.back() : nullptr; }
+
+		// return the command that was undone or redone, so the caller knows which measures to show again
+		// and can hand it to TempoMap::update_edits, or nullptr if there was nothing to undo or redo
+		const EditCommand *undo(GPFile &song);
+		const EditCommand *redo(GPFile &song);
+
+		void clear();
+
+	private:
+		std::vector<EditCommand> undoCommands;
+		std::vector<EditCommand> redoCommands;
+
+		bool isRecording = false;
+		EditCommand current;
+		// the changes from here on don't have their after version yet,
+		// they're finished before measures move, since their indexes only hold until then
+		size_t openSteps = 0;
+
+		bool is_open_step(EditStepType type, int measureIndex, int trackIndex) const;
+		void finish_changes(GPFile &song);
+		void undo_step(GPFile &song, const EditStep &step);
+		void redo_step(GPFile &song, const EditStep &step);
+};
+
+#endif // !EDIT_HISTORY_H
@@ -1,3 +1,8 @@
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+
 #ifdef _WIN32
 	#include <curses.h>
 #else
@@ -8,399 +13,433 @@
 #include "gpedit.hpp"
 #include "gp_file.hpp"
 #include "windows.hpp"
+#include "tab_layout.hpp"
+#include "beat_index.hpp"
+#include "perf_hud.hpp"
+
+// the layouts of the track being edited, kept between calls to editTab as long as the same track is selected
+static std::unique_ptr<TrackLayout> trackLayout;
+// where the beats of that track are, built the first time a jump needs it
+static std::unique_ptr<BeatIndex> navigationIndex;
+
+// a chunk of the track is printed into the pad once, and scrolling only changes which part of it is shown
+// a wider chunk takes longer to print, and ncurses can't make pads much wider than a short anyway
+static const int maxPadWidth = 4096;
+
+static WINDOW *tabPad = nullptr;
+static int padWidth = 0;
+static int padFirstMeasure = 0;	// the pad holds the measures from padFirstMeasure up to, but not including, padEndMeasure
+static int padEndMeasure = 0;
+static std::vector<DisplayedBeat> padBeats;	// every beat in the pad in order, offsets are pad columns
+static std::vector<int> padMeasureOffsets;	// the pad column of the bar line that starts each measure, and then of the closing one
+// copies of the measures in the pad, so the beat info doesn't decode them again once a lazily read song has let them go
+static std::vector<Measure> padMeasures;
+
+// where the pad is shown in the tab window
+static const int padTop = 1;	// the tuplet row, followed by the durations and then the strings
+static const int padLeft = 4;
+static const int padRightMargin = 2;
+static int viewColumn = 0;	// the first pad column that's shown
+
+static int viewWidth() {
+	return std::max(getmaxx(tabDisplayWindow) - padLeft - padRightMargin, 1);
+}
+
+static int measureWidth(int measureIndex) {
+	int width = 2;	// bar line
+	for (const BeatLayout &layout : trackLayout->measure(measureIndex)) {
+		width += layout.width;
+	}
+	return width;
+}
+
+// prints a measure into the pad from the column of its bar line on, adds its beats to beats
+// and returns the column after it
+static int printPadMeasure(int measureIndex, int beatOffset, int stringCount, std::vector<DisplayedBeat> &beats) {
+	// the track continues before the pad
+	const char *barLine = (measureIndex == padFirstMeasure && measureIndex > 0) ? ":-" : "|-";
+	for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+		mvwaddstr(tabPad, 2+stringIndex, beatOffset, barLine);
+	}
+	beatOffset += 2;
+	
+	const std::vector<BeatLayout> &layouts = trackLayout->measure(measureIndex);
+	for (int beatIndex = 0; beatIndex < (int)layouts.size(); beatIndex++) {
+		const BeatLayout &layout = layouts[beatIndex];
+		
+		mvwaddstr(tabPad, 0, beatOffset, layout.tuplet.c_str());
+		mvwaddstr(tabPad, 1, beatOffset, layout.duration.c_str());
+		for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+			mvwhline(tabPad, 2+stringIndex, beatOffset, '-', layout.width);
+			mvwaddstr(tabPad, 2+stringIndex, beatOffset, layout.strings[stringIndex].c_str());
+		}
+		
+		beats.push_back(DisplayedBeat{ beatOffset, layout.width, measureIndex, beatIndex });
+		beatOffset += layout.width;
+	}
+	return beatOffset;
+}
 
-// the string tuning value is stored as an integer corresponding to its MIDI note value
-// the MIDI note value represents the number of semitones above the lowest note, C(-1)
-std::string getStringName(int tuningValue) {
-	std::string noteNames[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+// prints the measures around centerMeasure into the pad, as many as fit in maxPadWidth
+static void printTrackChunk(int centerMeasure) {
+	auto startTime = std::chrono::steady_clock::now();
+	const TrackHeader &track = song.trackHeaders[trackIndex];
+	int stringCount = std::min(track.stringCount, 7);
+	
+	// half of the chunk comes before the center measure, so scrolling back doesn't immediately need a new one
+	int firstMeasure = centerMeasure;
+	int chunkWidth = measureWidth(centerMeasure);
+	while (firstMeasure > 0 && chunkWidth + measureWidth(firstMeasure-1) < maxPadWidth/2) {
+		firstMeasure--;
+		chunkWidth += measureWidth(firstMeasure);
+	}
+	int endMeasure = centerMeasure+1;
+	while (endMeasure < song.measureCount && chunkWidth + measureWidth(endMeasure) < maxPadWidth) {
+		chunkWidth += measureWidth(endMeasure);
+		endMeasure++;
+	}
+	chunkWidth++;	// closing bar line
+	
+	int width = std::max(chunkWidth, viewWidth());
+	if (tabPad == nullptr || width != padWidth || getmaxy(tabPad) != stringCount+2) {
+		if (tabPad != nullptr) {
+			delwin(tabPad);
+		}
+		tabPad = newpad(stringCount+2, width);
+		padWidth = width;
+	}
+	werase(tabPad);
 	
-	int noteIndex = tuningValue % 12;
-	int octave = (tuningValue / 12) - 1;
+	padFirstMeasure = firstMeasure;
+	padEndMeasure = endMeasure;
+	padBeats.clear();
+	padMeasureOffsets.clear();
+	padMeasures.clear();
 	
-	return noteNames[noteIndex] + std::to_string(octave);
+	int beatOffset = 0;
+	for (int measureIndex = firstMeasure; measureIndex < endMeasure; measureIndex++) {
+		padMeasureOffsets.push_back(beatOffset);
+		beatOffset = printPadMeasure(measureIndex, beatOffset, stringCount, padBeats);
+		// the layout may have decoded other measures, so the measure is only asked for after it
+		padMeasures.push_back(song.get_measure(measureIndex, trackIndex));
+	}
+	padMeasureOffsets.push_back(beatOffset);
+	
+	// the end of the song gets a plain bar line, anywhere else the track goes on after the pad
+	const char *ending = endMeasure >= song.measureCount ? "|" : ":";
+	for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+		mvwaddstr(tabPad, 2+stringIndex, beatOffset, ending);
+	}
+	editorTimings.trackChunks.add(millisecondsSince(startTime));
+}
+
+// the index of the first beat in the pad at or after the given one, padBeats.size() if there is none
+static int findPadBeat(int measureIndex, int beatIndex) {
+	auto found = std::lower_bound(padBeats.begin(), padBeats.end(), std::make_pair(measureIndex, beatIndex),
+		[](const DisplayedBeat &beat, const std::pair<int, int> &position) {
+			return std::make_pair(beat.measureIndex, beat.beatIndex) < position;
+		});
+	return found - padBeats.begin();
+}
+
+// prints a new chunk if the measure isn't in the pad, and returns the index of the beat in the pad
+static int showBeat(int measureIndex, int beatIndex) {
+	if (tabPad == nullptr || measureIndex < padFirstMeasure || measureIndex >= padEndMeasure) {
+		printTrackChunk(measureIndex);
+	}
+	return std::min(findPadBeat(measureIndex, beatIndex), (int)padBeats.size()-1);
 }
 
-std::vector<DisplayedBeat> printBeats(int startingMeasure = 0, int startingBeat = 0) {
-	TrackHeader track = song.trackHeaders[trackIndex];
-	
-	int leftMargin = 1;
-	int rightMargin = 2;
-	int topMargin = 3;
-	// int bottomMargin = 1;
-	
-	// print string names
-	std::string stringBeginning;
-	if (startingBeat != 0) {
-		stringBeginning = ":-";
+// moves the view as little as possible to get the whole beat in it
+static void scrollToBeat(const DisplayedBeat &beat) {
+	if (beat.beatOffset < viewColumn) {
+		viewColumn = beat.beatOffset;
 	}
-	else if (startingMeasure != 0) {
-		stringBeginning = ":|-";
+	else if (beat.beatOffset + beat.beatWidth > viewColumn + viewWidth()) {
+		viewColumn = beat.beatOffset + beat.beatWidth - viewWidth();
 	}
-	else {
-		stringBeginning = "|-";
+}
+
+// copies the visible part of the pad to the screen
+static void refreshPad() {
+	viewColumn = std::max(std::min(viewColumn, padWidth - viewWidth()), 0);
+	
+	int top = getbegy(tabDisplayWindow) + padTop;
+	int left = getbegx(tabDisplayWindow) + padLeft;
+	wnoutrefresh(tabDisplayWindow);
+	pnoutrefresh(tabPad, 0, viewColumn, top, left, top + getmaxy(tabPad)-1, left + viewWidth()-1);
+	doupdate();
+}
+
+// the selection, kept between frames
+static int selectionIndex = -1;	// index into padBeats, -1 if the track has nothing to select
+static int selectedString = 0;
+
+static const BeatIndex &getNavigationIndex() {
+	if (!navigationIndex || navigationIndex->track_index() != trackIndex) {
+		navigationIndex = std::make_unique<BeatIndex>(song, trackIndex);
 	}
-	for (int stringIndex = 0; stringIndex < track.stringCount; stringIndex++) {
-		mvwprintw(tabDisplayWindow, stringIndex+topMargin, leftMargin, "%s", getStringName(track.stringTuning[stringIndex]).c_str());
-		mvwprintw(tabDisplayWindow, stringIndex+topMargin, 4, "%s", stringBeginning.c_str());
+	return *navigationIndex;
+}
+
+// selects a beat anywhere in the track, with its measure at the left of the view
+static void jumpToBeat(BeatPosition position) {
+	selectionIndex = showBeat(position.measureIndex, position.beatIndex);
+	viewColumn = padMeasureOffsets[position.measureIndex - padFirstMeasure];
+}
+
+// reads a line of input on the bottom border of the tab window, returns false if nothing was entered
+static bool readPrompt(const char *prompt, char *input, int size) {
+	int line = getmaxy(tabDisplayWindow)-1;
+	mvwprintw(tabDisplayWindow, line, 1, "%s", prompt);
+	
+	echo();
+	curs_set(1);
+	wgetnstr(tabDisplayWindow, input, size-1);
+	noecho();
+	curs_set(0);
+	
+	mvwhline(tabDisplayWindow, line, 1, ACS_HLINE, getmaxx(tabDisplayWindow)-2);
+	return input[0] != '\0';
+}
+
+// "N" goes to the first beat of measure N, "N:B" to beat B of it
+static void goToMeasure() {
+	char input[32];
+	if (!readPrompt("Go to measure[:beat]: ", input, sizeof(input))) {
+		return;
 	}
-	leftMargin = getcurx(tabDisplayWindow);
 	
-	int xMax = getmaxx(tabDisplayWindow) - rightMargin;
+	int measureNumber = 0;
+	int beatNumber = 1;
+	if (std::sscanf(input, "%d:%d", &measureNumber, &beatNumber) < 1) {
+		return;
+	}
 	
-	// print tab base
-	std::string stringBase = std::string(xMax-leftMargin - 1, '-').append(":");
-	for (int stringIndex = 0; stringIndex < track.stringCount; stringIndex++) {
-		mvwprintw(tabDisplayWindow, topMargin+stringIndex, leftMargin, "%s", stringBase.c_str());
+	const BeatIndex &index = getNavigationIndex();
+	int measureIndex = std::max(std::min(measureNumber-1, song.measureCount-1), 0);
+	int measureBeats = index.measure_first_beat(measureIndex+1) - index.measure_first_beat(measureIndex);
+	int beatIndex = std::max(std::min(beatNumber-1, measureBeats-1), 0);
+	jumpToBeat(BeatPosition{ measureIndex, beatIndex });
+}
+
+// "M:SS" or a number of seconds goes to the beat playing at that time
+static void goToTime() {
+	char input[32];
+	if (!readPrompt("Go to time [m:]ss: ", input, sizeof(input))) {
+		return;
 	}
-	std::string durationClear = std::string(xMax-leftMargin, ' ');
-	mvwprintw(tabDisplayWindow, topMargin-2, leftMargin-1, "%s", durationClear.c_str());
-	mvwprintw(tabDisplayWindow, topMargin-1, leftMargin-1, "%s", durationClear.c_str());
 	
-	std::vector<DisplayedBeat> displayedBeats;
+	int minutes = 0;
+	double seconds = 0;
+	if (std::sscanf(input, "%d:%lf", &minutes, &seconds) == 2) {
+		seconds += minutes*60;
+	}
+	else if (std::sscanf(input, "%lf", &seconds) != 1) {
+		return;
+	}
 	
-	int measureIndex = startingMeasure;
-	int beatIndex = startingBeat;
-	Measure measure = song.measures[measureIndex][trackIndex];
+	// the tempo map counts ticks from the time signatures, the track's own ticks can drift from them
+	// if its measures aren't full, so only the offset into the measure is taken from it
+	long long tick = tempoMap.seconds_to_tick(seconds);
+	int measureIndex = tempoMap.measure_at_tick(tick);
+	const BeatIndex &index = getNavigationIndex();
+	jumpToBeat(index.beat_at_tick(index.measure_tick(measureIndex) + tick - tempoMap.measure_tick(measureIndex)));
+}
+
+// prints a measure again where it is in the pad, returns false if its width changed and it doesn't fit there anymore
+static bool reprintPadMeasure(int measureIndex, int stringCount) {
+	int start = padMeasureOffsets[measureIndex - padFirstMeasure];
+	int end = padMeasureOffsets[measureIndex+1 - padFirstMeasure];
+	if (measureWidth(measureIndex) != end - start) {
+		return false;
+	}
 	
-	int beatOffset = leftMargin;	// the cursor position at the start of the current beat (or other printed section, such as bar lines)
-	wmove(tabDisplayWindow, 0, beatOffset);
+	for (int row = 0; row < stringCount+2; row++) {
+		mvwhline(tabPad, row, start, ' ', end - start);
+	}
+	std::vector<DisplayedBeat> beats;
+	printPadMeasure(measureIndex, start, stringCount, beats);
+	padMeasures[measureIndex - padFirstMeasure] = song.get_measure(measureIndex, trackIndex);
 	
-	// print beats as long as there is room left
-	while (getcurx(tabDisplayWindow)+6 < xMax) {
-		Beat beat = measure.beats[beatIndex];
-		
-		beatOffset = getcurx(tabDisplayWindow);
-				
-		std::string beatDuration;
-		switch (beat.duration) {
-			case gp_duration_whole:
-				beatDuration = "w";
-				break;
-			case gp_duration_half:
-				beatDuration = "h";
-				break;
-			case gp_duration_quarter:
-				beatDuration = "q";
-				break;
-			case gp_duration_eighth:
-				beatDuration = "e";
-				break;
-			case gp_duration_sixteenth:
-				beatDuration = "s";
-				break;
-			case gp_duration_thirty_second:
-				beatDuration = "t";
-				break;
-			case gp_duration_sixty_fourth:
-				beatDuration = "S";
-				break;
-		}
-		if (beat.beatFlags & gp_beat_is_dotted) {
-			beatDuration.append(".");
-		}
-		if (beat.beatFlags & gp_beat_is_tuplet) {
-			mvwprintw(tabDisplayWindow, topMargin-2, beatOffset, "%s", std::to_string(beat.tupletDivision).c_str());
-		}
-		mvwprintw(tabDisplayWindow, topMargin-1, beatOffset, "%s", beatDuration.c_str());
-		
-		int maxBeatWidth = 0;	// keeps track of the maximum printed width of the beat
-		int beatWidth;	// printed beat width of current string
-		
-		for (int stringIndex = 0; stringIndex < track.stringCount; stringIndex++) {	// loop through the strings
-			// set cursor position to start of beat, on current string
-			wmove(tabDisplayWindow, topMargin+stringIndex, beatOffset);
-			beatWidth = 1;
-			
-			if (beat.beatNotes.stringsPlayed & (0x40 >> stringIndex)) {	// check if string is played
-				Note note = beat.beatNotes.strings[stringIndex];	
-				
-				if (note.noteFlags & gp_note_is_ghost) {
-					wprintw(tabDisplayWindow, "(");
-					beatWidth++;
-				}
-				
-				if (note.noteType == gp_notetype_dead) {
-					wprintw(tabDisplayWindow, "x");
-					beatWidth++;
-				}
-				else if (note.noteType == gp_notetype_tied) {
-					wprintw(tabDisplayWindow, "*");
-					beatWidth++;
-				}
-				else {	// note.noteType = gp_notetype_normal
-					std::string fret = std::to_string(note.fretNumber);
-					wprintw(tabDisplayWindow, "%s", fret.c_str());
-					beatWidth += fret.length();
-				}
-				
-				if (note.noteFlags & gp_note_is_ghost) {
-					wprintw(tabDisplayWindow, ")");
-					beatWidth++;
-				}
-				
-				if (note.noteFlags & gp_note_is_accent) {
-					wprintw(tabDisplayWindow, ">");
-					beatWidth++;
-				}
-				
-				if (note.noteFlags & gp_note_is_heavy_accent) {
-					wprintw(tabDisplayWindow, "t^");
-					beatWidth++;
-				}
-				
-				if (beat.beatFlags & gp_beat_has_effects) {
-					if (beat.effects.beatEffectFlags & gp_beatfx_vibrato) {
-						wprintw(tabDisplayWindow, "~");
-						beatWidth++;
-					}
-					
-					if (beat.effects.beatEffectFlags & gp_beatfx_natural_harmonic) {
-						wprintw(tabDisplayWindow, "+");
-						beatWidth++;
-					}
-					
-					if (beat.effects.beatEffectFlags & gp_beatfx_tremolo_or_tap) {
-						switch (beat.effects.tremoloOrTap) {
-							case 0:	// tremolo bar
-								wprintw(tabDisplayWindow, "v");
-								beatWidth++;
-								break;
-							case 1:	// tap
-								wprintw(tabDisplayWindow, "t");
-								beatWidth++;
-								break;
-							case 2:	// slap
-								wprintw(tabDisplayWindow, "s");
-								beatWidth++;
-								break;
-							case 3:	// pop
-								wprintw(tabDisplayWindow, "P");
-								beatWidth++;
-								break;
-						}
-					}
-				}
-				
-				if (note.noteFlags & gp_note_has_effects) {
-					if (note.noteEffectFlags & gp_notefx_bend) {
-						switch (note.noteBend.type) {
-							case gp_bendtype_bend:
-								wprintw(tabDisplayWindow, "b");
-								beatWidth++;
-								break;
-							case gp_bendtype_bend_release:
-								wprintw(tabDisplayWindow, "br");
-								beatWidth += 2;
-								break;
-							case gp_bendtype_bend_release_bend:
-								wprintw(tabDisplayWindow, "brb");
-								beatWidth += 3;
-								break;
-							case gp_bendtype_prebend:
-								wprintw(tabDisplayWindow, "pb");
-								beatWidth += 2;
-								break;
-							case gp_bendtype_prebend_release:
-								wprintw(tabDisplayWindow, "pbr");
-								beatWidth += 3;
-								break;
-							default:
-								break;
-						}
-					}
-					
-					if (note.noteEffectFlags & gp_notefx_hammer_pull) {
-						Note followingNote;
-						if (beatIndex+1 < measure.beatCount) {
-							followingNote = measure.beats[beatIndex + 1].beatNotes.strings[stringIndex];
-						}
-						else {
-							followingNote = song.measures[measureIndex+1][trackIndex].beats[0].beatNotes.strings[stringIndex];
-						}
-						
-						if (followingNote.fretNumber < note.fretNumber) {
-							wprintw(tabDisplayWindow, "p");
-						}
-						else {
-							wprintw(tabDisplayWindow, "h");
-						}
-						// beatWidth is not incremented, cause there shouldn't be any space before the next note
-					}
-					
-					if (note.noteEffectFlags & gp_notefx_slide) {
-						Note followingNote;
-						if (beatIndex+1 < measure.beatCount) {
-							followingNote = measure.beats[beatIndex + 1].beatNotes.strings[stringIndex];
-						}
-						else {
-							followingNote = song.measures[measureIndex+1][trackIndex].beats[0].beatNotes.strings[stringIndex];
-						}
-						
-						if (followingNote.fretNumber < note.fretNumber) {
-							wprintw(tabDisplayWindow, "\\");
-						}
-						else {
-							wprintw(tabDisplayWindow, "/");
-						}
-						// beatWidth is not incremented, cause there shouldn't be any space before the next note
-					}
-					
-					if (note.noteEffectFlags & gp_notefx_let_ring) {
-						// TODO: figure something out
-					}
-					
-					if (note.noteEffectFlags & gp_notefx_grace_note) {
-						// TODO: figure something out
-						// being a grace note is not a property of a note,
-						// but rather a grace note is attatched to the note it preceeds,
-						// meaning it has to be printed before it
-					}
-				}
-			}
-			else {	// string is not played
-				beatWidth++;
+	// the same width can hold a different number of beats
+	int first = findPadBeat(measureIndex, 0);
+	int last = findPadBeat(measureIndex+1, 0);
+	padBeats.erase(padBeats.begin() + first, padBeats.begin() + last);
+	padBeats.insert(padBeats.begin() + first, beats.begin(), beats.end());
+	return true;
+}
+
+// selects the beat that's where the selected one was before the song changed
+static void restoreSelection(int measureIndex, int beatIndex, int stringIndex) {
+	measureIndex = std::min(measureIndex, song.measureCount-1);
+	int beatCount = trackLayout->measure(measureIndex).size();
+	selectionIndex = showBeat(measureIndex, std::max(std::min(beatIndex, beatCount-1), 0));
+	selectedString = std::max(std::min(stringIndex, std::min(song.trackHeaders[trackIndex].stringCount, 7) - 1), 0);
+}
+
+void updateTabView(const SongChanges &changes) {
+	// the layouts are kept while the view is closed, so they're updated either way
+	std::vector<int> changedMeasures;
+	if (changes.everything) {
+		trackLayout.reset();
+		navigationIndex.reset();
+	}
+	else if (trackLayout) {
+		for (const MeasureChange &change : changes.measures) {
+			if (std::binary_search(change.tracks.begin(), change.tracks.end(), trackLayout->track_index())) {
+				trackLayout->invalidate_measure(change.measureIndex);
+				changedMeasures.push_back(change.measureIndex);
 			}
-			
-			maxBeatWidth = beatWidth > maxBeatWidth ? beatWidth : maxBeatWidth;
 		}
-		
-		displayedBeats.push_back(DisplayedBeat{ beatOffset, maxBeatWidth, measureIndex, beatIndex });
-		
-		wmove(tabDisplayWindow, 0, beatOffset+maxBeatWidth);
-		
-		if (beatIndex+1 >= measure.beatCount) {	// check if end of measure reached	
-			if (measureIndex+1 >= song.measureCount) {	// check if end of song reached
-				// clear the rest of the tab area
-				beatOffset = getcurx(tabDisplayWindow);
-				std::string clearString = "|";
-				clearString.append(std::string(xMax-beatOffset, ' '));
-				for (int stringIndex = 0; stringIndex < track.stringCount; stringIndex++) {
-					mvwprintw(tabDisplayWindow, topMargin+stringIndex, beatOffset, "%s", clearString.c_str());
-				}
-				wrefresh(tabDisplayWindow);
-				return displayedBeats;
-			}
-			
-			beatIndex = 0;
-			measureIndex++;
-			
-			// measure index has changed, so get the new measure object
-			measure = song.measures[measureIndex][trackIndex];
-			
-			// print bar line
-			beatOffset = getcurx(tabDisplayWindow);
-			for (int stringIndex = 0; stringIndex < track.stringCount; stringIndex++) {
-				mvwprintw(tabDisplayWindow, topMargin+stringIndex, beatOffset, "|-");
-			}
+		if (!changedMeasures.empty()) {
+			navigationIndex.reset();
 		}
-		else {
-			beatIndex++;
+	}
+	
+	if (tabPad == nullptr || selectionIndex < 0) {
+		return;
+	}
+	DisplayedBeat selectedBeat = padBeats[selectionIndex];
+	mvwchgat(tabPad, 2+selectedString, selectedBeat.beatOffset, selectedBeat.beatWidth-1, A_NORMAL, 0, NULL);
+	// the selected measure stays where it is on the screen
+	int screenColumn = padMeasureOffsets[selectedBeat.measureIndex - padFirstMeasure] - viewColumn;
+	
+	if (changes.everything) {
+		// the track's name and strings may have changed too
+		int stringIndex = selectedString;
+		closeTabView();
+		openTabView();
+		if (selectionIndex >= 0) {
+			restoreSelection(selectedBeat.measureIndex, selectedBeat.beatIndex, stringIndex);
+			viewColumn = padMeasureOffsets[padBeats[selectionIndex].measureIndex - padFirstMeasure] - screenColumn;
 		}
+		return;
 	}
 	
-	wrefresh(tabDisplayWindow);
-	return displayedBeats;
+	// the measure before a changed one is printed again too, its last beat looks ahead into the changed one
+	int stringCount = std::min(song.trackHeaders[trackIndex].stringCount, 7);
+	bool fits = true;
+	for (int changedMeasure : changedMeasures) {
+		int measureIndex = std::max(changedMeasure-1, padFirstMeasure);
+		for (; measureIndex <= changedMeasure && measureIndex < padEndMeasure && fits; measureIndex++) {
+			fits = reprintPadMeasure(measureIndex, stringCount);
+		}
+	}
+	if (!fits) {
+		printTrackChunk(selectedBeat.measureIndex);
+		viewColumn = padMeasureOffsets[selectedBeat.measureIndex - padFirstMeasure] - screenColumn;
+	}
+	restoreSelection(selectedBeat.measureIndex, selectedBeat.beatIndex, selectedString);
 }
 
-void editTab() {
+void openTabView() {
 	initTabDisplay();
 	
-	TrackHeader track = song.trackHeaders[trackIndex];
+	if (!trackLayout || trackLayout->track_index() != trackIndex) {
+		trackLayout = std::make_unique<TrackLayout>(song, trackIndex);
+		navigationIndex.reset();
+	}
+	
+	const TrackHeader &track = song.trackHeaders[trackIndex];
+	int stringCount = std::min(track.stringCount, 7);
 	
-	int startingMeasure = 0;
-	int startingBeat = 0;
+	// the string names stay where they are while the pad scrolls next to them
+	for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+		mvwprintw(tabDisplayWindow, padTop+2+stringIndex, 1, "%s", getStringName(track.stringTuning[stringIndex]).c_str());
+	}
 	
-	std::vector<DisplayedBeat> displayedBeats;
-	displayedBeats = printBeats(startingMeasure, startingBeat);
+	viewColumn = 0;
+	selectionIndex = song.measureCount > 0 ? showBeat(0, 0) : -1;
+	selectedString = 0;
 	
 	// allow reading non-character keypresses
 	keypad(tabDisplayWindow, true);
+}
+
+bool drawTabFrame() {
+	if (selectionIndex < 0) {
+		return false;
+	}
+	auto startTime = std::chrono::steady_clock::now();
+	const DisplayedBeat &selectedBeat = padBeats[selectionIndex];
 	
-	int selectionIndex = 0;
-	int stringIndex = 0;
+	// mark selected note, the '-' separating it from the next beat isn't part of it
+	mvwchgat(tabPad, 2+selectedString, selectedBeat.beatOffset, selectedBeat.beatWidth-1, A_REVERSE, 0, NULL);
+	scrollToBeat(selectedBeat);
+	refreshPad();
 	
-	while (true) {
-		DisplayedBeat selectedBeat = displayedBeats[selectionIndex];
-		
-		// mark selected note
-		char* selection = (char*)malloc(sizeof(char) * selectedBeat.beatWidth-1);
-		mvwinnstr(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, selection, selectedBeat.beatWidth-1);
-		wattron(tabDisplayWindow, A_REVERSE);
-		mvwprintw(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, "%s", selection);
-		wattroff(tabDisplayWindow, A_REVERSE);
-		wrefresh(tabDisplayWindow);
-		
-		Beat beat = song.measures[selectedBeat.measureIndex][trackIndex].beats[selectedBeat.beatIndex];
-		
-		printBeatInfo(selectedBeat, stringIndex);
-		
-		keyboardInput = wgetch(tabDisplayWindow);
-		
-		switch (keyboardInput) {
-			case KEY_LEFT:
-				if (selectionIndex > 0) {
-					mvwprintw(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, "%s", selection);
-					selectionIndex--;
-				}
-				else if (selectedBeat.beatIndex > 0) {
-					startingBeat--;
-					displayedBeats = printBeats(startingMeasure, startingBeat);
-				}
-				else if (selectedBeat.measureIndex > 0) {
-					startingMeasure--;
-					startingBeat = song.measures[startingMeasure][trackIndex].beatCount-1;
-					displayedBeats = printBeats(startingMeasure, startingBeat);
-				}
-				break;
-			case KEY_RIGHT:
-				if ((unsigned int)selectionIndex < displayedBeats.size() - 1) {
-					mvwprintw(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, "%s", selection);
-					selectionIndex++;
-				}
-				else if (startingBeat < song.measures[startingMeasure][trackIndex].beatCount-1) {
-					startingBeat++;
-					displayedBeats = printBeats(startingMeasure, startingBeat);
-					selectionIndex = displayedBeats.size()-1;
-				}
-				else if (startingMeasure < song.measureCount-2) {
-					startingMeasure++;
-					startingBeat = 0;
-					displayedBeats = printBeats(startingMeasure, startingBeat);
-					selectionIndex = displayedBeats.size()-1;
-				}
-				break;
-			case KEY_UP:
-				if (stringIndex > 0) {
-					mvwprintw(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, "%s", selection);
-					stringIndex--;
-				}
-				break;
-			case KEY_DOWN:
-				if (stringIndex < track.stringCount - 1) {
-					mvwprintw(tabDisplayWindow, stringIndex+3, selectedBeat.beatOffset, "%s", selection);
-					stringIndex++;
-				}
-				break;
-			case KEY_SLEFT:
-				if (startingMeasure > 0) {
-					startingMeasure--;
-					displayedBeats = printBeats(startingMeasure, 0);
-				}
-				break;
-			case KEY_SRIGHT:
-				if (startingMeasure < song.measureCount-2) {
-					startingMeasure++;
-					displayedBeats = printBeats(startingMeasure, 0);
-					if ((unsigned int)selectionIndex > displayedBeats.size()-1) {
-						selectionIndex = displayedBeats.size()-1;
-					}
-				}
-				break;
-		}
-		if (keyboardInput == 27) {
+	printBeatInfo(selectedBeat, padMeasures[selectedBeat.measureIndex - padFirstMeasure], selectedString);
+	frameDrawn(startTime);
+	return true;
+}
+
+void handleTabKey(int key) {
+	if (selectionIndex < 0) {
+		return;
+	}
+	const DisplayedBeat &selectedBeat = padBeats[selectionIndex];
+	
+	mvwchgat(tabPad, 2+selectedString, selectedBeat.beatOffset, selectedBeat.beatWidth-1, A_NORMAL, 0, NULL);
+	int measureIndex = selectedBeat.measureIndex;
+	int stringCount = std::min(song.trackHeaders[trackIndex].stringCount, 7);
+	
+	switch (key) {
+		case KEY_LEFT:
+			if (selectionIndex > 0) {
+				selectionIndex--;
+			}
+			else if (padFirstMeasure > 0) {
+				// the last beat before the pad
+				int previousMeasure = padFirstMeasure-1;
+				showBeat(previousMeasure, 0);
+				selectionIndex = std::max(findPadBeat(previousMeasure+1, 0) - 1, 0);
+			}
+			break;
+		case KEY_RIGHT:
+			if (selectionIndex+1 < (int)padBeats.size()) {
+				selectionIndex++;
+			}
+			else if (padEndMeasure < song.measureCount) {
+				selectionIndex = showBeat(padEndMeasure, 0);
+			}
+			break;
+		case KEY_UP:
+			if (selectedString > 0) {
+				selectedString--;
+			}
+			break;
+		case KEY_DOWN:
+			if (selectedString < stringCount - 1) {
+				selectedString++;
+			}
+			break;
+		case KEY_SLEFT:
+			if (measureIndex > 0) {
+				selectionIndex = showBeat(measureIndex-1, 0);
+				viewColumn = padMeasureOffsets[measureIndex-1 - padFirstMeasure];
+			}
+			break;
+		case KEY_SRIGHT:
+			if (measureIndex+1 < song.measureCount) {
+				selectionIndex = showBeat(measureIndex+1, 0);
+				viewColumn = padMeasureOffsets[measureIndex+1 - padFirstMeasure];
+			}
+			break;
+		case 'g':
+			goToMeasure();
+			break;
+		case 't':
+			goToTime();
 			break;
-		}
 	}
+}
+
+void closeTabView() {
+	delwin(tabPad);
+	tabPad = nullptr;
+	// their strings can point into the file of a song that's been read again since
+	padMeasures.clear();
 	
 	wclear(beatInfoWindow);
 	wrefresh(beatInfoWindow);
@@ -411,4 +450,18 @@ void editTab() {
 	delwin(tabDisplayWindow);
 	
 	refresh();
-}
\ No newline at end of file
+}
+
+void editTab() {
+	openTabView();
+	
+	while (drawTabFrame()) {
+		keyboardInput = waitForKey(tabDisplayWindow);
+		if (keyboardInput == 27) {
+			break;
+		}
+		handleTabKey(keyboardInput);
+	}
+	
+	closeTabView();
+}
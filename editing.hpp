@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "tab_layout.hpp"
+#include "song_reload.hpp"
+
 #ifdef _WIN32
 	#include <curses.h>
 #else
@@ -11,14 +14,22 @@
 #endif
 
 struct DisplayedBeat {
-	int beatOffset;
+	int beatOffset;	// column in the tab pad
 	int beatWidth;
 	int measureIndex;
 	int beatIndex;
 };
 
-std::string getStringName(int tuningValue);
-std::vector<DisplayedBeat> printBeats(int startingMeasure, int startingBeat);
+// the tab view, split up so it can also be driven without a keyboard
+void openTabView();
+// draws the selection and the beat info, returns false if there's nothing to select
+bool drawTabFrame();
+void handleTabKey(int key);
+void closeTabView();
+// call after the song has been read again, only the measures that changed are laid out and printed again
+void updateTabView(const SongChanges &changes);
+
+// opens the tab view and handles keypresses until escape is pressed
 void editTab();
 
 #endif // !EDITING_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include <filesystem>
+
+#ifndef _WIN32
+	#include <unistd.h>
+	#include <sys/inotify.h>
+#endif
+
+#include "file_watcher.hpp"
+
+FileWatcher::~FileWatcher() {
+	close();
+}
+
+#ifdef _WIN32
+static long long getWriteTime(const std::string &filePath) {
+	std::error_code error;
+	auto time = std::filesystem::last_write_time(filePath, error);
+	return error ? 0 : (long long)time.time_since_epoch().count();
+}
+
+int FileWatcher::watch(const std::string &filePath) {
+	this->filePath = filePath;
+	this->writeTime = getWriteTime(filePath);
+	return this->writeTime == 0 ? 1 : 0;
+}
+
+void FileWatcher::close() {
+	this->filePath.clear();
+	this->writeTime = 0;
+}
+
+bool FileWatcher::changed() {
+	if (this->filePath.empty()) {
+		return false;
+	}
+	// a file that's missing for a moment is being replaced, it's looked at again next time
+	long long writeTime = getWriteTime(this->filePath);
+	if (writeTime == 0 || writeTime == this->writeTime) {
+		return false;
+	}
+	this->writeTime = writeTime;
+	return true;
+}
+#else
+int FileWatcher::watch(const std::string &filePath) {
+	close();
+
+	std::filesystem::path path(filePath);
+	std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+	this->inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (this->inotifyDescriptor < 0) {
+		return 1;
+	}
+	// a write is only done once the file is closed, or another file has been moved over it
+	if (inotify_add_watch(this->inotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close();
+		return 1;
+	}
+
+	this->fileName = path.filename().string();
+	return 0;
+}
+
+void FileWatcher::close() {
+	if (this->inotifyDescriptor >= 0) {
+		::close(this->inotifyDescriptor);
+	}
+	this->inotifyDescriptor = -1;
+	this->fileName.clear();
+}
+
+bool FileWatcher::changed() {
+	if (this->inotifyDescriptor < 0) {
+		return false;
+	}
+
+	// every event waiting is read, so a burst of writes only counts once
+	bool fileChanged = false;
+	alignas(inotify_event) char events[4096];
+	while (true) {
+		ssize_t length = read(this->inotifyDescriptor, events, sizeof(events));
+		if (length <= 0) {
+			break;
+		}
+		for (ssize_t offset = 0; offset < length; ) {
+			const inotify_event *event = (const inotify_event *)(events + offset);
+			if (event->len > 0 && this->fileName == event->name) {
+				fileChanged = true;
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+	return fileChanged;
+}
+#endif
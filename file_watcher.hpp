@@ -0,0 +1,35 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+
+// tells when another program has finished writing a file
+// the directory is watched rather than the file, since programs often save by writing
+// a new file and renaming it over the old one, which a watch on the old file wouldn't see
+// on windows the modification time is compared instead
+class FileWatcher {
+	public:
+		FileWatcher() = default;
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher &) = delete;
+		FileWatcher &operator=(const FileWatcher &) = delete;
+
+		// returns 1 if the file can't be watched
+		int watch(const std::string &filePath);
+		void close();
+
+		// whether the file has been written since the last call, never blocks
+		bool changed();
+
+	private:
+#ifdef _WIN32
+		std::string filePath;
+		long long writeTime = 0;
+#else
+		std::string fileName;
+		int inotifyDescriptor = -1;
+#endif
+};
+
+#endif // !FILE_WATCHER_H
@@ -0,0 +1,126 @@
+#ifndef GP_ALLOC_H
+#define GP_ALLOC_H
+
+#include <memory_resource>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+
+namespace gp_alloc
+{
+	// forwards to another memory resource, counting what goes through it
+	// the counters are atomic, so it can be shared between threads if the upstream resource can
+	class CountingResource : public std::pmr::memory_resource {
+		public:
+			std::atomic<size_t> allocations{0};
+			std::atomic<size_t> deallocations{0};
+			std::atomic<size_t> bytesInUse{0};
+
+			CountingResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) : upstream(upstream) { }
+
+		private:
+			std::pmr::memory_resource *upstream;
+
+			void *do_allocate(size_t bytes, size_t alignment) override {
+				void *pointer = upstream->allocate(bytes, alignment);
+				allocations++;
+				bytesInUse += bytes;
+				return pointer;
+			}
+			void do_deallocate(void *pointer, size_t bytes, size_t alignment) override {
+				upstream->deallocate(pointer, bytes, alignment);
+				deallocations++;
+				bytesInUse -= bytes;
+			}
+			bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+				return this == &other;
+			}
+	};
+
+	// what a GPFile allocates its structures from
+	// normally every allocation goes straight to the heap, but after use_arena() they come
+	// from a few large blocks instead, which are all freed at once by release_arena()
+	// either way the heap allocations are counted by `heap`
+	class SongMemory : public std::pmr::memory_resource {
+		public:
+			CountingResource heap;
+
+			// starts allocating from an arena, with a first block of the given size
+			void use_arena(size_t initialSize) {
+				arena = std::make_unique<std::pmr::monotonic_buffer_resource>(initialSize, &heap);
+			}
+			// another arena for a thread to allocate from while the main one is used by another,
+			// it's freed along with the main one
+			std::pmr::memory_resource *add_arena(size_t initialSize) {
+				threadArenas.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>(initialSize, &heap));
+				return threadArenas.back().get();
+			}
+			// frees everything allocated from the arenas,
+			// nothing allocated from them can be used after this
+			void release_arena() {
+				arena.reset();
+				threadArenas.clear();
+			}
+			bool has_arena() const { return arena != nullptr; }
+
+		private:
+			std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+			std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> threadArenas;
+
+			void *do_allocate(size_t bytes, size_t alignment) override {
+				return arena ? arena->allocate(bytes, alignment) : heap.allocate(bytes, alignment);
+			}
+			void do_deallocate(void *pointer, size_t bytes, size_t alignment) override {
+				if (arena) {
+					arena->deallocate(pointer, bytes, alignment);	// doesn't do anything
+				}
+				else {
+					heap.deallocate(pointer, bytes, alignment);
+				}
+			}
+			bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+				return this == &other;
+			}
+	};
+
+	// an allocator on a memory resource that, unlike std::pmr::polymorphic_allocator,
+	// moves along with the container it belongs to
+	// the song structures are built by assigning returned values (note.noteBend = read_bend(...)),
+	// and a plain std::pmr container would copy the elements into the target's memory instead.
+	// copies still go to the default resource, so copying a measure out of a song doesn't grow its arena
+	template <typename T>
+	struct allocator {
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::false_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+
+		allocator() noexcept { }
+		allocator(std::pmr::memory_resource *resource) noexcept : resource(resource) { }
+		template <typename U>
+		allocator(const allocator<U> &other) noexcept : resource(other.resource) { }
+
+		T *allocate(size_t count) {
+			return static_cast<T *>(resource->allocate(count * sizeof(T), alignof(T)));
+		}
+		void deallocate(T *pointer, size_t count) {
+			resource->deallocate(pointer, count * sizeof(T), alignof(T));
+		}
+
+		allocator select_on_container_copy_construction() const { return allocator(); }
+
+		template <typename U>
+		bool operator==(const allocator<U> &other) const { return resource->is_equal(*other.resource); }
+		template <typename U>
+		bool operator!=(const allocator<U> &other) const { return !(*this == other); }
+	};
+
+	template <typename T>
+	using vector = std::vector<T, allocator<T>>;
+};
+
+#endif // !GP_ALLOC_H
\ No newline at end of file
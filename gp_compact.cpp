@@ -0,0 +1,298 @@
+#include <vector>
+#include <string_view>
+
+#include "gp_compact.hpp"
+#include "gp_file.hpp"
+
+template <typename T>
+static void attach_table(CompactTable<T> &table, const std::vector<T> &vector) {
+	table.data = vector.data();
+	table.count = vector.size();
+}
+
+void CompactSong::attach_storage() {
+	attach_table(this->measureBeats, this->storage.measureBeats);
+	attach_table(this->beats, this->storage.beats);
+	attach_table(this->notes, this->storage.notes);
+	attach_table(this->tuplets, this->storage.tuplets);
+	attach_table(this->chords, this->storage.chords);
+	attach_table(this->texts, this->storage.texts);
+	attach_table(this->effects, this->storage.effects);
+	attach_table(this->mixChanges, this->storage.mixChanges);
+	attach_table(this->noteDetails, this->storage.noteDetails);
+	attach_table(this->bends, this->storage.bends);
+	attach_table(this->graceNotes, this->storage.graceNotes);
+	attach_table(this->bendPoints, this->storage.bendPoints);
+	attach_table(this->stringPool, this->storage.stringPool);
+}
+
+int CompactSong::build(GPFile &song) {
+	this->storage = {};
+	this->measureCount = song.measureCount;
+	this->trackCount = song.trackCount;
+
+	this->storage.measureBeats.reserve((size_t)song.measureCount*song.trackCount + 1);
+
+	for (int i = 0; i < song.measureCount; i++) {
+		for (int j = 0; j < song.trackCount; j++) {
+			this->storage.measureBeats.push_back(this->storage.beats.size());
+
+			const Measure &measure = song.get_measure(i, j);
+			for (const Beat &beat : measure.beats) {
+				add_beat(beat);
+			}
+		}
+	}
+	this->storage.measureBeats.push_back(this->storage.beats.size());
+
+	attach_storage();
+
+	return 0;
+}
+
+CompactString CompactSong::add_string(std::string_view value) {
+	CompactString string = { (unsigned int)this->storage.stringPool.size(), (unsigned int)value.length() };
+	this->storage.stringPool.insert(this->storage.stringPool.end(), value.begin(), value.end());
+	return string;
+}
+
+void CompactSong::add_beat(const Beat &beat) {
+	unsigned int beatIndex = this->storage.beats.size();
+
+	this->storage.beats.push_back(CompactBeat{
+		beat.beatFlags,
+		(signed char)beat.duration,
+		beat.beatNotes.stringsPlayed,
+		beat.isRest,
+		(unsigned int)this->storage.notes.size()
+	});
+
+	if (beat.beatFlags & gp_beat_is_tuplet) {
+		this->storage.tuplets.push_back({ beatIndex, beat.tupletDivision });
+	}
+	if (beat.beatFlags & gp_beat_has_chord) {
+		const Chord &chord = beat.chordDiagram;
+		CompactChord compactChord = { chord.newFormat, add_string(chord.name), chord.diagramFirstFret, { } };
+		if (chord.diagramFirstFret) {
+			std::copy(chord.diagramFrets, chord.diagramFrets + 6, compactChord.diagramFrets);
+		}
+		this->storage.chords.push_back({ beatIndex, compactChord });
+	}
+	if (beat.beatFlags & gp_beat_has_text) {
+		this->storage.texts.push_back({ beatIndex, add_string(beat.text) });
+	}
+	if (beat.beatFlags & gp_beat_has_effects) {
+		this->storage.effects.push_back({ beatIndex, beat.effects });
+	}
+	if (beat.beatFlags & gp_beat_has_mix_change) {
+		this->storage.mixChanges.push_back({ beatIndex, beat.mixTableChange });
+	}
+
+	for (int i = 0; i < 7; i++) {
+		if (!(beat.beatNotes.stringsPlayed & (0x40 >> i))) {
+			continue;
+		}
+
+		const Note &note = beat.beatNotes.strings[i];
+		unsigned int noteIndex = this->storage.notes.size();
+
+		unsigned char noteEffectFlags = (note.noteFlags & gp_note_has_effects) ? note.noteEffectFlags : 0;
+		this->storage.notes.push_back(CompactNote{
+			note.noteFlags,
+			(unsigned char)((note.noteFlags & gp_note_has_fret) ? note.noteType : 0),
+			(signed char)((note.noteFlags & gp_note_has_fret) ? note.fretNumber : 0),
+			noteEffectFlags
+		});
+
+		if (note.noteFlags & (gp_note_has_independent_duration|gp_note_has_dynamics|gp_note_has_fingering)) {
+			CompactNoteDetails details = { };
+			if (note.noteFlags & gp_note_has_independent_duration) {
+				details.duration = note.duration;
+				details.tupletDivision = note.tupletDivision;
+			}
+			if (note.noteFlags & gp_note_has_dynamics) {
+				details.dynamic = note.dynamic;
+			}
+			if (note.noteFlags & gp_note_has_fingering) {
+				details.leftHandFinger = note.leftHandFinger;
+				details.rightHandFinger = note.rightHandFinger;
+			}
+			this->storage.noteDetails.push_back({ noteIndex, details });
+		}
+		if (noteEffectFlags & gp_notefx_bend) {
+			const Bend &bend = note.noteBend;
+			this->storage.bends.push_back({ noteIndex, CompactBend{
+				(signed char)bend.type,
+				bend.value,
+				(unsigned int)this->storage.bendPoints.size(),
+				(unsigned int)bend.points.size()
+			}});
+			this->storage.bendPoints.insert(this->storage.bendPoints.end(), bend.points.begin(), bend.points.end());
+		}
+		if (noteEffectFlags & gp_notefx_grace_note) {
+			this->storage.graceNotes.push_back({ noteIndex, note.grace });
+		}
+	}
+}
+
+const CompactNote *CompactSong::note(unsigned int beatIndex, int stringIndex) const {
+	const CompactBeat &beat = this->beats[beatIndex];
+	unsigned char stringBit = 0x40 >> stringIndex;
+
+	if (!(beat.stringsPlayed & stringBit)) {
+		return nullptr;
+	}
+
+	// the notes are stored from the thinnest string, so skip the played strings above this one
+	int notesBefore = __builtin_popcount(beat.stringsPlayed & ~((stringBit << 1) - 1));
+	return &this->notes[beat.firstNote + notesBefore];
+}
+
+Beat CompactSong::expand_beat(unsigned int beatIndex) const {
+	const CompactBeat &compactBeat = this->beats[beatIndex];
+	Beat beat = { };
+
+	beat.beatFlags = compactBeat.beatFlags;
+	beat.isRest = compactBeat.isRest;
+	beat.duration = (NoteDuration)compactBeat.duration;
+
+	if (const int *tupletDivision = find_compact_entry(this->tuplets, beatIndex)) {
+		beat.tupletDivision = *tupletDivision;
+	}
+	if (const CompactChord *chord = find_compact_entry(this->chords, beatIndex)) {
+		beat.chordDiagram.newFormat = chord->newFormat;
+		beat.chordDiagram.name = std::string(get_string(chord->name));
+		beat.chordDiagram.diagramFirstFret = chord->diagramFirstFret;
+		std::copy(chord->diagramFrets, chord->diagramFrets + 6, beat.chordDiagram.diagramFrets);
+	}
+	if (const CompactString *text = find_compact_entry(this->texts, beatIndex)) {
+		beat.text = std::string(get_string(*text));
+	}
+	if (const BeatEffects *effects = find_compact_entry(this->effects, beatIndex)) {
+		beat.effects = *effects;
+	}
+	if (const MixChange *mixChange = find_compact_entry(this->mixChanges, beatIndex)) {
+		beat.mixTableChange = *mixChange;
+	}
+
+	beat.beatNotes.stringsPlayed = compactBeat.stringsPlayed;
+	unsigned int noteIndex = compactBeat.firstNote;
+
+	for (int i = 0; i < 7; i++) {
+		if (!(compactBeat.stringsPlayed & (0x40 >> i))) {
+			continue;
+		}
+
+		const CompactNote &compactNote = this->notes[noteIndex];
+		Note &note = beat.beatNotes.strings[i];
+
+		note.noteFlags = compactNote.noteFlags;
+		note.noteType = (NoteType)compactNote.noteType;
+		note.fretNumber = compactNote.fretNumber;
+		note.noteEffectFlags = compactNote.noteEffectFlags;
+
+		if (const CompactNoteDetails *details = find_compact_entry(this->noteDetails, noteIndex)) {
+			note.duration = (NoteDuration)details->duration;
+			note.tupletDivision = details->tupletDivision;
+			note.dynamic = details->dynamic;
+			note.leftHandFinger = details->leftHandFinger;
+			note.rightHandFinger = details->rightHandFinger;
+		}
+		if (const CompactBend *bend = find_compact_entry(this->bends, noteIndex)) {
+			note.noteBend.type = (BendType)bend->type;
+			note.noteBend.value = bend->value;
+			note.noteBend.pointCount = bend->pointCount;
+			note.noteBend.points.assign(this->bendPoints.begin() + bend->firstPoint,
+										this->bendPoints.begin() + bend->firstPoint + bend->pointCount);
+		}
+		if (const GraceNote *grace = find_compact_entry(this->graceNotes, noteIndex)) {
+			note.grace = *grace;
+		}
+
+		noteIndex++;
+	}
+
+	return beat;
+}
+
+Measure CompactSong::expand_measure(int measureIndex, int trackIndex) const {
+	Measure measure;
+
+	unsigned int firstBeat = first_beat(measureIndex, trackIndex);
+	measure.beatCount = beat_count(measureIndex, trackIndex);
+	measure.beats.reserve(measure.beatCount);
+
+	for (int i = 0; i < measure.beatCount; i++) {
+		measure.beats.push_back(expand_beat(firstBeat + i));
+	}
+
+	return measure;
+}
+
+// the entries have to be sorted for find_compact_entry, and each one for a beat or note that exists
+template <typename T>
+static bool entries_valid(const CompactTable<CompactEntry<T>> &table, unsigned int indexCount) {
+	for (unsigned int i = 0; i < table.count; i++) {
+		if (table[i].index >= indexCount || (i > 0 && table[i].index <= table[i-1].index)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool string_valid(CompactString string, unsigned int poolSize) {
+	return (unsigned long long)string.offset + string.length <= poolSize;
+}
+
+bool CompactSong::is_valid() const {
+	if (this->measureCount < 0 || this->trackCount < 0 ||
+		 this->measureBeats.count != (unsigned long long)this->measureCount*this->trackCount + 1) {
+		return false;
+	}
+	for (unsigned int i = 0; i < this->measureBeats.count; i++) {
+		if (this->measureBeats[i] > this->beats.count || (i > 0 && this->measureBeats[i] < this->measureBeats[i-1])) {
+			return false;
+		}
+	}
+	for (const CompactBeat &beat : this->beats) {
+		if ((unsigned long long)beat.firstNote + __builtin_popcount(beat.stringsPlayed & 0x7f) > this->notes.count) {
+			return false;
+		}
+	}
+
+	if (!entries_valid(this->tuplets, this->beats.count) || !entries_valid(this->chords, this->beats.count) ||
+		 !entries_valid(this->texts, this->beats.count) || !entries_valid(this->effects, this->beats.count) ||
+		 !entries_valid(this->mixChanges, this->beats.count) || !entries_valid(this->noteDetails, this->notes.count) ||
+		 !entries_valid(this->bends, this->notes.count) || !entries_valid(this->graceNotes, this->notes.count)) {
+		return false;
+	}
+	for (const CompactEntry<CompactChord> &chord : this->chords) {
+		if (!string_valid(chord.value.name, this->stringPool.count)) {
+			return false;
+		}
+	}
+	for (const CompactEntry<CompactString> &text : this->texts) {
+		if (!string_valid(text.value, this->stringPool.count)) {
+			return false;
+		}
+	}
+	for (const CompactEntry<CompactBend> &bend : this->bends) {
+		if ((unsigned long long)bend.value.firstPoint + bend.value.pointCount > this->bendPoints.count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+static size_t table_size(const CompactTable<T> &table) {
+	return table.count * sizeof(T);
+}
+
+size_t CompactSong::memory_size() const {
+	return table_size(this->measureBeats) + table_size(this->beats) + table_size(this->notes) +
+			 table_size(this->tuplets) + table_size(this->chords) + table_size(this->texts) +
+			 table_size(this->effects) + table_size(this->mixChanges) + table_size(this->noteDetails) +
+			 table_size(this->bends) + table_size(this->graceNotes) + table_size(this->bendPoints) +
+			 table_size(this->stringPool);
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#ifndef GP_COMPACT_H
+#define GP_COMPACT_H
+
+#include <vector>
+#include <string_view>
+#include <algorithm>
+
+#include "gp_file.hpp"
+
+// the hot fields of a beat, everything else is in the side tables of CompactSong
+struct CompactBeat {
+	unsigned char beatFlags;
+	signed char duration;	// enum NoteDuration
+	unsigned char stringsPlayed;
+	unsigned char isRest;
+	unsigned int firstNote;	// index of the note on the thinnest played string, the rest follow in order
+};
+
+// the hot fields of a note
+struct CompactNote {
+	unsigned char noteFlags;
+	unsigned char noteType;	// enum NoteType
+	signed char fretNumber;
+	unsigned char noteEffectFlags;
+};
+
+// a string in the string pool of a CompactSong
+struct CompactString {
+	unsigned int offset;
+	unsigned int length;
+};
+
+struct CompactChord {
+	bool newFormat;
+	CompactString name;
+	int diagramFirstFret;
+	int diagramFrets[6];
+};
+
+// the note fields that are only present with gp_note_has_independent_duration,
+// gp_note_has_dynamics or gp_note_has_fingering
+struct CompactNoteDetails {
+	signed char duration;
+	signed char tupletDivision;
+	signed char dynamic;
+	signed char leftHandFinger;
+	signed char rightHandFinger;
+};
+
+struct CompactBend {
+	signed char type;	// enum BendType
+	int value;
+	unsigned int firstPoint;	// into the bend point table
+	unsigned int pointCount;
+};
+
+// an entry in a side table, the tables are sorted by index
+template <typename T>
+struct CompactEntry {
+	unsigned int index;	// beat or note index
+	T value;
+};
+
+// a read only array, pointing either into the vectors of a CompactSong,
+// or into some other memory with the same layout
+template <typename T>
+struct CompactTable {
+	const T *data = nullptr;
+	unsigned int count = 0;
+
+	const T &operator[](unsigned int i) const { return data[i]; }
+	const T *begin() const { return data; }
+	const T *end() const { return data + count; }
+};
+
+// finds the entry for a beat or note index in a side table, or nullptr if it doesn't have one
+template <typename T>
+const T *find_compact_entry(const CompactTable<CompactEntry<T>> &table, unsigned int index) {
+	const CompactEntry<T> *entry = std::lower_bound(table.begin(), table.end(), index,
+		[](const CompactEntry<T> &entry, unsigned int index) { return entry.index < index; });
+
+	if (entry == table.end() || entry->index != index) {
+		return nullptr;
+	}
+	return &entry->value;
+}
+
+// a dense copy of all the measures of a song
+// beats are numbered track by track through the song, measure by measure, so a linear sweep
+// over a measure only touches a few contiguous bytes per beat and note
+class CompactSong {
+	public:
+		int measureCount = 0;
+		int trackCount = 0;
+
+		// the beats of measure m on track t are beats[measureBeats[m*trackCount + t]]
+		// up to beats[measureBeats[m*trackCount + t + 1]]
+		CompactTable<unsigned int> measureBeats;
+		CompactTable<CompactBeat> beats;
+		CompactTable<CompactNote> notes;
+
+		// keyed by beat index
+		CompactTable<CompactEntry<int>> tuplets;
+		CompactTable<CompactEntry<CompactChord>> chords;
+		CompactTable<CompactEntry<CompactString>> texts;
+		CompactTable<CompactEntry<BeatEffects>> effects;
+		CompactTable<CompactEntry<MixChange>> mixChanges;
+
+		// keyed by note index
+		CompactTable<CompactEntry<CompactNoteDetails>> noteDetails;
+		CompactTable<CompactEntry<CompactBend>> bends;
+		CompactTable<CompactEntry<GraceNote>> graceNotes;
+		CompactTable<BendPoint> bendPoints;
+
+		CompactTable<char> stringPool;
+
+		CompactSong() { }
+		CompactSong(const CompactSong &) = delete;
+		CompactSong &operator=(const CompactSong &) = delete;
+		CompactSong(CompactSong &&) = default;
+		CompactSong &operator=(CompactSong &&) = default;
+
+		// packs every measure of the song, a lazily opened song is decoded one measure at a time
+		int build(GPFile &song);
+
+		unsigned int first_beat(int measureIndex, int trackIndex) const {
+			return this->measureBeats[measureIndex*this->trackCount + trackIndex];
+		}
+		int beat_count(int measureIndex, int trackIndex) const {
+			return this->measureBeats[measureIndex*this->trackCount + trackIndex + 1] - first_beat(measureIndex, trackIndex);
+		}
+
+		// returns the note on a string of a beat, or nullptr if the string isn't played
+		const CompactNote *note(unsigned int beatIndex, int stringIndex) const;
+
+		std::string_view get_string(CompactString string) const {
+			return std::string_view(this->stringPool.data + string.offset, string.length);
+		}
+
+		// rebuilds the full structs, for code that needs a Beat or a Measure
+		Beat expand_beat(unsigned int beatIndex) const;
+		Measure expand_measure(int measureIndex, int trackIndex) const;
+
+		// whether every index in the tables points inside the table it's for, so tables that weren't built here,
+		// like the ones of a cache file, can be used without reading outside of them
+		bool is_valid() const;
+
+		// the number of bytes used by the tables
+		size_t memory_size() const;
+
+	private:
+		struct {
+			std::vector<unsigned int> measureBeats;
+			std::vector<CompactBeat> beats;
+			std::vector<CompactNote> notes;
+			std::vector<CompactEntry<int>> tuplets;
+			std::vector<CompactEntry<CompactChord>> chords;
+			std::vector<CompactEntry<CompactString>> texts;
+			std::vector<CompactEntry<BeatEffects>> effects;
+			std::vector<CompactEntry<MixChange>> mixChanges;
+			std::vector<CompactEntry<CompactNoteDetails>> noteDetails;
+			std::vector<CompactEntry<CompactBend>> bends;
+			std::vector<CompactEntry<GraceNote>> graceNotes;
+			std::vector<BendPoint> bendPoints;
+			std::vector<char> stringPool;
+		} storage;
+
+		// points the tables at the storage vectors
+		void attach_storage();
+
+		void add_beat(const Beat &beat);
+		CompactString add_string(std::string_view value);
+};
+
+#endif // !GP_COMPACT_H
\ No newline at end of file
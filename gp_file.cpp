@@ -1,92 +1,692 @@
 #include <iostream>
 #include <vector>
-#include <fstream>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
 
 #include "gp_file.hpp"
 #include "gp_read.hpp"
+#include "gp_write.hpp"
+#include "thread_pool.hpp"
+#include "song_cache.hpp"
+#include "beat_index.hpp"
 
 		
-GPFile::GPFile(std::ifstream &fileStream) {
-	read_song(fileStream);
+GPFile::GPFile(gp_read::Cursor &cursor, int openFlags) {
+	this->openFlags = openFlags;
+	read_song(cursor);
+}
+
+void GPFile::replace(GPFile &&other) {
+	if (this == &other) {
+		return;
+	}
+	// the containers' allocators are swapped along with them, and the memory they point at along with memory,
+	// so each side keeps allocating from its own memory, and other frees the old song when it's destroyed
+	std::swap(this->memory, other.memory);
+	std::swap(this->version, other.version);
+	std::swap(this->metadata, other.metadata);
+	std::swap(this->tripletFeel, other.tripletFeel);
+	std::swap(this->tempo, other.tempo);
+	std::swap(this->key, other.key);
+	std::swap(this->midiChannels, other.midiChannels);
+	std::swap(this->measureCount, other.measureCount);
+	std::swap(this->trackCount, other.trackCount);
+	this->measureHeaders.swap(other.measureHeaders);
+	this->trackHeaders.swap(other.trackHeaders);
+	this->measures.swap(other.measures);
+	std::swap(this->measureRows, other.measureRows);
+	this->measureOffsets.swap(other.measureOffsets);
+	this->headerOffsets.swap(other.headerOffsets);
+	std::swap(this->openFlags, other.openFlags);
+	std::swap(this->readError, other.readError);
+	std::swap(this->readTimes, other.readTimes);
+	std::swap(this->fileBuffer, other.fileBuffer);
+	std::swap(this->measureCacheSize, other.measureCacheSize);
+	std::swap(this->parseThreadCount, other.parseThreadCount);
+	std::swap(this->songCache, other.songCache);
+	std::swap(this->skippedBendPoints, other.skippedBendPoints);
+	this->tempoChanges.swap(other.tempoChanges);
+	this->measureCache.swap(other.measureCache);
+	this->measureCacheIndex.swap(other.measureCacheIndex);
+	std::swap(this->decodedMeasures, other.decodedMeasures);
+	std::swap(this->songInfoEdited, other.songInfoEdited);
+	std::swap(this->measuresMoved, other.measuresMoved);
+	this->editedTrackHeaders.swap(other.editedTrackHeaders);
 }
 		
-int GPFile::read_song(std::ifstream &fileStream) {
-	read_version(fileStream);
-	read_metadata(fileStream);
+// the smallest number of bytes a measure header, measure block and beat can take up in a file,
+// used so that counts read from a broken file can't make us reserve more than the file could hold
+static const size_t minMeasureHeaderSize = 1;
+static const size_t minMeasureSize = 4;
+static const size_t minBeatSize = 3;
+
+static size_t reserve_count(long long count, size_t remainingBytes, size_t minSize) {
+	if (count <= 0) {
+		return 0;
+	}
+	return std::min((size_t)count, remainingBytes / minSize);
+}
+
+// with gp_open_parallel, songs smaller than this are still decoded on one thread,
+// starting the threads would take longer than the decoding
+static const size_t minParallelBytes = 256 * 1024;
+
+// set while a pool thread decodes measures into an arena of its own
+static thread_local std::pmr::memory_resource *threadMeasureResource = nullptr;
+
+// the threads decoding a song can all report errors
+static std::mutex reportMutex;
+
+// milliseconds since start, which is moved up to now for the next part
+static double lapTime(std::chrono::steady_clock::time_point &start) {
+	auto now = std::chrono::steady_clock::now();
+	double milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+	start = now;
+	return milliseconds;
+}
+
+int GPFile::read_song(gp_read::Cursor &cursor, std::shared_ptr<const SongCache> cache) {
+	release_song_data();
+	this->readError.clear();
+	auto startTime = std::chrono::steady_clock::now();
 	
-	this->tripletFeel = gp_read::read_bool(fileStream);
-	this->tempo = gp_read::read_int(fileStream);
-	this->key = gp_read::read_int(fileStream);
+	// anything after the version would be read wrong
+	if (read_version(cursor) != 0) {
+		return 1;
+	}
+	read_metadata(cursor);
 	
-	read_midi_channels(fileStream);
+	this->tripletFeel = gp_read::read_bool(cursor);
+	this->tempo = gp_read::read_int(cursor);
+	this->key = gp_read::read_int(cursor);
+	this->readTimes.metadata = lapTime(startTime);
 	
-	this->measureCount = gp_read::read_int(fileStream);
-	this->trackCount = gp_read::read_int(fileStream);
+	read_midi_channels(cursor);
+	this->readTimes.midiChannels = lapTime(startTime);
 	
-	for (int i = 0; i < this->measureCount; i++) {
-		this->measureHeaders.push_back(read_measure_header(fileStream));
+	this->measureCount = gp_read::read_int(cursor);
+	this->trackCount = gp_read::read_int(cursor);
+	
+	// the counts come straight from the file, so they're checked before anything is sized or multiplied by them
+	if (this->measureCount < 0 || this->trackCount < 0) {
+		this->measureCount = 0;
+		this->trackCount = 0;
+		return report_error("Invalid measure or track count.");
 	}
-	for (int i = 0; i < this->trackCount; i++) {
-		this->trackHeaders.push_back(read_track_header(fileStream));
+	long long blockCount = (long long)this->measureCount * this->trackCount;
+	
+	size_t measureSlots = reserve_count(this->measureCount, cursor.remaining(), minMeasureHeaderSize);
+	size_t blockSlots = reserve_count(blockCount, cursor.remaining(), minMeasureSize);
+	
+	// only big songs are worth it, and not inside another pool, whose threads are busy with other songs
+	bool readInParallel = (this->openFlags & gp_open_parallel) && !(this->openFlags & gp_open_lazy_measures) &&
+						 this->trackCount > 0 && cursor.remaining() >= minParallelBytes && !ThreadPool::on_worker_thread();
+	std::vector<size_t> blockStarts;
+	gp_read::Cursor blocksEnd = cursor;
+	
+	if ((this->openFlags & gp_open_arena) && !(this->openFlags & gp_open_lazy_measures)) {
+		// walk through the rest of the file once to count the beats, so the arena can be sized up front
+		gp_read::Cursor sizingCursor = cursor;
+		for (int i = 0; i < this->measureCount && !sizingCursor.overrun; i++) {
+			read_measure_header(sizingCursor);
+		}
+		for (int i = 0; i < this->trackCount && !sizingCursor.overrun; i++) {
+			read_track_header(sizingCursor);
+		}
+		
+		size_t beatCount = 0;
+		if (readInParallel) {
+			// the beats go into an arena per thread, so this pass only has to find the blocks
+			blocksEnd = sizingCursor;
+			locate_measures(blocksEnd, blockStarts);
+			this->skippedBendPoints = 0;
+		}
+		else {
+			this->skippedBendPoints = 0;
+			for (size_t i = 0; i < blockSlots && !sizingCursor.overrun; i++) {
+				gp_read::Cursor beatCountCursor = sizingCursor;
+				beatCount += reserve_count(gp_read::read_int(beatCountCursor), sizingCursor.remaining(), minBeatSize);
+				skip_measure(sizingCursor);
+			}
+		}
+		
+		// every allocation can be padded a bit for alignment
+		size_t allocationCount = 5 + measureSlots + blockSlots + this->skippedBendPoints;
+		size_t arenaSize = measureSlots * (sizeof(MeasureHeader) + sizeof(gp_alloc::vector<Measure>)) +
+								 this->trackCount * sizeof(TrackHeader) +
+								 (blockSlots + 1) * sizeof(size_t) +
+								 (measureSlots + this->trackCount + 1) * sizeof(size_t) +
+								 blockSlots * sizeof(Measure) +
+								 beatCount * sizeof(Beat) +
+								 this->skippedBendPoints * sizeof(BendPoint) +
+								 allocationCount * alignof(std::max_align_t);
+		this->memory->use_arena(arenaSize);
 	}
 	
-	for (int i = 0; i < this->measureCount; i++) {	// loop through all measures
-		std::vector<Measure> measureTracks;
+	// sizing the arena is mostly walking through the measures
+	this->readTimes.measures = lapTime(startTime);
+	
+	size_t trackSlots = reserve_count(this->trackCount, cursor.remaining(), 1);
+	this->headerOffsets.reserve(measureSlots + trackSlots + 1);
+	
+	this->measureHeaders.reserve(measureSlots);
+	for (int i = 0; i < this->measureCount && !cursor.overrun; i++) {
+		this->headerOffsets.push_back(cursor.position);
+		this->measureHeaders.push_back(read_measure_header(cursor));
+	}
+	this->trackHeaders.reserve(trackSlots);
+	for (int i = 0; i < this->trackCount && !cursor.overrun; i++) {
+		this->headerOffsets.push_back(cursor.position);
+		this->trackHeaders.push_back(read_track_header(cursor));
+	}
+	this->headerOffsets.push_back(cursor.position);
+	this->readTimes.headers = lapTime(startTime);
+	
+	this->measureOffsets.reserve(blockSlots + 1);
+	if (!(this->openFlags & gp_open_lazy_measures)) {
+		this->measures.reserve(measureSlots);
+	}
+	
+	// the key of a cache is checked when it's opened, but its blocks also have to start where the headers end
+	if (cache && (this->openFlags & gp_open_lazy_measures) && !cursor.overrun &&
+		 cache->measures.measureCount == this->measureCount && cache->measures.trackCount == this->trackCount &&
+		 cache->blockOffsets[0] == cursor.position && cache->blockOffsets[cache->blockOffsetCount-1] <= cursor.size) {
+		this->measureOffsets.insert(this->measureOffsets.end(), cache->blockOffsets, cache->blockOffsets + cache->blockOffsetCount-1);
+		cursor.position = cache->blockOffsets[cache->blockOffsetCount-1];
+		this->songCache = cache;
+		scan_cached_tempo_changes();
+	}
+	
+	if (readInParallel) {
+		// the arena sizing pass has found the blocks already
+		if (!(this->openFlags & gp_open_arena)) {
+			blocksEnd = cursor;
+			locate_measures(blocksEnd, blockStarts);
+		}
+		this->measureOffsets.insert(this->measureOffsets.end(), blockStarts.begin(), blockStarts.end());
+		read_measures_parallel(cursor, blockStarts, blocksEnd.position);
+		cursor = blocksEnd;
+	}
+	
+	std::vector<TempoScan> tempoScans;
+	if ((this->openFlags & gp_open_lazy_measures) && !this->songCache) {
+		tempoScans.resize(reserve_count(this->trackCount, cursor.remaining(), minMeasureSize));
+	}
+	for (int i = 0; i < this->measureCount && !cursor.overrun && !readInParallel && !this->songCache; i++) {	// loop through all measures
+		if (this->openFlags & gp_open_lazy_measures) {
+			for (int j = 0; j < this->trackCount; j++) {
+				this->measureOffsets.push_back(cursor.position);
+				// every block takes up a few bytes, so only tracks past the end of a broken file have no scan
+				TempoScan *tempoScan = j < (int)tempoScans.size() ? &tempoScans[j] : nullptr;
+				if (tempoScan) {
+					tempoScan->fileMeasure = i;
+					tempoScan->trackIndex = j;
+				}
+				skip_measure(cursor, tempoScan);
+			}
+			continue;
+		}
+		
+		gp_alloc::vector<Measure> &measureTracks = this->measures.emplace_back(this->memory.get());
+		measureTracks.reserve(reserve_count(this->trackCount, cursor.remaining(), minMeasureSize));
 		
 		for (int j = 0; j < this->trackCount; j++) {	// for every measure, loop through all tracks
-			measureTracks.push_back(read_measure(fileStream));
+			this->measureOffsets.push_back(cursor.position);
+			measureTracks.push_back(read_measure(cursor));
 		}
-		
-		this->measures.push_back(measureTracks);
+	}
+	this->measureOffsets.push_back(cursor.position);
+	
+	// a file that ends early only gets rows for the measures whose blocks were all read, so every row can be looked up
+	size_t rowCount = this->measureHeaders.size();
+	if (this->trackCount > 0) {
+		rowCount = std::min(rowCount, (this->measureOffsets.size() - 1) / this->trackCount);
+	}
+	for (int i = 0; i < (int)rowCount; i++) {
+		this->measureRows.push_back(MeasureRow{i, nullptr, {}});
+	}
+	this->readTimes.measures += lapTime(startTime);
+	
+	if (cursor.overrun) {
+		return report_error("Unexpected end of file.");
 	}
 	
 	return 0;
 }
 
+void GPFile::locate_measures(gp_read::Cursor &cursor, std::vector<size_t> &blockStarts) {
+	blockStarts.reserve(reserve_count((long long)this->measureCount * this->trackCount, cursor.remaining(), minMeasureSize));
+	
+	for (int i = 0; i < this->measureCount && !cursor.overrun; i++) {
+		for (int j = 0; j < this->trackCount; j++) {
+			blockStarts.push_back(cursor.position);
+			skip_measure(cursor);
+		}
+	}
+}
+
+void GPFile::read_measures_parallel(const gp_read::Cursor &cursor, const std::vector<size_t> &blockStarts, size_t blocksEnd) {
+	if (blockStarts.empty()) {
+		return;
+	}
+	
+	// the slots are made up front, so the threads only fill them in
+	for (size_t i = 0; i < blockStarts.size(); i += this->trackCount) {
+		gp_alloc::vector<Measure> &measureTracks = this->measures.emplace_back(this->memory.get());
+		measureTracks.reserve(this->trackCount);
+		for (int j = 0; j < this->trackCount; j++) {
+			measureTracks.push_back(Measure{0, gp_alloc::vector<Beat>(measure_resource())});
+		}
+	}
+	
+	ThreadPool pool(this->parseThreadCount);
+	// a few ranges of blocks per thread, so a thread that gets the dense measures doesn't hold up the others
+	size_t rangeBytes = std::max<size_t>((blocksEnd - blockStarts[0]) / (pool.thread_count() * 4), 1);
+	
+	for (size_t first = 0, last; first < blockStarts.size(); first = last) {
+		last = first + 1;
+		while (last < blockStarts.size() && blockStarts[last] - blockStarts[first] < rangeBytes) {
+			last++;
+		}
+		
+		// an arena can only be used by one thread, so every range gets its own, sized like the main one
+		std::pmr::memory_resource *resource = nullptr;
+		if (this->memory->has_arena()) {
+			size_t beatCount = 0;
+			for (size_t i = first; i < last; i++) {
+				gp_read::Cursor beatCountCursor = cursor;
+				beatCountCursor.position = blockStarts[i];
+				beatCount += reserve_count(gp_read::read_int(beatCountCursor), beatCountCursor.remaining(), minBeatSize);
+			}
+			resource = this->memory->add_arena(beatCount * sizeof(Beat) + (last - first + 1) * alignof(std::max_align_t));
+		}
+		
+		pool.submit([this, &cursor, &blockStarts, first, last, resource] {
+			threadMeasureResource = resource;
+			gp_read::Cursor blockCursor = cursor;
+			for (size_t i = first; i < last; i++) {
+				// after the file ends the cursor stays overrun, and the rest read as empty like they would in one pass
+				blockCursor.position = blockStarts[i];
+				this->measures[i / this->trackCount][i % this->trackCount] = read_measure(blockCursor);
+			}
+			threadMeasureResource = nullptr;
+		});
+	}
+	pool.wait();
+}
+
+// swapping with an empty vector is the only way to be sure the memory is actually freed
+template <typename T>
+static void release_vector(gp_alloc::vector<T> &vector) {
+	gp_alloc::vector<T>(vector.get_allocator()).swap(vector);
+}
+
+void GPFile::release_song_data() {
+	this->measureCount = 0;
+	this->trackCount = 0;
+	this->metadata.notice.clear();
+	release_vector(this->measureHeaders);
+	release_vector(this->trackHeaders);
+	release_vector(this->measures);
+	release_vector(this->measureOffsets);
+	release_vector(this->headerOffsets);
+	this->measureRows.clear();
+	this->measureCache.clear();
+	this->measureCacheIndex.clear();
+	this->songCache = nullptr;
+	this->tempoChanges.clear();
+	
+	this->songInfoEdited = false;
+	this->measuresMoved = false;
+	this->editedTrackHeaders.clear();
+	
+	// nothing allocated from the arena is left, so it can go
+	this->memory->release_arena();
+}
+
+std::pmr::memory_resource *GPFile::measure_resource() {
+	if (threadMeasureResource) {
+		return threadMeasureResource;
+	}
+	// lazily decoded measures come and go with the cache, so they'd just pile up in an arena
+	if (this->openFlags & gp_open_lazy_measures) {
+		return &this->memory->heap;
+	}
+	return this->memory.get();
+}
+
+int GPFile::read_file(const std::string &filePath, int openFlags) {
+	this->openFlags = openFlags;
+	
+	auto startTime = std::chrono::steady_clock::now();
+	auto buffer = std::make_shared<std::vector<char>>();
+	if (gp_read::load_file(filePath, *buffer) != 0) {
+		return report_error("Error opening file.");
+	}
+	double loadTime = lapTime(startTime);
+	
+	int status = read_buffer(filePath, buffer, openFlags);
+	this->readTimes.loadFile = loadTime;
+	return status;
+}
+
+int GPFile::read_buffer(const std::string &filePath, std::shared_ptr<const std::vector<char>> buffer, int openFlags) {
+	this->openFlags = openFlags;
+	this->readTimes = ReadTimes();
+	
+	if (openFlags & (gp_open_string_views|gp_open_lazy_measures)) {
+		this->fileBuffer = buffer;
+	}
+	
+	bool useCache = (openFlags & gp_open_cache) && (openFlags & gp_open_lazy_measures);
+	std::shared_ptr<SongCache> cache;
+	if (useCache) {
+		auto startTime = std::chrono::steady_clock::now();
+		cache = std::make_shared<SongCache>();
+		if (cache->open(filePath, *buffer) != 0) {
+			cache = nullptr;
+		}
+		this->readTimes.openCache = lapTime(startTime);
+	}
+	
+	gp_read::Cursor cursor(*buffer);
+	int status = read_song(cursor, cache);
+	
+	// a missing or out of date cache is written for the next time, if the song read cleanly
+	// it's only a cache, so not being able to write it isn't an error
+	if (useCache && status == 0 && !this->songCache) {
+		auto startTime = std::chrono::steady_clock::now();
+		writeSongCache(filePath, *buffer);
+		this->readTimes.writeCache = lapTime(startTime);
+	}
+	return status;
+}
+
+Measure &GPFile::get_measure(int measureIndex, int trackIndex) {
+	return row_measure(this->measureRows[measureIndex], trackIndex);
+}
+
+const MeasureHeader &GPFile::measure_header(int measureIndex) const {
+	return row_header(this->measureRows[measureIndex]);
+}
+
+Measure &GPFile::row_measure(const MeasureRow &row, int trackIndex) {
+	if (!row.tracks.empty() && row.tracks[trackIndex]) {
+		return *row.tracks[trackIndex];
+	}
+	
+	if (!(this->openFlags & gp_open_lazy_measures)) {
+		return this->measures[row.fileMeasure][trackIndex];
+	}
+	
+	// the cache is by where the measure is in the file, so moving measures around doesn't affect it
+	int blockIndex = row.fileMeasure*this->trackCount + trackIndex;
+	auto cached = this->measureCacheIndex.find(blockIndex);
+	if (cached != this->measureCacheIndex.end()) {
+		// move to the front, so it's the last to be evicted
+		this->measureCache.splice(this->measureCache.begin(), this->measureCache, cached->second);
+		return cached->second->second;
+	}
+	
+	this->measureCache.emplace_front(blockIndex, decode_measure(row.fileMeasure, trackIndex));
+	this->decodedMeasures++;
+	this->measureCacheIndex[blockIndex] = this->measureCache.begin();
+	
+	if (this->measureCache.size() > this->measureCacheSize && this->measureCacheSize > 0) {
+		this->measureCacheIndex.erase(this->measureCache.back().first);
+		this->measureCache.pop_back();
+	}
+	
+	return this->measureCache.front().second;
+}
+
+Measure GPFile::decode_measure(int fileMeasure, int trackIndex) {
+	// a cached measure is only copied out of the cache's tables, there's nothing to decode
+	if (this->songCache) {
+		return this->songCache->measures.expand_measure(fileMeasure, trackIndex);
+	}
+	
+	gp_read::Cursor cursor(*this->fileBuffer);
+	cursor.position = this->measureOffsets[fileMeasure*this->trackCount + trackIndex];
+	return read_measure(cursor);
+}
+
+void GPFile::uncache_measure(const MeasureRow &row, int trackIndex) {
+	if (row.fileMeasure < 0) {
+		return;
+	}
+	auto cached = this->measureCacheIndex.find(row.fileMeasure*this->trackCount + trackIndex);
+	if (cached != this->measureCacheIndex.end()) {
+		this->measureCache.erase(cached->second);
+		this->measureCacheIndex.erase(cached);
+	}
+}
 
-int GPFile::read_version(std::ifstream &fileStream) {
-	this->version = gp_read::read_bytestring(fileStream);
-	fileStream.seekg(30 - this->version.length(), std::ifstream::cur);
+Measure &GPFile::edit_measure(int measureIndex, int trackIndex) {
+	MeasureRow &row = this->measureRows[measureIndex];
+	if (row.tracks.empty()) {
+		row.tracks.resize(this->trackCount);
+	}
+	
+	std::shared_ptr<Measure> &edited = row.tracks[trackIndex];
+	if (edited) {
+		// someone still has this version, so the change goes into a copy
+		if (edited.use_count() > 1) {
+			edited = std::make_shared<Measure>(*edited);
+		}
+		return *edited;
+	}
+	
+	// copies of a measure don't come from the arena, so they can outlive it
+	if (!(this->openFlags & gp_open_lazy_measures)) {
+		edited = std::make_shared<Measure>(this->measures[row.fileMeasure][trackIndex]);
+		return *edited;
+	}
+	
+	// an edited measure can't be evicted from the cache, since it can't be decoded from the file again,
+	// so it's moved out of the cache for good
+	int blockIndex = row.fileMeasure*this->trackCount + trackIndex;
+	auto cached = this->measureCacheIndex.find(blockIndex);
+	if (cached != this->measureCacheIndex.end()) {
+		edited = std::make_shared<Measure>(std::move(cached->second->second));
+		this->measureCache.erase(cached->second);
+		this->measureCacheIndex.erase(cached);
+	}
+	else {
+		edited = std::make_shared<Measure>(decode_measure(row.fileMeasure, trackIndex));
+	}
+	return *edited;
+}
+
+std::shared_ptr<Measure> GPFile::edited_measure(int measureIndex, int trackIndex) const {
+	const MeasureRow &row = this->measureRows[measureIndex];
+	return row.tracks.empty() ? nullptr : row.tracks[trackIndex];
+}
+
+void GPFile::restore_measure(int measureIndex, int trackIndex, std::shared_ptr<Measure> version) {
+	MeasureRow &row = this->measureRows[measureIndex];
+	if (row.tracks.empty()) {
+		row.tracks.resize(this->trackCount);
+	}
+	
+	// a copy from before the edit could still be in the cache
+	uncache_measure(row, trackIndex);
+	
+	// nullptr is the measure as it was read, so write_changes can copy it from the file again
+	if (version != nullptr || row.fileMeasure >= 0) {
+		row.tracks[trackIndex] = std::move(version);
+	}
+}
+
+MeasureHeader &GPFile::edit_measure_header(int measureIndex) {
+	MeasureRow &row = this->measureRows[measureIndex];
+	if (!row.header) {
+		row.header = std::make_shared<MeasureHeader>(this->measureHeaders[row.fileMeasure]);
+	}
+	else if (row.header.use_count() > 1) {
+		row.header = std::make_shared<MeasureHeader>(*row.header);
+	}
+	return *row.header;
+}
+
+std::shared_ptr<MeasureHeader> GPFile::edited_measure_header(int measureIndex) const {
+	return this->measureRows[measureIndex].header;
+}
+
+void GPFile::restore_measure_header(int measureIndex, std::shared_ptr<MeasureHeader> version) {
+	MeasureRow &row = this->measureRows[measureIndex];
+	// inserted measures have no header in the file to go back to
+	if (version != nullptr || row.fileMeasure >= 0) {
+		row.header = std::move(version);
+	}
+}
+
+TrackHeader &GPFile::edit_track_header(int trackIndex) {
+	if (this->editedTrackHeaders.empty()) {
+		this->editedTrackHeaders.assign(this->trackHeaders.size(), false);
+	}
+	this->editedTrackHeaders[trackIndex] = true;
+	return this->trackHeaders[trackIndex];
+}
+
+void GPFile::edit_song_info() {
+	this->songInfoEdited = true;
+}
+
+bool GPFile::has_edits() const {
+	if (this->songInfoEdited || this->measuresMoved) {
+		return true;
+	}
+	for (bool edited : this->editedTrackHeaders) {
+		if (edited) return true;
+	}
+	for (size_t i = 0; i < this->measureRows.size(); i++) {
+		const MeasureRow &row = this->measureRows[i];
+		if (row.header) return true;
+		for (const std::shared_ptr<Measure> &track : row.tracks) {
+			if (track) return true;
+		}
+	}
+	return false;
+}
+
+std::vector<MeasureRow> GPFile::make_measure_rows(int count) const {
+	std::vector<MeasureRow> rows;
+	for (int i = 0; i < count; i++) {
+		MeasureRow &row = rows.emplace_back();
+		row.fileMeasure = -1;
+		// without flags the time signature carries over from the measure before
+		row.header = std::make_shared<MeasureHeader>();
+		
+		for (int j = 0; j < this->trackCount; j++) {
+			Beat rest{};
+			rest.beatFlags = gp_beat_is_empty_or_rest;
+			rest.isRest = true;
+			rest.duration = gp_duration_whole;
+			
+			std::shared_ptr<Measure> measure = std::make_shared<Measure>();
+			measure->beatCount = 1;
+			measure->beats.push_back(rest);
+			row.tracks.push_back(std::move(measure));
+		}
+	}
+	return rows;
+}
+
+void GPFile::insert_measure_rows(int measureIndex, const std::vector<MeasureRow> &rows) {
+	this->measureRows.insert(measureIndex, rows.begin(), rows.end());
+	this->measureCount = this->measureRows.size();
+	this->measuresMoved = true;
+}
+
+std::vector<MeasureRow> GPFile::remove_measures(int measureIndex, int count) {
+	std::vector<MeasureRow> rows;
+	auto row = this->measureRows.at(measureIndex);
+	for (int i = 0; i < count && row != this->measureRows.end(); i++, ++row) {
+		rows.push_back(*row);
+	}
+	
+	this->measureRows.erase(measureIndex, count);
+	this->measureCount = this->measureRows.size();
+	this->measuresMoved = true;
+	return rows;
+}
+
+void GPFile::move_measures(int measureIndex, int count, int toIndex) {
+	this->measureRows.move_range(measureIndex, count, toIndex);
+	this->measuresMoved = true;
+}
+
+int GPFile::report_error(const std::string &message) {
+	std::lock_guard<std::mutex> lock(reportMutex);
+	this->readError = message;
+	if (!(this->openFlags & gp_open_quiet)) {
+		std::cerr << message << "\n";
+	}
+	return 1;
+}
+
+GPString GPFile::make_string(std::string_view value) {
+	if (this->openFlags & gp_open_string_views) {
+		return GPString::view(value);
+	}
+	return GPString(std::string(value));
+}
+
+std::string_view GPFile::read_string(gp_read::Cursor &cursor) {
+	// the rest of the file is usually off after a bad string, so only the first one is reported
+	const char *previousError = cursor.error;
+	std::string_view value = gp_read::read_intbytestring_view(cursor);
+	if (cursor.error != previousError) {
+		report_error(cursor.error);
+	}
+	return value;
+}
+
+
+int GPFile::read_version(gp_read::Cursor &cursor) {
+	this->version = gp_read::read_bytestring(cursor);
+	cursor.skip(30 - this->version.length());
 	
 	if (this->version != "FICHIER GUITAR PRO v3.00") {
-		std::cerr << "Incompatible file format '" << this->version << "'\n";
-		return 1;
+		return report_error("Incompatible file format '" + this->version + "'");
 	}
 	
 	return 0;
 }
 
-int GPFile::read_metadata(std::ifstream &fileStream) {
-	this->metadata.title = gp_read::read_intbytestring(fileStream);
-	this->metadata.subtitle = gp_read::read_intbytestring(fileStream);
-	this->metadata.artist = gp_read::read_intbytestring(fileStream);
-	this->metadata.album = gp_read::read_intbytestring(fileStream);
-	this->metadata.words = gp_read::read_intbytestring(fileStream);
-	this->metadata.copyright = gp_read::read_intbytestring(fileStream);
-	this->metadata.tabbedBy = gp_read::read_intbytestring(fileStream);
-	this->metadata.instructions = gp_read::read_intbytestring(fileStream);
+int GPFile::read_metadata(gp_read::Cursor &cursor) {
+	this->metadata.title = make_string(read_string(cursor));
+	this->metadata.subtitle = make_string(read_string(cursor));
+	this->metadata.artist = make_string(read_string(cursor));
+	this->metadata.album = make_string(read_string(cursor));
+	this->metadata.words = make_string(read_string(cursor));
+	this->metadata.copyright = make_string(read_string(cursor));
+	this->metadata.tabbedBy = make_string(read_string(cursor));
+	this->metadata.instructions = make_string(read_string(cursor));
 	
-	int noticeLength = gp_read::read_int(fileStream);
-	for (int i = 1; i <= noticeLength; i++) {
-		this->metadata.notice.push_back(gp_read::read_intbytestring(fileStream));
+	int noticeLength = gp_read::read_int(cursor);
+	for (int i = 1; i <= noticeLength && !cursor.overrun; i++) {
+		this->metadata.notice.push_back(make_string(read_string(cursor)));
 	}
 	
 	return 0;
 }
 
-int GPFile::read_midi_channels(std::ifstream &fileStream) {
+int GPFile::read_midi_channels(gp_read::Cursor &cursor) {
 	for (int i = 0; i < 4; i++) {
 		for (int j = 0; j < 16; j++) {
 			this->midiChannels[i][j] = {
-				gp_read::read_int(fileStream),	// instrument
-				gp_read::read_byte(fileStream),	// volume
-				gp_read::read_byte(fileStream),	// balance
-				gp_read::read_byte(fileStream),	// chorus
-				gp_read::read_byte(fileStream),	// reverb
-				gp_read::read_byte(fileStream),	// phaser
-				gp_read::read_byte(fileStream),	// tremolo
-				gp_read::read_byte(fileStream),	// blank1
-				gp_read::read_byte(fileStream)	// blank2
+				gp_read::read_int(cursor),	// instrument
+				gp_read::read_byte(cursor),	// volume
+				gp_read::read_byte(cursor),	// balance
+				gp_read::read_byte(cursor),	// chorus
+				gp_read::read_byte(cursor),	// reverb
+				gp_read::read_byte(cursor),	// phaser
+				gp_read::read_byte(cursor),	// tremolo
+				gp_read::read_byte(cursor),	// blank1
+				gp_read::read_byte(cursor)	// blank2
 			};
 		}
 	}
@@ -94,272 +694,865 @@ int GPFile::read_midi_channels(std::ifstream &fileStream) {
 	return 0;
 }
 
-MeasureHeader GPFile::read_measure_header(std::ifstream &fileStream) {
+MeasureHeader GPFile::read_measure_header(gp_read::Cursor &cursor) {
 	MeasureHeader measure;
-	measure.measureFlags = gp_read::read_byte(fileStream);
+	measure.measureFlags = gp_read::read_byte(cursor);
 	
 	if (measure.measureFlags & gp_measure_keysig_numerator) {
-		measure.keysigNumerator = gp_read::read_byte(fileStream);
+		measure.keysigNumerator = gp_read::read_byte(cursor);
 	}
 	if (measure.measureFlags & gp_measure_keysig_denominator) {
-		measure.keysigDenominator = gp_read::read_byte(fileStream);
+		measure.keysigDenominator = gp_read::read_byte(cursor);
 	}
 	if (measure.measureFlags & gp_measure_repeat_end) {
-		measure.repeatEnd = gp_read::read_byte(fileStream);
+		measure.repeatEnd = gp_read::read_byte(cursor);
 	}
 	if (measure.measureFlags & gp_measure_altend_number) {
-		measure.altendNumber = gp_read::read_byte(fileStream);
+		measure.altendNumber = gp_read::read_byte(cursor);
 	}
 	if (measure.measureFlags & gp_measure_marker) {
-		measure.markerName = gp_read::read_intbytestring(fileStream);
-		measure.markerColor[0] = gp_read::read_byte(fileStream);	// red
-		measure.markerColor[1] = gp_read::read_byte(fileStream);	// green
-		measure.markerColor[2] = gp_read::read_byte(fileStream);	// blue
-		measure.markerColor[3] = gp_read::read_byte(fileStream);	// white (always 0)
+		measure.markerName = make_string(read_string(cursor));
+		measure.markerColor[0] = gp_read::read_byte(cursor);	// red
+		measure.markerColor[1] = gp_read::read_byte(cursor);	// green
+		measure.markerColor[2] = gp_read::read_byte(cursor);	// blue
+		measure.markerColor[3] = gp_read::read_byte(cursor);	// white (always 0)
 	}
 	if (measure.measureFlags & gp_measure_tonality) {
-		measure.tonalityRoot = gp_read::read_byte(fileStream);
-		measure.tonalityType = gp_read::read_byte(fileStream);
+		measure.tonalityRoot = gp_read::read_byte(cursor);
+		measure.tonalityType = gp_read::read_byte(cursor);
 	}
 	
 	return measure;
 }
 
-TrackHeader GPFile::read_track_header(std::ifstream &fileStream) {
+TrackHeader GPFile::read_track_header(gp_read::Cursor &cursor) {
 	TrackHeader track;
-	track.trackFlags = gp_read::read_byte(fileStream);
+	track.trackFlags = gp_read::read_byte(cursor);
 	
-	track.name = gp_read::read_bytestring(fileStream);
-	fileStream.seekg(40 - track.name.length(), std::ifstream::cur);
+	track.name = make_string(gp_read::read_bytestring_view(cursor));
+	cursor.skip(40 - track.name.length());
 	
-	track.stringCount = gp_read::read_int(fileStream);
+	track.stringCount = gp_read::read_int(cursor);
 	for (int i = 0; i < 7; i++) {
-		track.stringTuning[i] = gp_read::read_int(fileStream);
+		track.stringTuning[i] = gp_read::read_int(cursor);
 	}
 	
-	track.midiPort = gp_read::read_int(fileStream);
-	track.midiChannel = gp_read::read_int(fileStream);
-	track.midiEffectsChannel = gp_read::read_int(fileStream);
+	track.midiPort = gp_read::read_int(cursor);
+	track.midiChannel = gp_read::read_int(cursor);
+	track.midiEffectsChannel = gp_read::read_int(cursor);
 	
-	track.fretCount = gp_read::read_int(fileStream);
-	track.capo = gp_read::read_int(fileStream);
+	track.fretCount = gp_read::read_int(cursor);
+	track.capo = gp_read::read_int(cursor);
 	
-	track.color[0] = gp_read::read_byte(fileStream);	// red
-	track.color[1] = gp_read::read_byte(fileStream);	// green
-	track.color[2] = gp_read::read_byte(fileStream);	// blue
-	track.color[3] = gp_read::read_byte(fileStream);	// white (always 0)
+	track.color[0] = gp_read::read_byte(cursor);	// red
+	track.color[1] = gp_read::read_byte(cursor);	// green
+	track.color[2] = gp_read::read_byte(cursor);	// blue
+	track.color[3] = gp_read::read_byte(cursor);	// white (always 0)
 	
 	return track;
 }
 
-Measure GPFile::read_measure(std::ifstream &fileStream) {
-	Measure measure;
+Measure GPFile::read_measure(gp_read::Cursor &cursor) {
+	Measure measure{0, gp_alloc::vector<Beat>(measure_resource())};
 	
-	measure.beatCount = gp_read::read_int(fileStream);
+	measure.beatCount = gp_read::read_int(cursor);
+	measure.beats.reserve(reserve_count(measure.beatCount, cursor.remaining(), minBeatSize));
 	
-	for (int i = 0; i < measure.beatCount; i++) {
-		measure.beats.push_back(read_beat(fileStream));
+	for (int i = 0; i < measure.beatCount && !cursor.overrun; i++) {
+		measure.beats.push_back(read_beat(cursor));
 	}
 	
 	return measure;
 }
 
-Beat GPFile::read_beat(std::ifstream &fileStream) {
+Beat GPFile::read_beat(gp_read::Cursor &cursor) {
 	Beat beat;
 	
-	beat.beatFlags = gp_read::read_byte(fileStream);
+	beat.beatFlags = gp_read::read_byte(cursor);
 	
 	if (beat.beatFlags & gp_beat_is_empty_or_rest) {
-		beat.isRest = gp_read::read_bool(fileStream);
+		beat.isRest = gp_read::read_bool(cursor);
 	}
 	else {
 		beat.isRest = 0;
 	}
 	
-	beat.duration = (NoteDuration)gp_read::read_signedbyte(fileStream);
+	beat.duration = (NoteDuration)gp_read::read_signedbyte(cursor);
 	
 	if (beat.beatFlags & gp_beat_is_tuplet) {
-		beat.tupletDivision = gp_read::read_int(fileStream);
+		beat.tupletDivision = gp_read::read_int(cursor);
 	}
 	
 	if (beat.beatFlags & gp_beat_has_chord) {
-		beat.chordDiagram = read_chord(fileStream);
+		beat.chordDiagram = read_chord(cursor);
 	}
 	
 	if (beat.beatFlags & gp_beat_has_text) {
-		beat.text = gp_read::read_intbytestring(fileStream);
+		beat.text = make_string(read_string(cursor));
 	}
 	
 	if (beat.beatFlags & gp_beat_has_effects) {
-		beat.effects = read_beat_effects(fileStream);
+		beat.effects = read_beat_effects(cursor);
 	}
 	
 	if (beat.beatFlags & gp_beat_has_mix_change) {
-		beat.mixTableChange = read_mix_change(fileStream);
+		beat.mixTableChange = read_mix_change(cursor);
 	}
 	
-	beat.beatNotes = read_notes(fileStream);
+	beat.beatNotes = read_notes(cursor);
 	
 	return beat;
 }
 
-Chord GPFile::read_chord(std::ifstream &fileStream) {
+Chord GPFile::read_chord(gp_read::Cursor &cursor) {
 	Chord chord;
 	
-	chord.newFormat = gp_read::read_bool(fileStream);
+	chord.newFormat = gp_read::read_bool(cursor);
 	if (chord.newFormat) {
-		std::cerr << "Wrong chord diagram format!\n";
+		report_error("Wrong chord diagram format!");
 		return chord;
 	}
 	
-	chord.name = gp_read::read_intbytestring(fileStream);
-	chord.diagramFirstFret = gp_read::read_int(fileStream);
+	chord.name = make_string(read_string(cursor));
+	chord.diagramFirstFret = gp_read::read_int(cursor);
 		
 	if (chord.diagramFirstFret) {
 		for (int i = 0; i < 6; i++) {
-			chord.diagramFrets[i] = gp_read::read_int(fileStream);
+			chord.diagramFrets[i] = gp_read::read_int(cursor);
 		}
 	}
 	
 	return chord;
 }
 
-BeatEffects GPFile::read_beat_effects(std::ifstream &fileStream) {
+BeatEffects GPFile::read_beat_effects(gp_read::Cursor &cursor) {
 	BeatEffects effects;
 	
-	effects.beatEffectFlags = gp_read::read_byte(fileStream);
+	effects.beatEffectFlags = gp_read::read_byte(cursor);
 	
 	if (effects.beatEffectFlags & gp_beatfx_tremolo_or_tap) {
-		effects.tremoloOrTap = gp_read::read_byte(fileStream);
+		effects.tremoloOrTap = gp_read::read_byte(cursor);
 		
 		if (effects.tremoloOrTap == 0) {
-			effects.tremoloValue = gp_read::read_int(fileStream);
+			effects.tremoloValue = gp_read::read_int(cursor);
 		}
 	}
 	
 	if (effects.beatEffectFlags & gp_beatfx_strum) {
-		effects.strumDown = (StrumSpeed)gp_read::read_signedbyte(fileStream);
-		effects.strumUp = (StrumSpeed)gp_read::read_signedbyte(fileStream);
+		effects.strumDown = (StrumSpeed)gp_read::read_signedbyte(cursor);
+		effects.strumUp = (StrumSpeed)gp_read::read_signedbyte(cursor);
 	}
 
 	return effects;
 }
 
-MixChange GPFile::read_mix_change(std::ifstream &fileStream) {
+MixChange GPFile::read_mix_change(gp_read::Cursor &cursor) {
 	MixChange change;
 	
-	change.instrument = gp_read::read_signedbyte(fileStream);
-	change.volume = gp_read::read_signedbyte(fileStream);
-	change.balance = gp_read::read_signedbyte(fileStream);
-	change.chorus = gp_read::read_signedbyte(fileStream);
-	change.reverb = gp_read::read_signedbyte(fileStream);
-	change.phaser = gp_read::read_signedbyte(fileStream);
-	change.tremolo = gp_read::read_signedbyte(fileStream);
-	change.tempo = gp_read::read_int(fileStream);
+	change.instrument = gp_read::read_signedbyte(cursor);
+	change.volume = gp_read::read_signedbyte(cursor);
+	change.balance = gp_read::read_signedbyte(cursor);
+	change.chorus = gp_read::read_signedbyte(cursor);
+	change.reverb = gp_read::read_signedbyte(cursor);
+	change.phaser = gp_read::read_signedbyte(cursor);
+	change.tremolo = gp_read::read_signedbyte(cursor);
+	change.tempo = gp_read::read_int(cursor);
 	
 	if (change.instrument >= 0) {
-		change.instrumentDuration = gp_read::read_signedbyte(fileStream);
+		change.instrumentDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.volume >= 0) {
-		change.volumeDuration = gp_read::read_signedbyte(fileStream);
+		change.volumeDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.balance >= 0) {
-		change.balanceDuration = gp_read::read_signedbyte(fileStream);
+		change.balanceDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.chorus >= 0) {
-		change.chorusDuration = gp_read::read_signedbyte(fileStream);
+		change.chorusDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.reverb >= 0) {
-		change.reverbDuration = gp_read::read_signedbyte(fileStream);
+		change.reverbDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.phaser >= 0) {
-		change.phaserDuration = gp_read::read_signedbyte(fileStream);
+		change.phaserDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.tremolo >= 0) {
-		change.tremoloDuration = gp_read::read_signedbyte(fileStream);
+		change.tremoloDuration = gp_read::read_signedbyte(cursor);
 	}
 	if (change.tempo >= 0) {
-		change.tempoDuration = gp_read::read_signedbyte(fileStream);
+		change.tempoDuration = gp_read::read_signedbyte(cursor);
 	}
 	
 	return change;
 }
 
-Notes GPFile::read_notes(std::ifstream &fileStream) {
+Notes GPFile::read_notes(gp_read::Cursor &cursor) {
 	Notes notes;
 	
-	notes.stringsPlayed = gp_read::read_byte(fileStream);
+	notes.stringsPlayed = gp_read::read_byte(cursor);
 	
 	for (int i = 0; i < 7; i++) {
 		if (notes.stringsPlayed & (0x40 >> i)) {
-			notes.strings[i] = read_note(fileStream);
+			notes.strings[i] = read_note(cursor);
 		}
 	}
 	
 	return notes;
 }
 
-Note GPFile::read_note(std::ifstream &fileStream) {
+Note GPFile::read_note(gp_read::Cursor &cursor) {
 	Note note;
 	
-	note.noteFlags = gp_read::read_byte(fileStream);
+	note.noteFlags = gp_read::read_byte(cursor);
 	
 	if (note.noteFlags & gp_note_has_fret) {
-		note.noteType = (NoteType)gp_read::read_byte(fileStream);
+		note.noteType = (NoteType)gp_read::read_byte(cursor);
 	}
 	if (note.noteFlags & gp_note_has_independent_duration) {
-		note.duration = (NoteDuration)gp_read::read_signedbyte(fileStream);
-		note.tupletDivision = gp_read::read_signedbyte(fileStream);
+		note.duration = (NoteDuration)gp_read::read_signedbyte(cursor);
+		note.tupletDivision = gp_read::read_signedbyte(cursor);
 	}
 	if (note.noteFlags & gp_note_has_dynamics) {
-		note.dynamic = gp_read::read_signedbyte(fileStream);
+		note.dynamic = gp_read::read_signedbyte(cursor);
 	}
 	if (note.noteFlags & gp_note_has_fret) {
-		note.fretNumber = gp_read::read_signedbyte(fileStream);
+		note.fretNumber = gp_read::read_signedbyte(cursor);
 	}
 	if (note.noteFlags & gp_note_has_fingering) {
-		note.leftHandFinger = gp_read::read_signedbyte(fileStream);
-		note.rightHandFinger = gp_read::read_signedbyte(fileStream);
+		note.leftHandFinger = gp_read::read_signedbyte(cursor);
+		note.rightHandFinger = gp_read::read_signedbyte(cursor);
 	}
 	if (note.noteFlags & gp_note_has_effects) {
-		note.noteEffectFlags = gp_read::read_byte(fileStream);
+		note.noteEffectFlags = gp_read::read_byte(cursor);
 		
 		if (note.noteEffectFlags & gp_notefx_bend) {
-			note.noteBend = read_bend(fileStream);
+			note.noteBend = read_bend(cursor);
 		}
 		if (note.noteEffectFlags & gp_notefx_grace_note) {
-			note.grace = read_grace_note(fileStream);
+			note.grace = read_grace_note(cursor);
 		}
 	}
 	
 	return note;
 }
 
-Bend GPFile::read_bend(std::ifstream &fileStream) {
-	Bend bend;
+Bend GPFile::read_bend(gp_read::Cursor &cursor) {
+	Bend bend{gp_bendtype_none, 0, 0, gp_alloc::vector<BendPoint>(measure_resource())};
 	
-	bend.type = (BendType)gp_read::read_signedbyte(fileStream);
-	bend.value = gp_read::read_int(fileStream);
-	bend.pointCount = gp_read::read_int(fileStream);
+	bend.type = (BendType)gp_read::read_signedbyte(cursor);
+	bend.value = gp_read::read_int(cursor);
+	bend.pointCount = gp_read::read_int(cursor);
 	
-	for (int i = 0; i < bend.pointCount; i++) {
+	for (int i = 0; i < bend.pointCount && !cursor.overrun; i++) {
 		BendPoint point;
-		point.position = gp_read::read_int(fileStream);
-		point.value = gp_read::read_int(fileStream);
-		point.vibrato = gp_read::read_bool(fileStream);
+		point.position = gp_read::read_int(cursor);
+		point.value = gp_read::read_int(cursor);
+		point.vibrato = gp_read::read_bool(cursor);
 		bend.points.push_back(point);
 	}
 	
 	return bend;
 }
 
-GraceNote GPFile::read_grace_note(std::ifstream &fileStream) {
+GraceNote GPFile::read_grace_note(gp_read::Cursor &cursor) {
 	GraceNote graceNote;
 	
-	graceNote.fret = gp_read::read_signedbyte(fileStream);
-	graceNote.dynamic = gp_read::read_byte(fileStream);
-	graceNote.duration = gp_read::read_byte(fileStream);
-	graceNote.transition = gp_read::read_byte(fileStream);
+	graceNote.fret = gp_read::read_signedbyte(cursor);
+	graceNote.dynamic = gp_read::read_byte(cursor);
+	graceNote.duration = gp_read::read_byte(cursor);
+	graceNote.transition = gp_read::read_byte(cursor);
 	
 	return graceNote;
+}
+
+
+// the skip functions walk the same structure as the read functions above,
+// but only move the cursor, without building any objects other than the tempo changes
+
+void GPFile::skip_measure(gp_read::Cursor &cursor, TempoScan *tempoScan) {
+	int beatCount = gp_read::read_int(cursor);
+	
+	long long measureOffset = 0;
+	for (int i = 0; i < beatCount && !cursor.overrun; i++) {
+		measureOffset += skip_beat(cursor, tempoScan, measureOffset);
+	}
+	// the tempo map counts an empty measure as a beat of a ramp
+	if (tempoScan && beatCount <= 0) {
+		tempoScan->count_ramp_beat(this->tempoChanges, 0);
+	}
+}
+
+int GPFile::skip_beat(gp_read::Cursor &cursor, TempoScan *tempoScan, long long measureOffset) {
+	unsigned char beatFlags = gp_read::read_byte(cursor);
+	
+	if (beatFlags & gp_beat_is_empty_or_rest) {
+		cursor.skip(1);
+	}
+	int duration = gp_read::read_signedbyte(cursor);
+	int tupletDivision = 0;
+	if (beatFlags & gp_beat_is_tuplet) {
+		tupletDivision = gp_read::read_int(cursor);
+	}
+	if (beatFlags & gp_beat_has_chord) {
+		skip_chord(cursor);
+	}
+	if (beatFlags & gp_beat_has_text) {
+		read_string(cursor);
+	}
+	if (beatFlags & gp_beat_has_effects) {
+		skip_beat_effects(cursor);
+	}
+	int tempo = -1;
+	int tempoDuration = 0;
+	if (beatFlags & gp_beat_has_mix_change) {
+		tempo = skip_mix_change(cursor, tempoDuration);
+	}
+	
+	skip_notes(cursor);
+	
+	int ticks = getBeatTicks(duration, beatFlags, tupletDivision);
+	if (tempoScan) {
+		scan_beat_tempo(*tempoScan, measureOffset, ticks, tempo, tempoDuration);
+	}
+	return ticks;
+}
+
+void GPFile::scan_beat_tempo(TempoScan &scan, long long measureOffset, int ticks, int tempo, int tempoDuration) {
+	if (tempo > 0) {
+		int rampBeats = std::max(tempoDuration, 0);
+		if (rampBeats > 0) {
+			scan.ramps.emplace_back(this->tempoChanges.size(), rampBeats);
+		}
+		this->tempoChanges.push_back(MixTempoChange{ scan.fileMeasure, scan.trackIndex, measureOffset, tempo, rampBeats, 0 });
+	}
+	scan.count_ramp_beat(this->tempoChanges, ticks);
+}
+
+void GPFile::TempoScan::count_ramp_beat(std::vector<MixTempoChange> &changes, int ticks) {
+	for (std::pair<size_t, int> &ramp : this->ramps) {
+		changes[ramp.first].rampTicks += ticks;
+		ramp.second--;
+	}
+	this->ramps.erase(std::remove_if(this->ramps.begin(), this->ramps.end(),
+		[](const std::pair<size_t, int> &ramp) { return ramp.second <= 0; }), this->ramps.end());
+}
+
+void GPFile::scan_cached_tempo_changes() {
+	const CompactSong &compact = this->songCache->measures;
+	std::vector<TempoScan> tempoScans(compact.trackCount);
+	
+	for (int i = 0; i < compact.measureCount; i++) {
+		for (int j = 0; j < compact.trackCount; j++) {
+			TempoScan &scan = tempoScans[j];
+			scan.fileMeasure = i;
+			scan.trackIndex = j;
+			
+			unsigned int firstBeat = compact.first_beat(i, j);
+			int beatCount = compact.beat_count(i, j);
+			long long measureOffset = 0;
+			for (unsigned int beatIndex = firstBeat; beatIndex < firstBeat + beatCount; beatIndex++) {
+				const CompactBeat &beat = compact.beats[beatIndex];
+				
+				int tupletDivision = 0;
+				if (beat.beatFlags & gp_beat_is_tuplet) {
+					const int *tuplet = find_compact_entry(compact.tuplets, beatIndex);
+					tupletDivision = tuplet ? *tuplet : 0;
+				}
+				int tempo = -1;
+				int tempoDuration = 0;
+				if (beat.beatFlags & gp_beat_has_mix_change) {
+					const MixChange *change = find_compact_entry(compact.mixChanges, beatIndex);
+					if (change && change->tempo >= 0) {
+						tempo = change->tempo;
+						tempoDuration = change->tempoDuration;
+					}
+				}
+				
+				int ticks = getBeatTicks(beat.duration, beat.beatFlags, tupletDivision);
+				scan_beat_tempo(scan, measureOffset, ticks, tempo, tempoDuration);
+				measureOffset += ticks;
+			}
+			if (beatCount <= 0) {
+				scan.count_ramp_beat(this->tempoChanges, 0);
+			}
+		}
+	}
+}
+
+void GPFile::skip_chord(gp_read::Cursor &cursor) {
+	if (gp_read::read_bool(cursor)) {
+		return;	// read_chord stops here too
+	}
+	
+	read_string(cursor);
+	if (gp_read::read_int(cursor)) {
+		cursor.skip(6*4);
+	}
+}
+
+void GPFile::skip_beat_effects(gp_read::Cursor &cursor) {
+	unsigned char beatEffectFlags = gp_read::read_byte(cursor);
+	
+	if (beatEffectFlags & gp_beatfx_tremolo_or_tap) {
+		if (gp_read::read_byte(cursor) == 0) {
+			cursor.skip(4);
+		}
+	}
+	if (beatEffectFlags & gp_beatfx_strum) {
+		cursor.skip(2);
+	}
+}
+
+int GPFile::skip_mix_change(gp_read::Cursor &cursor, int &tempoDuration) {
+	// one duration byte follows for every value that isn't negative, the tempo's is the last one
+	int durationCount = 0;
+	for (int i = 0; i < 7; i++) {
+		if (gp_read::read_signedbyte(cursor) >= 0) {
+			durationCount++;
+		}
+	}
+	int tempo = gp_read::read_int(cursor);
+	if (tempo < 0) {
+		cursor.skip(durationCount);
+		return tempo;
+	}
+	
+	cursor.skip(durationCount);
+	tempoDuration = gp_read::read_signedbyte(cursor);
+	return tempo;
+}
+
+void GPFile::skip_notes(gp_read::Cursor &cursor) {
+	unsigned char stringsPlayed = gp_read::read_byte(cursor);
+	
+	for (int i = 0; i < 7; i++) {
+		if (stringsPlayed & (0x40 >> i)) {
+			skip_note(cursor);
+		}
+	}
+}
+
+void GPFile::skip_note(gp_read::Cursor &cursor) {
+	unsigned char noteFlags = gp_read::read_byte(cursor);
+	
+	if (noteFlags & gp_note_has_fret) {
+		cursor.skip(1);	// note type
+	}
+	if (noteFlags & gp_note_has_independent_duration) {
+		cursor.skip(2);
+	}
+	if (noteFlags & gp_note_has_dynamics) {
+		cursor.skip(1);
+	}
+	if (noteFlags & gp_note_has_fret) {
+		cursor.skip(1);	// fret number
+	}
+	if (noteFlags & gp_note_has_fingering) {
+		cursor.skip(2);
+	}
+	if (noteFlags & gp_note_has_effects) {
+		unsigned char noteEffectFlags = gp_read::read_byte(cursor);
+		
+		if (noteEffectFlags & gp_notefx_bend) {
+			skip_bend(cursor);
+		}
+		if (noteEffectFlags & gp_notefx_grace_note) {
+			cursor.skip(4);
+		}
+	}
+}
+
+void GPFile::skip_bend(gp_read::Cursor &cursor) {
+	cursor.skip(1+4);	// type and value
+	int pointCount = gp_read::read_int(cursor);
+	
+	if (pointCount < 0) {
+		cursor.skip(cursor.remaining() + 1);
+		return;
+	}
+	cursor.skip((size_t)pointCount * (4+4+1));	// position, value and vibrato of every point
+	if (!cursor.overrun) {
+		this->skippedBendPoints += pointCount;
+	}
+}
+
+
+// the write functions mirror the read functions, field for field
+
+int GPFile::write_file(const std::string &filePath) {
+	std::vector<char> buffer;
+	write_changes(buffer);
+	
+	if (gp_write::save_file(filePath, buffer) != 0) {
+		return report_error("Error saving file.");
+	}
+	return 0;
+}
+
+void GPFile::write_song(std::vector<char> &buffer) {
+	// the song rarely changes size by much, so the file it was read from is a good guess
+	if (!this->measureOffsets.empty()) {
+		buffer.reserve(buffer.size() + this->measureOffsets.back() + this->measureOffsets.back()/8);
+	}
+	
+	write_version(buffer);
+	write_metadata(buffer);
+	
+	gp_write::write_bool(buffer, this->tripletFeel);
+	gp_write::write_int(buffer, this->tempo);
+	gp_write::write_int(buffer, this->key);
+	
+	write_midi_channels(buffer);
+	
+	gp_write::write_int(buffer, this->measureRows.size());
+	gp_write::write_int(buffer, this->trackHeaders.size());
+	
+	for (const MeasureRow &row : this->measureRows) {
+		write_measure_header(buffer, row_header(row));
+	}
+	for (const TrackHeader &track : this->trackHeaders) {
+		write_track_header(buffer, track);
+	}
+	
+	for (const MeasureRow &row : this->measureRows) {
+		for (size_t j = 0; j < this->trackHeaders.size(); j++) {
+			write_measure(buffer, row_measure(row, j));
+		}
+	}
+}
+
+void GPFile::write_changes(std::vector<char> &buffer) {
+	size_t blockCount = this->measureHeaders.size() * this->trackHeaders.size();
+	
+	// without the original file, or if it didn't read cleanly, there's nothing to copy from
+	if (!this->fileBuffer || !this->readError.empty() ||
+		 this->measureOffsets.size() != blockCount + 1 ||
+		 this->headerOffsets.size() != this->measureHeaders.size() + this->trackHeaders.size() + 1) {
+		write_song(buffer);
+		return;
+	}
+	
+	const std::vector<char> &original = *this->fileBuffer;
+	buffer.reserve(buffer.size() + this->measureOffsets.back() + this->measureOffsets.back()/8);
+	
+	// the unedited parts of the file are copied in runs that are as long as possible,
+	// a run grows as long as the next part to copy follows it in the file
+	size_t copyFrom = 0;
+	size_t copyTo = 0;
+	auto finishRun = [&]() {
+		buffer.insert(buffer.end(), original.begin() + copyFrom, original.begin() + copyTo);
+		copyFrom = copyTo;
+	};
+	auto copy = [&](size_t from, size_t to) {
+		if (from != copyTo) {
+			finishRun();
+			copyFrom = from;
+		}
+		copyTo = to;
+	};
+	
+	// the measure and track counts are the last thing before the headers
+	if (this->songInfoEdited) {
+		write_version(buffer);
+		write_metadata(buffer);
+		gp_write::write_bool(buffer, this->tripletFeel);
+		gp_write::write_int(buffer, this->tempo);
+		gp_write::write_int(buffer, this->key);
+		write_midi_channels(buffer);
+	}
+	else {
+		copy(0, this->headerOffsets[0] - 8);
+		finishRun();
+	}
+	gp_write::write_int(buffer, this->measureRows.size());
+	gp_write::write_int(buffer, this->trackHeaders.size());
+	
+	for (const MeasureRow &row : this->measureRows) {
+		if (row.header) {
+			finishRun();
+			write_measure_header(buffer, *row.header);
+		}
+		else {
+			copy(this->headerOffsets[row.fileMeasure], this->headerOffsets[row.fileMeasure + 1]);
+		}
+	}
+	for (size_t i = 0; i < this->trackHeaders.size(); i++) {
+		size_t headerIndex = this->measureHeaders.size() + i;
+		if (i < this->editedTrackHeaders.size() && this->editedTrackHeaders[i]) {
+			finishRun();
+			write_track_header(buffer, this->trackHeaders[i]);
+		}
+		else {
+			copy(this->headerOffsets[headerIndex], this->headerOffsets[headerIndex + 1]);
+		}
+	}
+	
+	for (const MeasureRow &row : this->measureRows) {
+		for (size_t j = 0; j < this->trackHeaders.size(); j++) {
+			if (!row.tracks.empty() && row.tracks[j]) {
+				finishRun();
+				write_measure(buffer, *row.tracks[j]);
+			}
+			else {
+				size_t blockIndex = row.fileMeasure*this->trackHeaders.size() + j;
+				copy(this->measureOffsets[blockIndex], this->measureOffsets[blockIndex + 1]);
+			}
+		}
+	}
+	finishRun();
+}
+
+void GPFile::write_version(std::vector<char> &buffer) {
+	std::string_view version = std::string_view(this->version).substr(0, 30);
+	gp_write::write_bytestring(buffer, version);
+	gp_write::write_padding(buffer, 30 - version.length());
+}
+
+void GPFile::write_metadata(std::vector<char> &buffer) {
+	gp_write::write_intbytestring(buffer, this->metadata.title);
+	gp_write::write_intbytestring(buffer, this->metadata.subtitle);
+	gp_write::write_intbytestring(buffer, this->metadata.artist);
+	gp_write::write_intbytestring(buffer, this->metadata.album);
+	gp_write::write_intbytestring(buffer, this->metadata.words);
+	gp_write::write_intbytestring(buffer, this->metadata.copyright);
+	gp_write::write_intbytestring(buffer, this->metadata.tabbedBy);
+	gp_write::write_intbytestring(buffer, this->metadata.instructions);
+	
+	gp_write::write_int(buffer, this->metadata.notice.size());
+	for (const GPString &line : this->metadata.notice) {
+		gp_write::write_intbytestring(buffer, line);
+	}
+}
+
+void GPFile::write_midi_channels(std::vector<char> &buffer) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 16; j++) {
+			const MidiChannel &channel = this->midiChannels[i][j];
+			gp_write::write_int(buffer, channel.instrument);
+			gp_write::write_byte(buffer, channel.volume);
+			gp_write::write_byte(buffer, channel.balance);
+			gp_write::write_byte(buffer, channel.chorus);
+			gp_write::write_byte(buffer, channel.reverb);
+			gp_write::write_byte(buffer, channel.phaser);
+			gp_write::write_byte(buffer, channel.tremolo);
+			gp_write::write_byte(buffer, channel.blank1);
+			gp_write::write_byte(buffer, channel.blank2);
+		}
+	}
+}
+
+void GPFile::write_measure_header(std::vector<char> &buffer, const MeasureHeader &measure) {
+	gp_write::write_byte(buffer, measure.measureFlags);
+	
+	if (measure.measureFlags & gp_measure_keysig_numerator) {
+		gp_write::write_byte(buffer, measure.keysigNumerator);
+	}
+	if (measure.measureFlags & gp_measure_keysig_denominator) {
+		gp_write::write_byte(buffer, measure.keysigDenominator);
+	}
+	if (measure.measureFlags & gp_measure_repeat_end) {
+		gp_write::write_byte(buffer, measure.repeatEnd);
+	}
+	if (measure.measureFlags & gp_measure_altend_number) {
+		gp_write::write_byte(buffer, measure.altendNumber);
+	}
+	if (measure.measureFlags & gp_measure_marker) {
+		gp_write::write_intbytestring(buffer, measure.markerName);
+		for (int i = 0; i < 4; i++) {
+			gp_write::write_byte(buffer, measure.markerColor[i]);
+		}
+	}
+	if (measure.measureFlags & gp_measure_tonality) {
+		gp_write::write_byte(buffer, measure.tonalityRoot);
+		gp_write::write_byte(buffer, measure.tonalityType);
+	}
+}
+
+void GPFile::write_track_header(std::vector<char> &buffer, const TrackHeader &track) {
+	gp_write::write_byte(buffer, track.trackFlags);
+	
+	std::string_view name = track.name.view().substr(0, 40);
+	gp_write::write_bytestring(buffer, name);
+	gp_write::write_padding(buffer, 40 - name.length());
+	
+	gp_write::write_int(buffer, track.stringCount);
+	for (int i = 0; i < 7; i++) {
+		gp_write::write_int(buffer, track.stringTuning[i]);
+	}
+	
+	gp_write::write_int(buffer, track.midiPort);
+	gp_write::write_int(buffer, track.midiChannel);
+	gp_write::write_int(buffer, track.midiEffectsChannel);
+	
+	gp_write::write_int(buffer, track.fretCount);
+	gp_write::write_int(buffer, track.capo);
+	
+	for (int i = 0; i < 4; i++) {
+		gp_write::write_byte(buffer, track.color[i]);
+	}
+}
+
+void GPFile::write_measure(std::vector<char> &buffer, const Measure &measure) {
+	gp_write::write_int(buffer, measure.beats.size());
+	
+	for (const Beat &beat : measure.beats) {
+		write_beat(buffer, beat);
+	}
+}
+
+void GPFile::write_beat(std::vector<char> &buffer, const Beat &beat) {
+	gp_write::write_byte(buffer, beat.beatFlags);
+	
+	if (beat.beatFlags & gp_beat_is_empty_or_rest) {
+		gp_write::write_byte(buffer, beat.isRest ? 0x02 : 0x00);	// 0x00 is an empty beat, 0x02 a rest
+	}
+	gp_write::write_signedbyte(buffer, beat.duration);
+	if (beat.beatFlags & gp_beat_is_tuplet) {
+		gp_write::write_int(buffer, beat.tupletDivision);
+	}
+	if (beat.beatFlags & gp_beat_has_chord) {
+		write_chord(buffer, beat.chordDiagram);
+	}
+	if (beat.beatFlags & gp_beat_has_text) {
+		gp_write::write_intbytestring(buffer, beat.text);
+	}
+	if (beat.beatFlags & gp_beat_has_effects) {
+		write_beat_effects(buffer, beat.effects);
+	}
+	if (beat.beatFlags & gp_beat_has_mix_change) {
+		write_mix_change(buffer, beat.mixTableChange);
+	}
+	
+	write_notes(buffer, beat.beatNotes);
+}
+
+void GPFile::write_chord(std::vector<char> &buffer, const Chord &chord) {
+	gp_write::write_bool(buffer, chord.newFormat);
+	if (chord.newFormat) {
+		return;	// read_chord can't read the rest
+	}
+	
+	gp_write::write_intbytestring(buffer, chord.name);
+	gp_write::write_int(buffer, chord.diagramFirstFret);
+	
+	if (chord.diagramFirstFret) {
+		for (int i = 0; i < 6; i++) {
+			gp_write::write_int(buffer, chord.diagramFrets[i]);
+		}
+	}
+}
+
+void GPFile::write_beat_effects(std::vector<char> &buffer, const BeatEffects &effects) {
+	gp_write::write_byte(buffer, effects.beatEffectFlags);
+	
+	if (effects.beatEffectFlags & gp_beatfx_tremolo_or_tap) {
+		gp_write::write_byte(buffer, effects.tremoloOrTap);
+		
+		if (effects.tremoloOrTap == 0) {
+			gp_write::write_int(buffer, effects.tremoloValue);
+		}
+	}
+	
+	if (effects.beatEffectFlags & gp_beatfx_strum) {
+		gp_write::write_signedbyte(buffer, effects.strumDown);
+		gp_write::write_signedbyte(buffer, effects.strumUp);
+	}
+}
+
+void GPFile::write_mix_change(std::vector<char> &buffer, const MixChange &change) {
+	gp_write::write_signedbyte(buffer, change.instrument);
+	gp_write::write_signedbyte(buffer, change.volume);
+	gp_write::write_signedbyte(buffer, change.balance);
+	gp_write::write_signedbyte(buffer, change.chorus);
+	gp_write::write_signedbyte(buffer, change.reverb);
+	gp_write::write_signedbyte(buffer, change.phaser);
+	gp_write::write_signedbyte(buffer, change.tremolo);
+	gp_write::write_int(buffer, change.tempo);
+	
+	if (change.instrument >= 0) {
+		gp_write::write_signedbyte(buffer, change.instrumentDuration);
+	}
+	if (change.volume >= 0) {
+		gp_write::write_signedbyte(buffer, change.volumeDuration);
+	}
+	if (change.balance >= 0) {
+		gp_write::write_signedbyte(buffer, change.balanceDuration);
+	}
+	if (change.chorus >= 0) {
+		gp_write::write_signedbyte(buffer, change.chorusDuration);
+	}
+	if (change.reverb >= 0) {
+		gp_write::write_signedbyte(buffer, change.reverbDuration);
+	}
+	if (change.phaser >= 0) {
+		gp_write::write_signedbyte(buffer, change.phaserDuration);
+	}
+	if (change.tremolo >= 0) {
+		gp_write::write_signedbyte(buffer, change.tremoloDuration);
+	}
+	if (change.tempo >= 0) {
+		gp_write::write_signedbyte(buffer, change.tempoDuration);
+	}
+}
+
+void GPFile::write_notes(std::vector<char> &buffer, const Notes &notes) {
+	gp_write::write_byte(buffer, notes.stringsPlayed);
+	
+	for (int i = 0; i < 7; i++) {
+		if (notes.stringsPlayed & (0x40 >> i)) {
+			write_note(buffer, notes.strings[i]);
+		}
+	}
+}
+
+void GPFile::write_note(std::vector<char> &buffer, const Note &note) {
+	gp_write::write_byte(buffer, note.noteFlags);
+	
+	if (note.noteFlags & gp_note_has_fret) {
+		gp_write::write_byte(buffer, note.noteType);
+	}
+	if (note.noteFlags & gp_note_has_independent_duration) {
+		gp_write::write_signedbyte(buffer, note.duration);
+		gp_write::write_signedbyte(buffer, note.tupletDivision);
+	}
+	if (note.noteFlags & gp_note_has_dynamics) {
+		gp_write::write_signedbyte(buffer, note.dynamic);
+	}
+	if (note.noteFlags & gp_note_has_fret) {
+		gp_write::write_signedbyte(buffer, note.fretNumber);
+	}
+	if (note.noteFlags & gp_note_has_fingering) {
+		gp_write::write_signedbyte(buffer, note.leftHandFinger);
+		gp_write::write_signedbyte(buffer, note.rightHandFinger);
+	}
+	if (note.noteFlags & gp_note_has_effects) {
+		gp_write::write_byte(buffer, note.noteEffectFlags);
+		
+		if (note.noteEffectFlags & gp_notefx_bend) {
+			write_bend(buffer, note.noteBend);
+		}
+		if (note.noteEffectFlags & gp_notefx_grace_note) {
+			write_grace_note(buffer, note.grace);
+		}
+	}
+}
+
+void GPFile::write_bend(std::vector<char> &buffer, const Bend &bend) {
+	gp_write::write_signedbyte(buffer, bend.type);
+	gp_write::write_int(buffer, bend.value);
+	gp_write::write_int(buffer, bend.points.size());
+	
+	for (const BendPoint &point : bend.points) {
+		gp_write::write_int(buffer, point.position);
+		gp_write::write_int(buffer, point.value);
+		gp_write::write_bool(buffer, point.vibrato);
+	}
+}
+
+void GPFile::write_grace_note(std::vector<char> &buffer, const GraceNote &graceNote) {
+	// same order as read_grace_note, which isn't the order of the struct
+	gp_write::write_signedbyte(buffer, graceNote.fret);
+	gp_write::write_byte(buffer, graceNote.dynamic);
+	gp_write::write_byte(buffer, graceNote.duration);
+	gp_write::write_byte(buffer, graceNote.transition);
 }
\ No newline at end of file
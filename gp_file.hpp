@@ -2,7 +2,26 @@
 #define GP_FILE_H
 
 #include <vector>
-#include <fstream>
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <memory_resource>
+
+#include "gp_read.hpp"
+#include "gp_string.hpp"
+#include "gp_alloc.hpp"
+#include "chunked_sequence.hpp"
+
+enum GPOpenFlags {
+	gp_open_default = 0x00,
+	gp_open_string_views = 0x01,	// strings are views into the file buffer, which the GPFile keeps alive
+	gp_open_lazy_measures = 0x02,	// measures are only located when the file is read, and decoded when they're first used
+	gp_open_arena = 0x04,	// the song's structures are allocated from a few large blocks, sized before parsing
+	gp_open_quiet = 0x08,	// errors are only stored in readError, not printed
+	gp_open_parallel = 0x10,	// a first pass finds where the measure blocks start, and they're decoded on a thread pool
+	gp_open_cache = 0x20	// with gp_open_lazy_measures, read_file takes the measures from an up to date cache of the file, or writes one
+};
 
 enum MeasureHeaderFlags {
 	gp_measure_keysig_numerator = 0x01,
@@ -113,7 +132,7 @@ struct MeasureHeader {
 	unsigned char keysigDenominator;
 	unsigned char repeatEnd;	// number of repeats
 	unsigned char altendNumber;
-	std::string markerName;
+	GPString markerName;
 	unsigned char markerColor[4];	// red, green, blue, white (white is always 0)
 	unsigned char tonalityRoot;	// key change: key signature root
 	unsigned char tonalityType;	// key change: key signature type
@@ -123,7 +142,7 @@ struct TrackHeader {
 	unsigned char trackFlags;	// indicates if the track is one of the special types:
 									// drums, 12 string guitar or banjo
 									
-	std::string name;
+	GPString name;
 	int stringCount;
 	int stringTuning[7];	// stored from thinnest to thickest
 	int midiPort;
@@ -137,7 +156,7 @@ struct TrackHeader {
 
 struct Chord {
 	bool newFormat;		// !! must be 0 for GP3 format !!
-	std::string name;
+	GPString name;
 	int diagramFirstFret;	// the fret to start diagram at,
 									// if this is 0 there is no diagram, and frets are not read
 	int diagramFrets[6];	// the frets played on each string, -1 means not played
@@ -186,7 +205,7 @@ struct Bend {
 	enum BendType type;
 	int value;
 	int pointCount;
-	std::vector<BendPoint> points;
+	gp_alloc::vector<BendPoint> points;
 };
 
 struct GraceNote {
@@ -236,7 +255,7 @@ struct Beat {
 	enum NoteDuration duration;
 	int tupletDivision;	// only if gp_beat_is_tuplet
 	Chord chordDiagram;	// only if gp_beat_has_chord
-	std::string text;	// only if gp_beat_has_text
+	GPString text;	// only if gp_beat_has_text
 	
 	// only if gp_beat_has_effects
 	BeatEffects effects;
@@ -247,24 +266,61 @@ struct Beat {
 
 struct Measure {
 	int beatCount;
-	std::vector<Beat> beats;
+	gp_alloc::vector<Beat> beats;
+};
+
+// a tempo change in the mix table of a beat, as it is in the file
+struct MixTempoChange {
+	int fileMeasure;
+	int trackIndex;
+	long long measureOffset;	// ticks from the start of the measure
+	int tempo;
+	int rampBeats;	// the tempo goes there over this many beats, 0 for a sudden change
+	long long rampTicks;	// how long those beats are, they can go on into the following measures
+};
+
+class SongCache;
+
+// a measure of the song where it is now, which can be somewhere else than where it was in the file
+// the edited header and tracks are shared copy on write, so rows are cheap to copy and move around
+struct MeasureRow {
+	int fileMeasure;	// the measure it was read as, -1 if it was inserted
+	std::shared_ptr<MeasureHeader> header;	// nullptr until the header is edited
+	std::vector<std::shared_ptr<Measure>> tracks;	// empty until a track is edited, then nullptr for the unedited ones
+};
+
+// how long each part of reading a song took, in milliseconds
+struct ReadTimes {
+	double loadFile = 0;	// only read_file loads the file
+	double openCache = 0;	// only with gp_open_cache
+	double metadata = 0;	// the version, read_metadata and the song settings after it
+	double midiChannels = 0;
+	double headers = 0;	// the measure and track headers
+	double measures = 0;	// decoding the measures, or only finding them with gp_open_lazy_measures
+	double writeCache = 0;	// only when gp_open_cache didn't find an up to date cache
+	
+	double total() const { return loadFile + openCache + metadata + midiChannels + headers + measures + writeCache; }
 };
 
 
 
 class GPFile {
+	private:
+		// everything the song owns is allocated from here, so it has to be created before any of it
+		std::shared_ptr<gp_alloc::SongMemory> memory = std::make_shared<gp_alloc::SongMemory>();
+	
 	public:
 		std::string version;
 		struct {
-			std::string title;
-			std::string subtitle;
-			std::string artist;
-			std::string album;
-			std::string words;
-			std::string copyright;
-			std::string tabbedBy;
-			std::string instructions;
-			std::vector<std::string> notice;
+			GPString title;
+			GPString subtitle;
+			GPString artist;
+			GPString album;
+			GPString words;
+			GPString copyright;
+			GPString tabbedBy;
+			GPString instructions;
+			std::vector<GPString> notice;
 		} metadata;
 		
 		bool tripletFeel;
@@ -273,32 +329,224 @@ class GPFile {
 		
 		MidiChannel midiChannels[4][16];
 		
-		int measureCount;
-		int trackCount;
+		int measureCount = 0;
+		int trackCount = 0;
+		
+		// as they were read, see measureRows
+		gp_alloc::vector<MeasureHeader> measureHeaders{memory.get()};
+		gp_alloc::vector<TrackHeader> trackHeaders{memory.get()};
+		
+		// measures[measureCount][trackCount] as they were read, empty with gp_open_lazy_measures
+		// edited measures are kept apart, get_measure returns whichever is current
+		gp_alloc::vector<gp_alloc::vector<Measure>> measures{memory.get()};
+		
+		// the measures in the order they're in now, measureCount of them
+		// the measure and header vectors above stay the way they were read, use get_measure and measure_header
+		ChunkedSequence<MeasureRow> measureRows;
+		
+		// where each measure block starts in the file, measureOffsets[measureIndex*trackCount + trackIndex]
+		// the extra last entry is where the last block ends
+		gp_alloc::vector<size_t> measureOffsets{memory.get()};
+		// where each measure header and then each track header starts, the extra last entry is where they end
+		gp_alloc::vector<size_t> headerOffsets{memory.get()};
+		
+		int openFlags = gp_open_default;
+		
+		// what went wrong the last time the song was read or written, empty if nothing did
+		std::string readError;
 		
-		std::vector<MeasureHeader> measureHeaders;
-		std::vector<TrackHeader> trackHeaders;
+		// filled in every time the song is read
+		ReadTimes readTimes;
 		
-		std::vector<std::vector<Measure>> measures;	// measures[measureCount][trackCount]
+		// the file the song was read from, only kept with gp_open_string_views or gp_open_lazy_measures
+		std::shared_ptr<const std::vector<char>> fileBuffer;
+		
+		// how many decoded measures are kept with gp_open_lazy_measures
+		size_t measureCacheSize = 64;
+		// how many threads decode the measures with gp_open_parallel, 0 means one per hardware thread
+		int parseThreadCount = 0;
 		
 		GPFile() { }
-		GPFile(std::ifstream &fileStream);
+		GPFile(gp_read::Cursor &cursor, int openFlags = gp_open_default);
+		// a copy would share the memory the song's containers allocate from, and reading into it would free
+		// the arena the original's measures are in, so a song can only be moved
+		// the containers keep pointing at the memory they were created with, so a song can't be assigned to
+		GPFile(const GPFile &) = delete;
+		GPFile(GPFile &&) = default;
+		GPFile &operator=(const GPFile &) = delete;
+		GPFile &operator=(GPFile &&) = delete;
+		// swaps everything with other, which is left holding the old song until it's destroyed
+		// references into the song are left dangling, like when it's read again
+		void replace(GPFile &&other);
+		
+		// how many allocations the song has made from the heap, and how many bytes it has allocated
+		// in arena mode that's the arena blocks, not the individual structures
+		size_t allocation_count() const { return memory->heap.allocations; }
+		size_t allocated_bytes() const { return memory->heap.bytesInUse; }
+		
+		int read_file(const std::string &filePath, int openFlags = gp_open_default);
+		// the same as read_file, for a file that has already been loaded into buffer
+		int read_buffer(const std::string &filePath, std::shared_ptr<const std::vector<char>> buffer, int openFlags = gp_open_default);
+		// with gp_open_string_views or gp_open_lazy_measures the cursor's buffer has to outlive the song,
+		// read_file takes care of that, otherwise fileBuffer has to be set by the caller
+		int read_song(gp_read::Cursor &cursor) { return read_song(cursor, nullptr); }
+		// whether the measures come from a cache of the file, rather than the file
+		bool read_from_cache() const { return this->songCache != nullptr; }
+		// how many measures get_measure has decoded with gp_open_lazy_measures, counting every time one left the cache
+		size_t decoded_measures() const { return this->decodedMeasures; }
+		// the tempo changes of the measures in the order of the file, noted while they were skipped,
+		// so they can be found without decoding every measure, nullptr without gp_open_lazy_measures
+		const std::vector<MixTempoChange> *read_tempo_changes() const {
+			return (this->openFlags & gp_open_lazy_measures) ? &this->tempoChanges : nullptr;
+		}
+		
+		// returns the measure, decoding it first if needed
+		// with gp_open_lazy_measures the reference is only guaranteed to stay valid
+		// until measureCacheSize-1 other measures have been decoded
+		Measure &get_measure(int measureIndex, int trackIndex);
+		const MeasureHeader &measure_header(int measureIndex) const;
+		
+		// the edit functions mark what's about to be changed, so write_changes knows what to encode again
+		// the measure returned by edit_measure stays valid until it's restored, edited again after
+		// edited_measure has shared it, or the song is read again
+		Measure &edit_measure(int measureIndex, int trackIndex);
+		MeasureHeader &edit_measure_header(int measureIndex);
+		TrackHeader &edit_track_header(int trackIndex);
+		// for the version, metadata, tempo, key and midi channels, which are edited directly
+		void edit_song_info();
+		bool has_edits() const;
+		
+		// the current version of an edited measure, nullptr if it hasn't been edited
+		// it's shared with the song, which copies it in edit_measure before changing it again,
+		// so keeping it costs nothing until the measure is edited
+		std::shared_ptr<Measure> edited_measure(int measureIndex, int trackIndex) const;
+		// makes a version returned by edited_measure current again, nullptr goes back to the measure as it was read
+		void restore_measure(int measureIndex, int trackIndex, std::shared_ptr<Measure> version);
+		// the same for the header of a measure
+		std::shared_ptr<MeasureHeader> edited_measure_header(int measureIndex) const;
+		void restore_measure_header(int measureIndex, std::shared_ptr<MeasureHeader> version);
+		
+		// inserting, removing and moving measures only moves their rows, a chunk of them at most,
+		// however long the song is, and write_changes still copies the unedited ones from the file
+		// new measures have the time signature of the one before them, and a whole rest in every track
+		std::vector<MeasureRow> make_measure_rows(int count) const;
+		void insert_measure_rows(int measureIndex, const std::vector<MeasureRow> &rows);
+		void insert_measures(int measureIndex, int count) { insert_measure_rows(measureIndex, make_measure_rows(count)); }
+		// returns the rows, so they can be put back with insert_measure_rows
+		std::vector<MeasureRow> remove_measures(int measureIndex, int count);
+		// moves count measures from measureIndex on so that they start at toIndex
+		void move_measures(int measureIndex, int count, int toIndex);
+		
+		int read_version(gp_read::Cursor &cursor);
+		int read_metadata(gp_read::Cursor &cursor);
+		int read_midi_channels(gp_read::Cursor &cursor);
+		MeasureHeader read_measure_header(gp_read::Cursor &cursor);
+		TrackHeader read_track_header(gp_read::Cursor &cursor);
+		Measure read_measure(gp_read::Cursor &cursor);
+		Beat read_beat(gp_read::Cursor &cursor);
+		Chord read_chord(gp_read::Cursor &cursor);
+		BeatEffects read_beat_effects(gp_read::Cursor &cursor);
+		MixChange read_mix_change(gp_read::Cursor &cursor);
+		Notes read_notes(gp_read::Cursor &cursor);
+		Note read_note(gp_read::Cursor &cursor);
+		Bend read_bend(gp_read::Cursor &cursor);
+		GraceNote read_grace_note(gp_read::Cursor &cursor);
+	
+		// where a track is while the blocks are skipped, the ramps of its tempo changes
+		// can go on into its following measures, and past the next change
+		struct TempoScan {
+			int fileMeasure = 0;
+			int trackIndex = 0;
+			std::vector<std::pair<size_t, int>> ramps;	// index into tempoChanges, and how many beats are left
+			
+			// counts the beat, or the empty measure, towards every ramp, and drops the ones that are done
+			void count_ramp_beat(std::vector<MixTempoChange> &changes, int ticks);
+		};
+		// with a tempoScan, the tempo changes in the block are added to tempoChanges
+		void skip_measure(gp_read::Cursor &cursor, TempoScan *tempoScan = nullptr);
+		// returns the length of the beat in ticks
+		int skip_beat(gp_read::Cursor &cursor, TempoScan *tempoScan, long long measureOffset);
+		void skip_chord(gp_read::Cursor &cursor);
+		void skip_beat_effects(gp_read::Cursor &cursor);
+		// returns the new tempo, -1 if it's unchanged, and how many beats the change takes in tempoDuration
+		int skip_mix_change(gp_read::Cursor &cursor, int &tempoDuration);
+		void skip_notes(gp_read::Cursor &cursor);
+		void skip_note(gp_read::Cursor &cursor);
+		void skip_bend(gp_read::Cursor &cursor);
+		
+		// serializes the song into one buffer and saves it with gp_write::save_file
+		// the editor can't edit a song yet, so only bench_parse calls these for now
+		int write_file(const std::string &filePath);
+		// appends the song to the buffer, in the format read_song reads
+		void write_song(std::vector<char> &buffer);
+		// same result as write_song, but only encodes what has been edited,
+		// everything else is copied from the file the song was read from
+		// falls back to write_song if the file wasn't kept, or didn't read cleanly
+		void write_changes(std::vector<char> &buffer);
+		void write_version(std::vector<char> &buffer);
+		void write_metadata(std::vector<char> &buffer);
+		void write_midi_channels(std::vector<char> &buffer);
+		void write_measure_header(std::vector<char> &buffer, const MeasureHeader &measure);
+		void write_track_header(std::vector<char> &buffer, const TrackHeader &track);
+		void write_measure(std::vector<char> &buffer, const Measure &measure);
+		void write_beat(std::vector<char> &buffer, const Beat &beat);
+		void write_chord(std::vector<char> &buffer, const Chord &chord);
+		void write_beat_effects(std::vector<char> &buffer, const BeatEffects &effects);
+		void write_mix_change(std::vector<char> &buffer, const MixChange &change);
+		void write_notes(std::vector<char> &buffer, const Notes &notes);
+		void write_note(std::vector<char> &buffer, const Note &note);
+		void write_bend(std::vector<char> &buffer, const Bend &bend);
+		void write_grace_note(std::vector<char> &buffer, const GraceNote &graceNote);
+	
+	private:
+		GPString make_string(std::string_view value);
+		// reads an IntByteString, and reports it the first time the cursor reads one whose two lengths don't agree
+		std::string_view read_string(gp_read::Cursor &cursor);
+		// stores and prints the error, returns 1 so it can be returned directly
+		int report_error(const std::string &message);
+		
+		// frees everything the previous song allocated, and releases the arena
+		void release_song_data();
+		// what read_measure allocates the measure's beats from
+		std::pmr::memory_resource *measure_resource();
+		
+		// with a cache, the blocks aren't walked through, and the measures are copied out of its tables when they're used
+		std::shared_ptr<const SongCache> songCache;
+		int read_song(gp_read::Cursor &cursor, std::shared_ptr<const SongCache> cache);
+		// a measure as it is in the file, from the cache if there is one
+		Measure decode_measure(int fileMeasure, int trackIndex);
+		
+		// the two passes of gp_open_parallel, the first moves the cursor past the measure blocks
+		// the way the read loop would and notes where each starts, the second decodes them into measures
+		void locate_measures(gp_read::Cursor &cursor, std::vector<size_t> &blockStarts);
+		void read_measures_parallel(const gp_read::Cursor &cursor, const std::vector<size_t> &blockStarts, size_t blocksEnd);
+		
+		// counted by skip_bend, for sizing the arena
+		size_t skippedBendPoints = 0;
+		
+		// see read_tempo_changes
+		std::vector<MixTempoChange> tempoChanges;
+		// adds the beat to the ramp going on in the track, after noting the tempo change the beat starts, if any
+		void scan_beat_tempo(TempoScan &scan, long long measureOffset, int ticks, int tempo, int tempoDuration);
+		// the cache has no blocks to skip, so its tables are gone through instead
+		void scan_cached_tempo_changes();
+		
+		// most recently used first
+		std::list<std::pair<int, Measure>> measureCache;
+		std::unordered_map<int, std::list<std::pair<int, Measure>>::iterator> measureCacheIndex;
+		size_t decodedMeasures = 0;
+		
+		// what has been edited since the song was read, the edited measures and their headers are in measureRows
+		bool songInfoEdited = false;
+		bool measuresMoved = false;
+		std::vector<bool> editedTrackHeaders;	// empty until the first track header is edited
 		
-		int read_song(std::ifstream &fileStream);
-		int read_version(std::ifstream &fileStream);
-		int read_metadata(std::ifstream &fileStream);
-		int read_midi_channels(std::ifstream &fileStream);
-		MeasureHeader read_measure_header(std::ifstream &fileStream);
-		TrackHeader read_track_header(std::ifstream &fileStream);
-		Measure read_measure(std::ifstream &fileStream);
-		Beat read_beat(std::ifstream &fileStream);
-		Chord read_chord(std::ifstream &fileStream);
-		BeatEffects read_beat_effects(std::ifstream &fileStream);
-		MixChange read_mix_change(std::ifstream &fileStream);
-		Notes read_notes(std::ifstream &fileStream);
-		Note read_note(std::ifstream &fileStream);
-		Bend read_bend(std::ifstream &fileStream);
-		GraceNote read_grace_note(std::ifstream &fileStream);
+		Measure &row_measure(const MeasureRow &row, int trackIndex);
+		const MeasureHeader &row_header(const MeasureRow &row) const {
+			return row.header ? *row.header : this->measureHeaders[row.fileMeasure];
+		}
+		// drops the decoded copy of a measure from the cache, once it's been replaced by an edited one
+		void uncache_measure(const MeasureRow &row, int trackIndex);
 };
 
 #endif // !GP_FILE_H
\ No newline at end of file
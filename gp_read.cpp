@@ -1,68 +1,106 @@
-#include <iostream>
 #include <fstream>
 
 #include "gp_read.hpp"
 
 namespace gp_read {
-	unsigned char read_byte(std::ifstream &fileStream) {
-		char buffer[1];
-		fileStream.read(buffer, sizeof(buffer));
-		return (unsigned char)buffer[0];
+	int load_file(const std::string &filePath, std::vector<char> &buffer) {
+		std::ifstream fileStream(filePath, std::ios::in|std::ios::binary|std::ios::ate);
+		if (!fileStream) {
+			return 1;
+		}
+
+		std::streamoff fileSize = fileStream.tellg();
+		if (fileSize < 0) {
+			return 1;
+		}
+
+		buffer.resize(fileSize);
+		fileStream.seekg(0);
+		fileStream.read(buffer.data(), fileSize);
+
+		return fileStream.gcount() == fileSize ? 0 : 1;
+	}
+
+	unsigned char read_byte(Cursor &cursor) {
+		const char *buffer = cursor.take(1);
+		return buffer ? (unsigned char)buffer[0] : 0;
 	}
-	
-	char read_signedbyte(std::ifstream &fileStream) {
-		char buffer[1];
-		fileStream.read(buffer, sizeof(buffer));
-		return buffer[0];
+
+	char read_signedbyte(Cursor &cursor) {
+		const char *buffer = cursor.take(1);
+		return buffer ? buffer[0] : 0;
 	}
-	
-	bool read_bool(std::ifstream &fileStream) {
-		char buffer[1];
-		fileStream.read(buffer, sizeof(buffer));
-		return (bool)buffer[0];
+
+	bool read_bool(Cursor &cursor) {
+		const char *buffer = cursor.take(1);
+		return buffer ? (bool)buffer[0] : false;
 	}
-	
-	short read_short(std::ifstream &fileStream) {
-		char buffer[2];
-		fileStream.read(buffer, sizeof(buffer));
+
+	short read_short(Cursor &cursor) {
+		const char *buffer = cursor.take(2);
+		if (!buffer) {
+			return 0;
+		}
 		return (unsigned char)(buffer[0]) | (unsigned char)(buffer[1]) << 8;
 	}
-	
-	int read_int(std::ifstream &fileStream) {
-		char buffer[4];
-		fileStream.read(buffer, sizeof(buffer));
+
+	int read_int(Cursor &cursor) {
+		const char *buffer = cursor.take(4);
+		if (!buffer) {
+			return 0;
+		}
 		return (unsigned char)(buffer[0]) | (unsigned char)(buffer[1]) << 8 |
 				 (unsigned char)(buffer[2]) << 16 | (unsigned char)(buffer[3]) << 24;
 	}
-	
-	std::string read_bytestring(std::ifstream &fileStream) {
-		int length = read_byte(fileStream);
-		char buffer[length + 1];
-		fileStream.read(buffer, length);
-		buffer[length] = 0; // null termination
-		return buffer;
+
+	// the length fields come straight from the file, so they can't be trusted,
+	// a negative or too large length marks the cursor as overrun
+	static std::string_view read_chars(Cursor &cursor, int length) {
+		if (length < 0) {
+			cursor.take(cursor.remaining() + 1);
+			return std::string_view();
+		}
+
+		const char *buffer = cursor.take(length);
+		if (!buffer) {
+			return std::string_view();
+		}
+		return std::string_view(buffer, length);
 	}
-	
-	std::string read_intstring(std::ifstream &fileStream) {
-		int length = read_int(fileStream);
-		char buffer[length + 1];
-		fileStream.read(buffer, length);
-		buffer[length] = 0; // null termination
-		return buffer;
+
+	std::string_view read_bytestring_view(Cursor &cursor) {
+		int length = read_byte(cursor);
+		return read_chars(cursor, length);
 	}
-	
-	std::string read_intbytestring(std::ifstream &fileStream) {
-		int lengthInt = read_int(fileStream);
-		int lengthByte = read_byte(fileStream);
+
+	std::string_view read_intstring_view(Cursor &cursor) {
+		int length = read_int(cursor);
+		return read_chars(cursor, length);
+	}
+
+	std::string_view read_intbytestring_view(Cursor &cursor) {
+		int lengthInt = read_int(cursor);
+		int lengthByte = read_byte(cursor);
 
 		if (lengthInt != lengthByte + 1) {
-			std::cerr << "Error: Mismatched string lengths in IntByteString.\n";
-			return "";
+			if (cursor.error == nullptr) {
+				cursor.error = "Mismatched string lengths in IntByteString.";
+			}
+			return std::string_view();
 		}
 
-		char buffer[lengthByte + 1];
-		fileStream.read(buffer, lengthByte);
-		buffer[lengthByte] = 0; // null termination
-		return buffer;
+		return read_chars(cursor, lengthByte);
+	}
+
+	std::string read_bytestring(Cursor &cursor) {
+		return std::string(read_bytestring_view(cursor));
+	}
+
+	std::string read_intstring(Cursor &cursor) {
+		return std::string(read_intstring_view(cursor));
+	}
+
+	std::string read_intbytestring(Cursor &cursor) {
+		return std::string(read_intbytestring_view(cursor));
 	}
 }
\ No newline at end of file
@@ -1,18 +1,65 @@
 #ifndef GP_READ_H
 #define GP_READ_H
 
-#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
 
 namespace gp_read
 {
-	unsigned char read_byte(std::ifstream &fileStream);
-	char read_signedbyte(std::ifstream &fileStream);
-	bool read_bool(std::ifstream &fileStream);
-	short read_short(std::ifstream &fileStream);
-	int read_int(std::ifstream &fileStream);
-	std::string read_bytestring(std::ifstream &fileStream);
-	std::string read_intstring(std::ifstream &fileStream);
-	std::string read_intbytestring(std::ifstream &fileStream);
+	// reads the whole file into memory with a single read call
+	int load_file(const std::string &filePath, std::vector<char> &buffer);
+
+	// a bounds-checked position in an in-memory file
+	// reading past the end doesn't throw, instead the read returns zeroes and overrun is set,
+	// so the caller only has to check once when it's done
+	class Cursor {
+		public:
+			const char *data;
+			size_t size;
+			size_t position;
+			bool overrun;
+			// the first thing that was wrong with the data, other than it ending too soon, nullptr if nothing was
+			// the reads don't print anything, it's up to the caller to report it
+			const char *error;
+
+			Cursor(const char *data, size_t size) : data(data), size(size), position(0), overrun(false), error(nullptr) { }
+			Cursor(const std::vector<char> &buffer) : Cursor(buffer.data(), buffer.size()) { }
+
+			size_t remaining() const { return position < size ? size - position : 0; }
+
+			// returns a pointer to the next `length` bytes and moves past them,
+			// or nullptr if there aren't that many bytes left
+			const char *take(size_t length) {
+				if (overrun || length > remaining()) {
+					overrun = true;
+					position = size;
+					return nullptr;
+				}
+				const char *bytes = data + position;
+				position += length;
+				return bytes;
+			}
+
+			void skip(size_t length) {
+				take(length);
+			}
+	};
+
+	unsigned char read_byte(Cursor &cursor);
+	char read_signedbyte(Cursor &cursor);
+	bool read_bool(Cursor &cursor);
+	short read_short(Cursor &cursor);
+	int read_int(Cursor &cursor);
+	std::string read_bytestring(Cursor &cursor);
+	std::string read_intstring(Cursor &cursor);
+	std::string read_intbytestring(Cursor &cursor);
+	
+	// same as above, but the returned views point into the cursor's buffer instead of copying
+	std::string_view read_bytestring_view(Cursor &cursor);
+	std::string_view read_intstring_view(Cursor &cursor);
+	std::string_view read_intbytestring_view(Cursor &cursor);
 };
 
 #endif // !GP_READ_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef GP_STRING_H
+#define GP_STRING_H
+
+#include <string>
+#include <string_view>
+
+// a string read from a gp3 file
+// it's either a view into the file buffer the song was read from (see gp_open_string_views),
+// or an owned copy. assigning a new value always makes it owned, so the file buffer is never written to.
+// a view isn't null terminated, so print it with "%.*s" or use str() to get a copy
+class GPString {
+	public:
+		GPString() { }
+		GPString(const std::string &value) : ownedValue(value) { }
+		GPString(std::string &&value) : ownedValue(std::move(value)) { }
+		GPString(const char *value) : ownedValue(value) { }
+
+		static GPString view(std::string_view value) {
+			GPString string;
+			string.viewedValue = value;
+			string.isView = true;
+			return string;
+		}
+
+		GPString &operator=(const std::string &value) {
+			ownedValue = value;
+			viewedValue = std::string_view();
+			isView = false;
+			return *this;
+		}
+		GPString &operator=(const char *value) {
+			return *this = std::string(value);
+		}
+
+		std::string_view view() const { return isView ? viewedValue : std::string_view(ownedValue); }
+		operator std::string_view() const { return view(); }
+		std::string str() const { return std::string(view()); }
+
+		const char *data() const { return view().data(); }
+		int length() const { return view().length(); }
+		bool empty() const { return view().empty(); }
+		bool owned() const { return !isView; }
+
+		// replaces a view with an owned copy of the same text
+		void materialize() {
+			if (isView) {
+				*this = str();
+			}
+		}
+
+		bool operator==(std::string_view other) const { return view() == other; }
+		bool operator!=(std::string_view other) const { return view() != other; }
+
+	private:
+		std::string ownedValue;
+		std::string_view viewedValue;
+		bool isView = false;
+};
+
+#endif // !GP_STRING_H
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <string>
+#include <cstdio>
+
+#ifdef _WIN32
+	#include <fstream>
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+	#include <cerrno>
+#endif
+
+#include "gp_write.hpp"
+
+namespace gp_write {
+#ifdef _WIN32
+	int save_file(const std::string &filePath, const std::vector<char> &buffer, bool durable) {
+		std::string tempPath = filePath + ".tmp";
+
+		std::ofstream fileStream(tempPath, std::ios::out|std::ios::binary|std::ios::trunc);
+		fileStream.write(buffer.data(), buffer.size());
+		fileStream.close();
+		if (!fileStream) {
+			std::remove(tempPath.c_str());
+			return 1;
+		}
+
+		// write through makes the move wait until it's on disk
+		DWORD moveFlags = MOVEFILE_REPLACE_EXISTING | (durable ? MOVEFILE_WRITE_THROUGH : 0);
+		if (!MoveFileExA(tempPath.c_str(), filePath.c_str(), moveFlags)) {
+			std::remove(tempPath.c_str());
+			return 1;
+		}
+		return 0;
+	}
+#else
+	static int write_all(int fileDescriptor, const char *data, size_t length) {
+		// a single write unless it gets interrupted, or the file system only takes part of it
+		while (length > 0) {
+			ssize_t written = write(fileDescriptor, data, length);
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return 1;
+			}
+			data += written;
+			length -= written;
+		}
+		return 0;
+	}
+
+	int save_file(const std::string &filePath, const std::vector<char> &buffer, bool durable) {
+		// the temporary file has to be in the same directory, rename only replaces atomically within a file system
+		std::string tempPath = filePath + ".XXXXXX";
+		int fileDescriptor = mkstemp(&tempPath[0]);
+		if (fileDescriptor < 0) {
+			return 1;
+		}
+
+		// mkstemp only gives the owner access, keep whatever permissions the file had
+		struct stat fileStatus;
+		if (stat(filePath.c_str(), &fileStatus) == 0) {
+			fchmod(fileDescriptor, fileStatus.st_mode & 07777);
+		}
+		else {
+			mode_t mask = umask(0);
+			umask(mask);
+			fchmod(fileDescriptor, 0666 & ~mask);
+		}
+
+		if (write_all(fileDescriptor, buffer.data(), buffer.size()) != 0 || (durable && fsync(fileDescriptor) != 0)) {
+			close(fileDescriptor);
+			unlink(tempPath.c_str());
+			return 1;
+		}
+		if (close(fileDescriptor) != 0 || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+			unlink(tempPath.c_str());
+			return 1;
+		}
+		if (!durable) {
+			return 0;
+		}
+
+		// the rename itself is only durable once the directory is synced
+		size_t separator = filePath.find_last_of('/');
+		std::string directory = separator == std::string::npos ? "." : filePath.substr(0, separator+1);
+		int directoryDescriptor = open(directory.c_str(), O_RDONLY);
+		if (directoryDescriptor >= 0) {
+			fsync(directoryDescriptor);
+			close(directoryDescriptor);
+		}
+		return 0;
+	}
+#endif
+
+	void write_byte(std::vector<char> &buffer, unsigned char value) {
+		buffer.push_back((char)value);
+	}
+
+	void write_signedbyte(std::vector<char> &buffer, char value) {
+		buffer.push_back(value);
+	}
+
+	void write_bool(std::vector<char> &buffer, bool value) {
+		buffer.push_back(value ? 1 : 0);
+	}
+
+	void write_short(std::vector<char> &buffer, short value) {
+		char bytes[2] = { (char)(value), (char)(value >> 8) };
+		buffer.insert(buffer.end(), bytes, bytes + 2);
+	}
+
+	void write_int(std::vector<char> &buffer, int value) {
+		char bytes[4] = { (char)(value), (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+		buffer.insert(buffer.end(), bytes, bytes + 4);
+	}
+
+	void write_bytestring(std::vector<char> &buffer, std::string_view value) {
+		value = value.substr(0, 255);
+		write_byte(buffer, value.length());
+		buffer.insert(buffer.end(), value.begin(), value.end());
+	}
+
+	void write_intstring(std::vector<char> &buffer, std::string_view value) {
+		write_int(buffer, value.length());
+		buffer.insert(buffer.end(), value.begin(), value.end());
+	}
+
+	void write_intbytestring(std::vector<char> &buffer, std::string_view value) {
+		value = value.substr(0, 255);
+		write_int(buffer, value.length() + 1);
+		write_bytestring(buffer, value);
+	}
+
+	void write_padding(std::vector<char> &buffer, size_t length) {
+		buffer.insert(buffer.end(), length, 0);
+	}
+}
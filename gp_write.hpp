@@ -0,0 +1,31 @@
+#ifndef GP_WRITE_H
+#define GP_WRITE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace gp_write
+{
+	// writes the buffer to a temporary file next to filePath, syncs it to disk and renames it over filePath,
+	// so a crash leaves either the old file or the new one, never half of each
+	// without durable the syncs are left out, for files that are cheap to make again, like exports
+	int save_file(const std::string &filePath, const std::vector<char> &buffer, bool durable = true);
+
+	// the writers append to the end of the buffer, in the same format the gp_read functions read
+	void write_byte(std::vector<char> &buffer, unsigned char value);
+	void write_signedbyte(std::vector<char> &buffer, char value);
+	void write_bool(std::vector<char> &buffer, bool value);
+	void write_short(std::vector<char> &buffer, short value);
+	void write_int(std::vector<char> &buffer, int value);
+	// strings longer than a length byte can hold are cut off
+	void write_bytestring(std::vector<char> &buffer, std::string_view value);
+	void write_intstring(std::vector<char> &buffer, std::string_view value);
+	void write_intbytestring(std::vector<char> &buffer, std::string_view value);
+
+	// fills out fixed size fields, like the bytestrings that are always followed by padding up to a set length
+	void write_padding(std::vector<char> &buffer, size_t length);
+};
+
+#endif // !GP_WRITE_H
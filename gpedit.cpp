@@ -1,29 +1,112 @@
 #include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <chrono>
 
 #include "gpedit.hpp"
 #include "gp_file.hpp"
+#include "tempo_map.hpp"
+#include "edit_history.hpp"
+#include "song_reload.hpp"
+#include "file_watcher.hpp"
+#include "perf_hud.hpp"
 
 GPFile song;
 std::string songFilePath;
+TempoMap tempoMap;
+EditHistory editHistory;
 
 int keyboardInput;
 
 int trackIndex = 0;
 
-int openFile(std::string filePath) {
+// the strings are only displayed, so they can point into the file buffer,
+// and measures are only decoded once they're displayed
+// errors are shown in the song info, printing them would write over the screen
+// writing the cache takes a full read of the song on top, so it's only done when asked for
+static const int defaultOpenFlags = gp_open_string_views|gp_open_lazy_measures|gp_open_quiet;
+static int songOpenFlags = defaultOpenFlags;
+
+static FileWatcher fileWatcher;
+static SongReload songReload;
+static bool changedWhileReading = false;
+
+int openFile(std::string filePath, bool useCache) {
 	songFilePath = filePath;
-	// open file
-	std::ifstream fileStream(filePath, std::ios::in|std::ios::binary);
-	if (!fileStream) {
-		std::cerr << "Error opening file.\n";
+	songOpenFlags = useCache ? defaultOpenFlags|gp_open_cache : defaultOpenFlags;
+	
+	// the history's measures point into the old file
+	editHistory.clear();
+	
+	// read the whole file into memory and parse it
+	if (song.read_file(filePath, songOpenFlags) != 0) {
 		return 1;
 	}
 	
-	// read file
-	song.read_song(fileStream);
-	
-	fileStream.close();
+	// the song noted its tempo changes while it skipped the measures, after that it's only updated when something is edited
+	auto startTime = std::chrono::steady_clock::now();
+	if (tempoMap.build(song) != 0) {
+		return 1;
+	}
+	editorTimings.tempoMap = millisecondsSince(startTime);
 	
+	// if the file can't be watched, changes to it just aren't shown
+	fileWatcher.watch(filePath);
 	return 0;
+}
+
+bool reloadChangedFile(SongChanges &changes, bool (*confirmReload)()) {
+	if (fileWatcher.changed()) {
+		// it's read again after the version being read now, which may already be out of date
+		if (songReload.running()) {
+			changedWhileReading = true;
+		}
+		else {
+			songReload.start(song, songFilePath, songOpenFlags);
+		}
+	}
+	if (!songReload.running() || !songReload.finished()) {
+		return false;
+	}
+	
+	// a version that can't be read is probably still being written, the next write will be read again
+	int status = 1;
+	if (songReload.has_new_version() && song.has_edits() && !confirmReload()) {
+		songReload.discard();
+	}
+	else {
+		status = songReload.apply(song, changes);
+	}
+	if (changedWhileReading) {
+		changedWhileReading = false;
+		songReload.start(song, songFilePath, songOpenFlags);
+	}
+	if (status != 0 || (!changes.everything && changes.measures.empty())) {
+		return false;
+	}
+	
+	// the history's measures point into the old file
+	editHistory.clear();
+	trackIndex = std::min(trackIndex, std::max(song.trackCount-1, 0));
+	
+	// a different song, or a lot of changes, are quicker to count up again from scratch
+	auto startTime = std::chrono::steady_clock::now();
+	if (changes.everything || (int)changes.measures.size() > song.measureCount/4) {
+		tempoMap.build(song);
+		editorTimings.tempoMap = millisecondsSince(startTime);
+		return true;
+	}
+	// the first changed header moves every measure after it, so one update covers the rest
+	for (const MeasureChange &change : changes.measures) {
+		if (change.headerChanged) {
+			tempoMap.update_measure_header(song, change.measureIndex);
+			break;
+		}
+	}
+	for (const MeasureChange &change : changes.measures) {
+		if (!change.tracks.empty()) {
+			tempoMap.update_measure(song, change.measureIndex);
+		}
+	}
+	editorTimings.tempoMap = millisecondsSince(startTime);
+	return true;
 }
\ No newline at end of file
@@ -2,14 +2,26 @@
 #define GPEDIT_H
 
 #include "gp_file.hpp"
+#include "tempo_map.hpp"
+#include "edit_history.hpp"
+#include "song_reload.hpp"
 
 extern GPFile song;
 extern std::string songFilePath;
+// built when the song is opened
+extern TempoMap tempoMap;
+// the edits to the song, cleared when a song is opened
+extern EditHistory editHistory;
 
 extern int keyboardInput;
 
 extern int trackIndex;
 
-int openFile(std::string filePath);
+// with useCache the measures are read from FILE.gpcache, which is written first if it's missing or out of date
+int openFile(std::string filePath, bool useCache = false);
+// reads the song again in the background once another program has changed its file,
+// returns true when a new version has been put in song, with what's different from the one before
+// if the song has edits that would be lost, confirmReload is asked first, and the new version is dropped unless it returns true
+bool reloadChangedFile(SongChanges &changes, bool (*confirmReload)());
 
 #endif // !GPEDIT_H
\ No newline at end of file
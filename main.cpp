@@ -1,4 +1,6 @@
 #include <iostream>
+#include <string>
+#include <filesystem>
 
 #ifdef _WIN32
 	#include <curses.h>
@@ -9,15 +11,130 @@
 #include "gpedit.hpp"
 #include "windows.hpp"
 #include "editing.hpp"
+#include "stacked_view.hpp"
+#include "scan.hpp"
+#include "tab_render.hpp"
+#include "midi_export.hpp"
+#include "audio_engine.hpp"
+#include "riff_index.hpp"
 
+static const char *usage =
+	"Usage: gpedit [--cache] FILE\n"
+	"       gpedit --scan DIR\n"
+	"       gpedit --render FILE [--track N] [--width COLUMNS] [--cache]\n"
+	"       gpedit --export-midi FILE OUT.mid\n"
+	"       gpedit --export-midi DIR OUTDIR\n"
+	"       gpedit --render-audio FILE [OUT.wav]\n"
+	"       gpedit --index DIR [INDEX]\n"
+	"       gpedit --find \"0 3 5 3\" [INDEX]\n";
+
+// where --index and --find keep the index without one given
+static const char *defaultIndexPath = "gpedit.index";
+
+// reads the value of an option like --track N, returns false if it's missing or not a number
+static bool readIntOption(int argc, char const *argv[], int &index, int &value) {
+	if (index+1 >= argc) {
+		return false;
+	}
+	try {
+		value = std::stoi(argv[++index]);
+	}
+	catch (const std::exception &) {
+		return false;
+	}
+	return true;
+}
 
 int main(int argc, char const *argv[]) {
-	if (argc != 2) {
-		std::cerr << "Invalid arguments.\n\nUsage: gpedit FILE\n";
+	std::string mode = argc >= 2 ? argv[1] : "";
+	
+	// headless modes
+	if (mode == "--scan") {
+		if (argc != 3) {
+			std::cerr << "Invalid arguments.\n\n" << usage;
+			return 1;
+		}
+		return scanDirectory(argv[2], std::cout);
+	}
+	if (mode == "--render") {
+		int trackNumber = 1;
+		int lineWidth = 80;
+		bool useCache = false;
+		bool validArguments = argc >= 3;
+		
+		for (int i = 3; i < argc && validArguments; i++) {
+			std::string option = argv[i];
+			if (option == "--track") {
+				validArguments = readIntOption(argc, argv, i, trackNumber);
+			}
+			else if (option == "--width") {
+				validArguments = readIntOption(argc, argv, i, lineWidth) && lineWidth > 0;
+			}
+			else if (option == "--cache") {
+				useCache = true;
+			}
+			else {
+				validArguments = false;
+			}
+		}
+		
+		if (!validArguments) {
+			std::cerr << "Invalid arguments.\n\n" << usage;
+			return 1;
+		}
+		return renderFile(argv[2], trackNumber, lineWidth, useCache, std::cout);
+	}
+	if (mode == "--export-midi") {
+		if (argc != 4) {
+			std::cerr << "Invalid arguments.\n\n" << usage;
+			return 1;
+		}
+		if (std::filesystem::is_directory(argv[2])) {
+			return exportMidiDirectory(argv[2], argv[3]);
+		}
+		return exportMidiFile(argv[2], argv[3]);
+	}
+	if (mode == "--render-audio") {
+		if (argc != 3 && argc != 4) {
+			std::cerr << "Invalid arguments.\n\n" << usage;
+			return 1;
+		}
+		return renderAudioFile(argv[2], argc == 4 ? argv[3] : "", std::cout);
+	}
+	if (mode == "--index" || mode == "--find") {
+		if (argc != 3 && argc != 4) {
+			std::cerr << "Invalid arguments.\n\n" << usage;
+			return 1;
+		}
+		std::string indexPath = argc == 4 ? argv[3] : defaultIndexPath;
+		if (mode == "--index") {
+			return buildRiffIndex(argv[2], indexPath, std::cout);
+		}
+		return findRiff(argv[2], indexPath, std::cout);
+	}
+	
+	std::string filePath;
+	bool useCache = false;
+	bool validArguments = true;
+	for (int i = 1; i < argc && validArguments; i++) {
+		std::string option = argv[i];
+		if (option == "--cache") {
+			useCache = true;
+		}
+		else if (option.rfind("--", 0) == 0 || !filePath.empty()) {
+			validArguments = false;
+		}
+		else {
+			filePath = option;
+		}
+	}
+	if (!validArguments || filePath.empty()) {
+		std::cerr << "Invalid arguments.\n\n" << usage;
 		return 1;
 	}
 	
-	if(openFile(argv[1]) != 0) {
+	if(openFile(filePath, useCache) != 0) {
+		std::cerr << filePath << ": " << song.readError << "\n";
 		return 1;
 	}
 	
@@ -39,6 +156,13 @@ int main(int argc, char const *argv[]) {
 		if (keyboardInput == 27) {
 			break;
 		}
+		if (keyboardInput == 'a') {
+			// enter opens the track the selection is on, escape goes back to the track list
+			viewAllTracks();
+			if (keyboardInput != 10) {
+				continue;
+			}
+		}
 		editTab();
 	}
 	
@@ -0,0 +1,70 @@
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "mapped_file.hpp"
+#include "gp_read.hpp"
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+int MappedFile::open(const std::string &filePath) {
+	close();
+	if (gp_read::load_file(filePath, this->buffer) != 0) {
+		return 1;
+	}
+	this->address = this->buffer.data();
+	this->length = this->buffer.size();
+	return 0;
+}
+
+void MappedFile::close() {
+	this->buffer.clear();
+	this->buffer.shrink_to_fit();
+	this->address = nullptr;
+	this->length = 0;
+}
+#else
+int MappedFile::open(const std::string &filePath) {
+	close();
+
+	int fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return 1;
+	}
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0) {
+		::close(fileDescriptor);
+		return 1;
+	}
+
+	// an empty file can't be mapped, but it's still a file
+	if (fileStatus.st_size > 0) {
+		void *mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED) {
+			::close(fileDescriptor);
+			return 1;
+		}
+		this->address = (const char *)mapping;
+		this->length = fileStatus.st_size;
+	}
+
+	// the mapping stays valid without the descriptor
+	::close(fileDescriptor);
+	return 0;
+}
+
+void MappedFile::close() {
+	if (this->address != nullptr) {
+		munmap((void *)this->address, this->length);
+	}
+	this->address = nullptr;
+	this->length = 0;
+}
+#endif
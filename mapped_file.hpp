@@ -0,0 +1,33 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// a whole file mapped read only into memory, pages are only read from the disk when they're touched
+// on windows the file is read into memory instead
+class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		// returns 1 if the file can't be opened or mapped
+		int open(const std::string &filePath);
+		void close();
+
+		const char *data() const { return this->address; }
+		size_t size() const { return this->length; }
+
+	private:
+		const char *address = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		std::vector<char> buffer;
+#endif
+};
+
+#endif // !MAPPED_FILE_H
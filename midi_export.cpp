@@ -0,0 +1,325 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <filesystem>
+#include <atomic>
+
+#include "midi_export.hpp"
+#include "tempo_map.hpp"
+#include "beat_index.hpp"
+#include "gp_file.hpp"
+#include "gp_write.hpp"
+#include "scan.hpp"
+#include "thread_pool.hpp"
+
+int getNotePitch(const TrackHeader &track, int stringIndex, int fret) {
+	if (track.trackFlags & gp_track_drums) {
+		return std::max(std::min(fret, 127), 0);
+	}
+	return std::max(std::min(track.stringTuning[stringIndex] + track.capo + fret, 127), 0);
+}
+
+int getNoteVelocity(const Note &note) {
+	// gp3 dynamics go from 1 (ppp) to 8 (fff), notes without one are forte
+	int dynamic = (note.noteFlags & gp_note_has_dynamics) ? note.dynamic : 6;
+	int velocity = 15 + (dynamic-1)*16;
+
+	if (note.noteFlags & gp_note_is_ghost) {
+		velocity -= 32;
+	}
+	if (note.noteFlags & (gp_note_is_accent|gp_note_is_heavy_accent)) {
+		velocity += 16;
+	}
+	return std::max(std::min(velocity, 127), 1);
+}
+
+int getChannelValue(int value) {
+	return std::max(std::min(value*8 - 1, 127), 0);
+}
+
+// appends a track chunk to the buffer, events have to be added in order of their ticks
+class MidiTrack {
+	public:
+		MidiTrack(std::vector<char> &buffer) : buffer(buffer) {
+			this->buffer.insert(this->buffer.end(), { 'M', 'T', 'r', 'k', 0, 0, 0, 0 });
+			this->chunkStart = this->buffer.size();
+		}
+
+		void event(long long tick, unsigned char status, unsigned char data1, unsigned char data2) {
+			write_delta(tick);
+			// running status, consecutive events of the same kind leave out the status byte
+			if (status != this->runningStatus) {
+				this->buffer.push_back(status);
+				this->runningStatus = status;
+			}
+			this->buffer.push_back(data1 & 0x7f);
+			if ((status & 0xf0) != 0xc0 && (status & 0xf0) != 0xd0) {	// program change and channel pressure have one data byte
+				this->buffer.push_back(data2 & 0x7f);
+			}
+		}
+
+		void meta(long long tick, unsigned char type, const char *data, size_t length) {
+			write_delta(tick);
+			this->buffer.push_back((char)0xff);
+			this->buffer.push_back(type);
+			write_number(length);
+			this->buffer.insert(this->buffer.end(), data, data + length);
+			this->runningStatus = 0;
+		}
+
+		// writes the end of track event and fills in the length of the chunk
+		void end(long long tick) {
+			meta(tick, 0x2f, nullptr, 0);
+
+			size_t length = this->buffer.size() - this->chunkStart;
+			for (int i = 0; i < 4; i++) {
+				this->buffer[this->chunkStart - 4 + i] = (char)(length >> (8*(3-i)));
+			}
+		}
+
+	private:
+		std::vector<char> &buffer;
+		size_t chunkStart;
+		long long lastTick = 0;
+		unsigned char runningStatus = 0;
+
+		// a variable length number, 7 bits per byte with the most significant first
+		void write_number(unsigned long long value) {
+			unsigned char bytes[10];
+			int count = 0;
+			do {
+				bytes[count++] = value & 0x7f;
+				value >>= 7;
+			} while (value > 0);
+			while (count > 1) {
+				this->buffer.push_back(bytes[--count] | 0x80);
+			}
+			this->buffer.push_back(bytes[0]);
+		}
+
+		void write_delta(long long tick) {
+			write_number(std::max(tick - this->lastTick, 0LL));
+			this->lastTick = std::max(tick, this->lastTick);
+		}
+};
+
+static void writeTempoTrack(GPFile &song, const TempoMap &tempoMap, std::vector<char> &buffer) {
+	MidiTrack track(buffer);
+
+	std::string_view title = song.metadata.title;
+	track.meta(0, 0x03, title.data(), title.length());
+
+	// time signatures, at the start of the measures that change them
+	int numerator = 4;
+	int denominator = 4;
+	for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+		const MeasureHeader &header = song.measure_header(measureIndex);
+		if (!(header.measureFlags & (gp_measure_keysig_numerator|gp_measure_keysig_denominator)) && measureIndex > 0) {
+			continue;
+		}
+		if (header.measureFlags & gp_measure_keysig_numerator) {
+			numerator = std::max((int)header.keysigNumerator, 1);
+		}
+		if (header.measureFlags & gp_measure_keysig_denominator) {
+			denominator = std::max((int)header.keysigDenominator, 1);
+		}
+
+		int denominatorPower = 0;
+		while ((1 << (denominatorPower+1)) <= denominator) {
+			denominatorPower++;
+		}
+		char timeSignature[4] = { (char)numerator, (char)denominatorPower, 24, 8 };
+		track.meta(tempoMap.measure_tick(measureIndex), 0x58, timeSignature, 4);
+	}
+
+	for (const TempoMap::TempoSegment &segment : tempoMap.tempo_segments()) {
+		int microseconds = (int)(60000000.0 / std::max(segment.tempo, 1.0));
+		char tempo[3] = { (char)(microseconds >> 16), (char)(microseconds >> 8), (char)microseconds };
+		track.meta(segment.tick, 0x51, tempo, 3);
+	}
+
+	track.end(tempoMap.measure_tick(song.measureCount));
+}
+
+// a note that's still sounding on a string
+struct SoundingNote {
+	int pitch;
+	long long endTick;
+};
+
+static void writeSongTrack(GPFile &song, const TempoMap &tempoMap, int trackIndex, std::vector<char> &buffer) {
+	const TrackHeader &header = song.trackHeaders[trackIndex];
+	int stringCount = std::min(std::max(header.stringCount, 0), 7);
+
+	int port = std::max(std::min(header.midiPort, 4), 1) - 1;
+	int channel = std::max(std::min(header.midiChannel, 16), 1) - 1;
+	const MidiChannel &channelSettings = song.midiChannels[port][channel];
+	if (header.trackFlags & gp_track_drums) {
+		channel = 9;
+	}
+
+	MidiTrack track(buffer);
+	std::string_view name = header.name;
+	track.meta(0, 0x03, name.data(), name.length());
+	track.event(0, 0xc0|channel, std::max(std::min(channelSettings.instrument, 127), 0), 0);
+	track.event(0, 0xb0|channel, 7, getChannelValue(channelSettings.volume));
+	track.event(0, 0xb0|channel, 10, getChannelValue(channelSettings.balance));
+
+	SoundingNote sounding[7];
+	for (SoundingNote &note : sounding) {
+		note.pitch = -1;
+	}
+
+	// the notes that ended before the tick are let go, earliest first
+	// one that ends right at it can still be tied on to by the beat there
+	auto releaseNotes = [&](long long tick) {
+		while (true) {
+			SoundingNote *earliest = nullptr;
+			for (SoundingNote &note : sounding) {
+				if (note.pitch >= 0 && note.endTick < tick && (earliest == nullptr || note.endTick < earliest->endTick)) {
+					earliest = &note;
+				}
+			}
+			if (earliest == nullptr) {
+				return;
+			}
+			track.event(earliest->endTick, 0x80|channel, earliest->pitch, 0);
+			earliest->pitch = -1;
+		}
+	};
+
+	for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+		const Measure &measure = song.get_measure(measureIndex, trackIndex);
+		long long measureEnd = tempoMap.measure_tick(measureIndex+1);
+		long long tick = tempoMap.measure_tick(measureIndex);
+
+		for (const Beat &beat : measure.beats) {
+			// beats that don't fit in the measure are squeezed in at its end
+			tick = std::min(tick, measureEnd);
+			long long endTick = tick + getBeatTicks(beat);
+			releaseNotes(tick);
+
+			if (beat.beatFlags & gp_beat_has_mix_change) {
+				const MixChange &change = beat.mixTableChange;
+				if (change.instrument >= 0) {
+					track.event(tick, 0xc0|channel, change.instrument, 0);
+				}
+				if (change.volume >= 0) {
+					track.event(tick, 0xb0|channel, 7, getChannelValue(change.volume));
+				}
+				if (change.balance >= 0) {
+					track.event(tick, 0xb0|channel, 10, getChannelValue(change.balance));
+				}
+			}
+
+			for (int stringIndex = 0; stringIndex < stringCount && !beat.isRest; stringIndex++) {
+				if (!(beat.beatNotes.stringsPlayed & (0x40 >> stringIndex))) {
+					continue;
+				}
+				const Note &note = beat.beatNotes.strings[stringIndex];
+				SoundingNote &current = sounding[stringIndex];
+
+				// a tied note keeps the one before it sounding
+				if (note.noteType == gp_notetype_tied) {
+					if (current.pitch >= 0) {
+						current.endTick = endTick;
+					}
+					continue;
+				}
+
+				if (current.pitch >= 0) {
+					track.event(tick, 0x80|channel, current.pitch, 0);
+				}
+				current.pitch = getNotePitch(header, stringIndex, note.fretNumber);
+				current.endTick = endTick;
+
+				int velocity = getNoteVelocity(note);
+				// dead notes are only a short muted hit
+				if (note.noteType == gp_notetype_dead) {
+					current.endTick = std::min(endTick, tick + ticksPerQuarter/16);
+					velocity = std::max(velocity/2, 1);
+				}
+				track.event(tick, 0x90|channel, current.pitch, velocity);
+			}
+
+			tick = endTick;
+		}
+	}
+
+	long long songEnd = tempoMap.measure_tick(song.measureCount);
+	releaseNotes(std::numeric_limits<long long>::max());
+	track.end(songEnd);
+}
+
+void writeMidi(GPFile &song, const TempoMap &tempoMap, std::vector<char> &buffer) {
+	buffer.insert(buffer.end(), { 'M', 'T', 'h', 'd', 0, 0, 0, 6 });
+	int trackCount = song.trackCount + 1;
+	char header[6] = { 0, 1, (char)(trackCount >> 8), (char)trackCount, (char)(ticksPerQuarter >> 8), (char)ticksPerQuarter };
+	buffer.insert(buffer.end(), header, header + 6);
+
+	writeTempoTrack(song, tempoMap, buffer);
+	for (int trackIndex = 0; trackIndex < song.trackCount; trackIndex++) {
+		writeSongTrack(song, tempoMap, trackIndex, buffer);
+	}
+}
+
+int exportMidiFile(const std::string &filePath, const std::string &midiPath) {
+	// every measure is needed, so they're all read at once into an arena,
+	// which is faster than decoding them one by one, and on all cores unless the whole directory is
+	GPFile song;
+	if (song.read_file(filePath, gp_open_string_views|gp_open_arena|gp_open_parallel|gp_open_quiet) != 0) {
+		std::cerr << filePath << ": " << song.readError << "\n";
+		return 1;
+	}
+
+	TempoMap tempoMap;
+	if (tempoMap.build(song) != 0) {
+		std::cerr << filePath << ": the measure headers are missing\n";
+		return 1;
+	}
+
+	std::vector<char> buffer;
+	buffer.reserve((size_t)song.measureCount * song.trackCount * 128);
+	writeMidi(song, tempoMap, buffer);
+	// converting a batch of files would mostly wait for the disk if every one was synced
+	if (gp_write::save_file(midiPath, buffer, false) != 0) {
+		std::cerr << midiPath << ": could not be written\n";
+		return 1;
+	}
+	return 0;
+}
+
+int exportMidiDirectory(const std::string &directoryPath, const std::string &midiDirectory) {
+	if (!std::filesystem::is_directory(directoryPath)) {
+		std::cerr << "Not a directory: " << directoryPath << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> filePaths = findSongFiles(directoryPath);
+
+	std::atomic<int> failures(0);
+	ThreadPool pool;
+
+	for (const std::string &filePath : filePaths) {
+		pool.submit([&, filePath] {
+			std::filesystem::path midiPath = std::filesystem::path(midiDirectory) / std::filesystem::relative(filePath, directoryPath);
+			midiPath.replace_extension(".mid");
+
+			std::error_code error;
+			std::filesystem::create_directories(midiPath.parent_path(), error);
+			if (exportMidiFile(filePath, midiPath.string()) != 0) {
+				failures++;
+			}
+		});
+	}
+	pool.wait();
+
+	if (failures > 0) {
+		std::cerr << failures << " of " << filePaths.size() << " files could not be exported\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MIDI_EXPORT_H
+#define MIDI_EXPORT_H
+
+#include <string>
+#include <vector>
+
+#include "gp_file.hpp"
+#include "tempo_map.hpp"
+
+// the MIDI note played by a fret on a string, the capo raises every string of the track
+// on drum tracks the fret is the note itself
+int getNotePitch(const TrackHeader &track, int stringIndex, int fret);
+
+// the MIDI velocity of a note, from its dynamic and accents
+int getNoteVelocity(const Note &note);
+
+// the channel table and mix changes store volume, balance and the effects from 0 to 16, this is the MIDI value
+int getChannelValue(int value);
+
+// writes the song as a type 1 standard MIDI file at ticksPerQuarter ticks per quarter note,
+// a track with the tempo and time signatures first, then one track for each track of the song
+// each track is written measure by measure, so a lazily opened song is decoded a few measures at a time
+void writeMidi(GPFile &song, const TempoMap &tempoMap, std::vector<char> &buffer);
+
+// opens a gp3 file and saves it as a MIDI file
+int exportMidiFile(const std::string &filePath, const std::string &midiPath);
+
+// exports every gp3 file in a directory tree on a thread pool, into the same paths under midiDirectory,
+// returns 1 if any of them failed
+int exportMidiDirectory(const std::string &directoryPath, const std::string &midiDirectory);
+
+#endif // !MIDI_EXPORT_H
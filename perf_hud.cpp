@@ -0,0 +1,142 @@
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+#ifdef _WIN32
+	#include <curses.h>
+#else
+	#include <ncurses.h>
+	#include <unistd.h>
+#endif
+
+#include "perf_hud.hpp"
+#include "gpedit.hpp"
+#include "gp_file.hpp"
+#include "windows.hpp"
+
+EditorTimings editorTimings;
+
+void TimingWindow::add(double milliseconds) {
+	if (this->samples.size() < capacity) {
+		this->samples.push_back(milliseconds);
+	}
+	else {
+		this->samples[this->sampleCount % capacity] = milliseconds;
+	}
+	this->sampleCount++;
+	this->lastSample = milliseconds;
+}
+
+double TimingWindow::percentile(double fraction) const {
+	if (this->samples.empty()) {
+		return 0;
+	}
+	// only sorted when the overlay is drawn, so adding a sample stays cheap
+	std::vector<double> sorted = this->samples;
+	size_t rank = std::min((size_t)std::max(std::ceil(fraction * sorted.size()) - 1, 0.0), sorted.size()-1);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// when the key that the next frame answers was read
+static std::chrono::steady_clock::time_point keyTime;
+static bool keyPending = false;
+
+void keyRead() {
+	keyTime = std::chrono::steady_clock::now();
+	keyPending = true;
+}
+
+void frameDrawn(std::chrono::steady_clock::time_point start) {
+	editorTimings.frames.add(millisecondsSince(start));
+	if (keyPending) {
+		editorTimings.keyLatency.add(millisecondsSince(keyTime));
+		keyPending = false;
+	}
+	drawPerfHud();
+}
+
+// the memory the whole process has in RAM, 0 where it can't be found out
+static size_t residentBytes() {
+#ifdef _WIN32
+	return 0;
+#else
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (statm == nullptr) {
+		return 0;
+	}
+	long totalPages = 0, residentPages = 0;
+	int count = fscanf(statm, "%ld %ld", &totalPages, &residentPages);
+	fclose(statm);
+	return count == 2 ? (size_t)residentPages * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+static double megabytes(size_t bytes) {
+	return bytes / (1024.0 * 1024.0);
+}
+
+static WINDOW *hudWindow = nullptr;
+static const int hudWidth = 58;
+static const int hudHeight = 7;
+
+void togglePerfHud() {
+	if (hudWindow != nullptr) {
+		delwin(hudWindow);
+		hudWindow = nullptr;
+
+		// the song info is all that's under it
+		touchwin(songInfoWindow);
+		wnoutrefresh(songInfoWindow);
+		doupdate();
+		return;
+	}
+
+	int width = std::min(hudWidth, getmaxx(stdscr));
+	hudWindow = newwin(std::min(hudHeight, getmaxy(songInfoWindow)), width, 0, getmaxx(stdscr) - width);
+	wbkgd(hudWindow, A_REVERSE);
+	drawPerfHud();
+}
+
+// prints the last and the 99th percentile duration
+static void printTiming(int line, int column, const char *name, const TimingWindow &timings) {
+	mvwprintw(hudWindow, line, column, "%-9s %6.2f p99 %6.2f", name, timings.last(), timings.percentile(0.99));
+}
+
+void drawPerfHud() {
+	if (hudWindow == nullptr) {
+		return;
+	}
+	const ReadTimes &read = song.readTimes;
+
+	werase(hudWindow);
+	wattron(hudWindow, A_BOLD);
+	mvwprintw(hudWindow, 0, 1, "Opened in %.2f ms%s", read.total() + editorTimings.tempoMap, song.read_from_cache() ? " (cached)" : "");
+	wattroff(hudWindow, A_BOLD);
+	mvwprintw(hudWindow, 1, 1, "file %.2f  cache %.2f/%.2f  info %.2f  midi %.2f",
+				 read.loadFile, read.openCache, read.writeCache, read.metadata, read.midiChannels);
+	mvwprintw(hudWindow, 2, 1, "headers %.2f  measures %.2f  tempo map %.2f",
+				 read.headers, read.measures, editorTimings.tempoMap);
+
+	// last and p99 in milliseconds, in two columns
+	printTiming(3, 1, "frame", editorTimings.frames);
+	printTiming(3, 30, "key", editorTimings.keyLatency);
+	printTiming(4, 1, "tab print", editorTimings.trackChunks);
+	printTiming(4, 30, "beat info", editorTimings.beatInfo);
+
+	size_t fileBytes = song.fileBuffer ? song.fileBuffer->size() : 0;
+	mvwprintw(hudWindow, 5, 1, "song %.1f MB  file %.1f MB", megabytes(song.allocated_bytes()), megabytes(fileBytes));
+	size_t resident = residentBytes();
+	if (resident > 0) {
+		wprintw(hudWindow, "  resident %.1f MB", megabytes(resident));
+	}
+	mvwprintw(hudWindow, 6, 1, "%zu frames, %zu keys, in ms  (%c: hide)", editorTimings.frames.count(), editorTimings.keyLatency.count(), perfHudKey);
+
+	wnoutrefresh(hudWindow);
+	doupdate();
+}
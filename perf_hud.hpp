@@ -0,0 +1,58 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <vector>
+#include <chrono>
+
+// the latest durations of something that happens over and over, in milliseconds
+class TimingWindow {
+	public:
+		// the samples are allocated up front, so adding one never allocates while a frame is drawn
+		TimingWindow() { this->samples.reserve(capacity); }
+
+		void add(double milliseconds);
+
+		double last() const { return this->lastSample; }
+		// the duration that the given fraction of the kept samples took at most, 0 if there are none
+		double percentile(double fraction) const;
+		// every sample added, not only the kept ones
+		size_t count() const { return this->sampleCount; }
+
+	private:
+		// only this many are kept, the oldest is replaced first
+		static const size_t capacity = 1024;
+		std::vector<double> samples;
+		size_t sampleCount = 0;
+		double lastSample = 0;
+};
+
+// where the editor spends its time, shown in the performance overlay
+// the time reading the song is in song.readTimes
+struct EditorTimings {
+	TimingWindow frames;	// drawing a frame of the tab view or the stacked view
+	TimingWindow trackChunks;	// picking and printing the measures around the selection into the pads of either view
+	TimingWindow beatInfo;	// printing the selected beat's details
+	TimingWindow keyLatency;	// from a key being read to the frame it caused being sent to the terminal
+	double tempoMap = 0;	// building or updating the tempo map, the last time the song was read
+};
+
+extern EditorTimings editorTimings;
+
+// milliseconds from start until now
+double millisecondsSince(std::chrono::steady_clock::time_point start);
+
+// call when a key has been read, the next frame is timed from then
+void keyRead();
+// call once a frame has been sent to the terminal, with when drawing it started
+// the overlay is drawn over it again, if it's shown
+void frameDrawn(std::chrono::steady_clock::time_point start);
+
+// the key that shows and hides the overlay, in any view
+const int perfHudKey = 'p';
+
+// the overlay covers the right side of the song info
+void togglePerfHud();
+// draws the overlay with the latest numbers, if it's shown
+void drawPerfHud();
+
+#endif // !PERF_HUD_H
@@ -0,0 +1,449 @@
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <cstring>
+
+#include "riff_index.hpp"
+#include "gp_file.hpp"
+#include "gp_compact.hpp"
+#include "gp_write.hpp"
+#include "midi_export.hpp"
+#include "scan.hpp"
+#include "thread_pool.hpp"
+
+static const char riffIndexMagic[4] = { 'G', 'P', 'R', 'I' };
+static const uint32_t riffIndexVersion = 1;
+static const uint32_t riffIndexByteOrder = 0x01020304;
+
+// the n-gram starting at a note, one byte per interval from the first one on, so the n-grams that start
+// with the same intervals are next to each other once sorted
+// intervals past the end of the track are 0, which no interval is stored as
+static uint32_t getGramKey(const unsigned char *pitches, size_t noteIndex, size_t endNote) {
+	uint32_t key = 0;
+	for (int i = 0; i < riffGramLength; i++) {
+		size_t next = noteIndex + i + 1;
+		int interval = next < endNote ? pitches[next] - pitches[next-1] : -128;
+		key = (key << 8) | (uint32_t)(interval + 128);
+	}
+	return key;
+}
+
+const RiffIndex::Track &RiffIndex::track_of(uint32_t note) const {
+	const Track *end = this->tracks + this->header->trackCount;
+	const Track *track = std::upper_bound(this->tracks, end, note, [](uint32_t note, const Track &track) {
+		return note < track.firstNote;
+	});
+	return *(track - 1);
+}
+
+int RiffIndex::open(const std::string &indexPath) {
+	this->header = nullptr;
+	if (this->file.open(indexPath) != 0) {
+		this->error = "could not be read";
+		return 1;
+	}
+
+	const char *data = this->file.data();
+	size_t size = this->file.size();
+	if (size < sizeof(Header) || memcmp(data, riffIndexMagic, sizeof(riffIndexMagic)) != 0) {
+		this->error = "not a riff index";
+		return 1;
+	}
+	const Header *header = (const Header *)data;
+	if (header->byteOrder != riffIndexByteOrder) {
+		this->error = "built on a machine with a different byte order";
+		return 1;
+	}
+	if (header->version != riffIndexVersion || header->gramLength != (uint32_t)riffGramLength) {
+		this->error = "built by a different version of gpedit";
+		return 1;
+	}
+
+	size_t expectedSize = sizeof(Header) + header->fileCount * sizeof(File) + header->trackCount * sizeof(Track)
+		+ header->gramCount * sizeof(Gram) + header->noteCount * (2*sizeof(uint32_t) + 1) + header->stringsSize;
+	if (size < expectedSize) {
+		this->error = "the index is incomplete";
+		return 1;
+	}
+
+	// the sections follow each other, the ones before the pitches all keep 4 byte alignment
+	const char *section = data + sizeof(Header);
+	this->files = (const File *)section;
+	section += header->fileCount * sizeof(File);
+	this->tracks = (const Track *)section;
+	section += header->trackCount * sizeof(Track);
+	this->grams = (const Gram *)section;
+	section += header->gramCount * sizeof(Gram);
+	this->postings = (const uint32_t *)section;
+	section += header->noteCount * sizeof(uint32_t);
+	this->measures = (const uint32_t *)section;
+	section += header->noteCount * sizeof(uint32_t);
+	this->pitches = (const unsigned char *)section;
+	section += header->noteCount;
+	this->strings = section;
+
+	// a damaged index must not make find read outside of the file, so every offset and count in it is checked
+	if (!check_sections(*header)) {
+		this->error = "the index is damaged";
+		return 1;
+	}
+
+	this->header = header;
+	return 0;
+}
+
+bool RiffIndex::check_sections(const Header &header) const {
+	auto inStrings = [&](uint32_t offset, uint32_t length) {
+		return (uint64_t)offset + length <= header.stringsSize;
+	};
+
+	for (uint32_t i = 0; i < header.fileCount; i++) {
+		if (!inStrings(this->files[i].pathOffset, this->files[i].pathLength)) {
+			return false;
+		}
+	}
+
+	// the tracks' notes follow each other from the first note on, which track_of relies on
+	uint64_t nextNote = 0;
+	for (uint32_t i = 0; i < header.trackCount; i++) {
+		const Track &track = this->tracks[i];
+		if (track.fileIndex >= header.fileCount || !inStrings(track.nameOffset, track.nameLength) || track.firstNote != nextNote) {
+			return false;
+		}
+		nextNote += track.noteCount;
+	}
+	if (nextNote != header.noteCount) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.gramCount; i++) {
+		const Gram &gram = this->grams[i];
+		if ((uint64_t)gram.firstPosting + gram.postingCount > header.noteCount || (i > 0 && gram.key <= this->grams[i-1].key)) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header.noteCount; i++) {
+		if (this->postings[i] >= header.noteCount) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<RiffMatch> RiffIndex::find(const std::vector<int> &pitches) const {
+	std::vector<RiffMatch> matches;
+	if (this->header == nullptr || pitches.size() < 2) {
+		return matches;
+	}
+
+	std::vector<int> intervals;
+	for (size_t i = 1; i < pitches.size(); i++) {
+		intervals.push_back(pitches[i] - pitches[i-1]);
+	}
+	// nothing in the index is that far apart
+	for (int interval : intervals) {
+		if (interval < -127 || interval > 127) {
+			return matches;
+		}
+	}
+
+	const Gram *gramsEnd = this->grams + this->header->gramCount;
+	auto findGrams = [&](uint32_t low, uint32_t high) {
+		auto compare = [](const Gram &gram, uint32_t key) { return gram.key < key; };
+		return std::make_pair(std::lower_bound(this->grams, gramsEnd, low, compare), std::lower_bound(this->grams, gramsEnd, high, compare));
+	};
+
+	std::vector<uint32_t> starts;
+	if (intervals.size() < (size_t)riffGramLength) {
+		// every n-gram starting with the intervals matches
+		uint32_t prefix = 0;
+		for (int interval : intervals) {
+			prefix = (prefix << 8) | (uint32_t)(interval + 128);
+		}
+		int shift = 8 * (riffGramLength - intervals.size());
+		auto range = findGrams(prefix << shift, (prefix + 1) << shift);
+		for (const Gram *gram = range.first; gram != range.second; gram++) {
+			starts.insert(starts.end(), this->postings + gram->firstPosting, this->postings + gram->firstPosting + gram->postingCount);
+		}
+	}
+	else {
+		// the rarest n-gram of the riff gives the fewest places to check
+		size_t bestOffset = 0;
+		const Gram *bestGram = nullptr;
+		for (size_t offset = 0; offset + riffGramLength <= intervals.size(); offset++) {
+			uint32_t key = 0;
+			for (int i = 0; i < riffGramLength; i++) {
+				key = (key << 8) | (uint32_t)(intervals[offset+i] + 128);
+			}
+			auto range = findGrams(key, key + 1);
+			if (range.first == range.second) {
+				return matches;
+			}
+			if (bestGram == nullptr || range.first->postingCount < bestGram->postingCount) {
+				bestGram = range.first;
+				bestOffset = offset;
+			}
+		}
+
+		for (uint32_t i = 0; i < bestGram->postingCount; i++) {
+			uint32_t note = this->postings[bestGram->firstPosting + i];
+			const Track &track = track_of(note);
+			if (note - track.firstNote < bestOffset || note - bestOffset + intervals.size() >= (size_t)track.firstNote + track.noteCount) {
+				continue;
+			}
+
+			uint32_t start = note - bestOffset;
+			bool same = true;
+			for (size_t j = 0; j < intervals.size() && same; j++) {
+				same = this->pitches[start+j+1] - this->pitches[start+j] == intervals[j];
+			}
+			if (same) {
+				starts.push_back(start);
+			}
+		}
+	}
+
+	// the notes of a track are next to each other, so sorting groups the matches by track
+	std::sort(starts.begin(), starts.end());
+	const Track *lastTrack = nullptr;
+	for (uint32_t start : starts) {
+		const Track &track = track_of(start);
+		if (&track != lastTrack) {
+			const File &file = this->files[track.fileIndex];
+			matches.push_back({ string_at(file.pathOffset, file.pathLength), (int)track.trackNumber, string_at(track.nameOffset, track.nameLength), {} });
+			lastTrack = &track;
+		}
+
+		std::vector<int> &measureNumbers = matches.back().measureNumbers;
+		int measureNumber = this->measures[start] + 1;
+		if (measureNumbers.empty() || measureNumbers.back() != measureNumber) {
+			measureNumbers.push_back(measureNumber);
+		}
+	}
+	return matches;
+}
+
+struct IndexedTrack {
+	int trackNumber;
+	std::string name;
+	std::vector<unsigned char> pitches;
+	std::vector<uint32_t> measures;
+};
+
+// the lowest note of every beat that starts one, in every track that isn't drums
+static int readSongNotes(const std::string &filePath, std::vector<IndexedTrack> &tracks) {
+	// the measures are only decoded one at a time to be packed, so a whole song of full beats never has to fit in memory
+	GPFile song;
+	if (song.read_file(filePath, gp_open_string_views|gp_open_lazy_measures|gp_open_quiet) != 0) {
+		std::cerr << filePath << ": " << song.readError << "\n";
+		return 1;
+	}
+	CompactSong measures;
+	measures.build(song);
+
+	for (int trackIndex = 0; trackIndex < song.trackCount; trackIndex++) {
+		const TrackHeader &header = song.trackHeaders[trackIndex];
+		if (header.trackFlags & gp_track_drums) {
+			continue;
+		}
+		int stringCount = std::min(std::max(header.stringCount, 0), 7);
+
+		IndexedTrack track;
+		track.trackNumber = trackIndex + 1;
+		track.name = std::string(header.name.data(), header.name.length());
+
+		for (int measureIndex = 0; measureIndex < measures.measureCount; measureIndex++) {
+			unsigned int firstBeat = measures.first_beat(measureIndex, trackIndex);
+			unsigned int endBeat = firstBeat + measures.beat_count(measureIndex, trackIndex);
+			for (unsigned int beatIndex = firstBeat; beatIndex < endBeat; beatIndex++) {
+				if (measures.beats[beatIndex].isRest) {
+					continue;
+				}
+
+				int lowestPitch = -1;
+				for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+					const CompactNote *note = measures.note(beatIndex, stringIndex);
+					if (note == nullptr || note->noteType == gp_notetype_tied || note->noteType == gp_notetype_dead) {
+						continue;
+					}
+					int pitch = getNotePitch(header, stringIndex, note->fretNumber);
+					if (lowestPitch < 0 || pitch < lowestPitch) {
+						lowestPitch = pitch;
+					}
+				}
+				if (lowestPitch >= 0) {
+					track.pitches.push_back(lowestPitch);
+					track.measures.push_back(measureIndex);
+				}
+			}
+		}
+
+		if (!track.pitches.empty()) {
+			tracks.push_back(std::move(track));
+		}
+	}
+	return 0;
+}
+
+template <typename T>
+static void appendArray(std::vector<char> &buffer, const T *values, size_t count) {
+	const char *bytes = (const char *)values;
+	buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+int buildRiffIndex(const std::string &directoryPath, const std::string &indexPath, std::ostream &output) {
+	if (!std::filesystem::is_directory(directoryPath)) {
+		std::cerr << "Not a directory: " << directoryPath << "\n";
+		return 1;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<std::string> filePaths = findSongFiles(directoryPath);
+
+	// every file gets its own slot, so the index comes out the same whatever order they finish in
+	std::vector<std::vector<IndexedTrack>> songTracks(filePaths.size());
+	std::vector<char> readFailed(filePaths.size(), 0);
+	ThreadPool pool;
+
+	for (size_t i = 0; i < filePaths.size(); i++) {
+		pool.submit([&, i] {
+			readFailed[i] = readSongNotes(filePaths[i], songTracks[i]);
+		});
+	}
+	pool.wait();
+
+	std::vector<RiffIndex::File> files;
+	std::vector<RiffIndex::Track> tracks;
+	std::vector<unsigned char> pitches;
+	std::vector<uint32_t> measures;
+	std::string strings;
+	int failures = 0;
+
+	for (size_t i = 0; i < filePaths.size(); i++) {
+		if (readFailed[i]) {
+			failures++;
+			continue;
+		}
+
+		files.push_back({ (uint32_t)strings.size(), (uint32_t)filePaths[i].size() });
+		strings += filePaths[i];
+
+		for (IndexedTrack &track : songTracks[i]) {
+			if (pitches.size() + track.pitches.size() > UINT32_MAX) {
+				std::cerr << "Too many notes for one index, index fewer files at a time\n";
+				return 1;
+			}
+			tracks.push_back({ (uint32_t)files.size()-1, (uint32_t)track.trackNumber, (uint32_t)strings.size(), (uint32_t)track.name.size(),
+				(uint32_t)pitches.size(), (uint32_t)track.pitches.size() });
+			strings += track.name;
+			pitches.insert(pitches.end(), track.pitches.begin(), track.pitches.end());
+			measures.insert(measures.end(), track.measures.begin(), track.measures.end());
+		}
+		songTracks[i].clear();
+	}
+
+	// every note starts one n-gram, sorting them by key with the note in the low bits keeps each posting list in order
+	std::vector<uint64_t> keyedNotes;
+	keyedNotes.reserve(pitches.size());
+	for (const RiffIndex::Track &track : tracks) {
+		size_t endNote = track.firstNote + track.noteCount;
+		for (size_t note = track.firstNote; note < endNote; note++) {
+			keyedNotes.push_back((uint64_t)getGramKey(pitches.data(), note, endNote) << 32 | note);
+		}
+	}
+	std::sort(keyedNotes.begin(), keyedNotes.end());
+
+	std::vector<RiffIndex::Gram> grams;
+	std::vector<uint32_t> postings;
+	postings.reserve(keyedNotes.size());
+	for (uint64_t keyedNote : keyedNotes) {
+		uint32_t key = keyedNote >> 32;
+		if (grams.empty() || grams.back().key != key) {
+			grams.push_back({ key, (uint32_t)postings.size(), 0 });
+		}
+		grams.back().postingCount++;
+		postings.push_back((uint32_t)keyedNote);
+	}
+
+	RiffIndex::Header header;
+	memcpy(header.magic, riffIndexMagic, sizeof(riffIndexMagic));
+	header.version = riffIndexVersion;
+	header.byteOrder = riffIndexByteOrder;
+	header.gramLength = riffGramLength;
+	header.fileCount = files.size();
+	header.trackCount = tracks.size();
+	header.noteCount = pitches.size();
+	header.gramCount = grams.size();
+	header.stringsSize = strings.size();
+
+	std::vector<char> buffer;
+	appendArray(buffer, &header, 1);
+	appendArray(buffer, files.data(), files.size());
+	appendArray(buffer, tracks.data(), tracks.size());
+	appendArray(buffer, grams.data(), grams.size());
+	appendArray(buffer, postings.data(), postings.size());
+	appendArray(buffer, measures.data(), measures.size());
+	appendArray(buffer, pitches.data(), pitches.size());
+	appendArray(buffer, strings.data(), strings.size());
+
+	if (gp_write::save_file(indexPath, buffer) != 0) {
+		std::cerr << indexPath << ": could not be written\n";
+		return 1;
+	}
+
+	double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	output << "Indexed " << files.size() << " files, " << tracks.size() << " tracks and " << pitches.size() << " notes into "
+		   << indexPath << " in " << (long long)buildTime << " ms\n";
+
+	if (failures > 0) {
+		std::cerr << failures << " of " << filePaths.size() << " files could not be read\n";
+		return 1;
+	}
+	return 0;
+}
+
+int parseRiffPattern(const std::string &pattern, std::vector<int> &pitches) {
+	std::istringstream stream(pattern);
+	int pitch;
+	while (stream >> pitch) {
+		pitches.push_back(pitch);
+	}
+	return (stream.eof() && pitches.size() >= 2) ? 0 : 1;
+}
+
+int findRiff(const std::string &pattern, const std::string &indexPath, std::ostream &output) {
+	std::vector<int> pitches;
+	if (parseRiffPattern(pattern, pitches) != 0) {
+		std::cerr << "A riff is at least two pitches in semitones, like \"0 3 5 3\"\n";
+		return 1;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	RiffIndex index;
+	if (index.open(indexPath) != 0) {
+		std::cerr << indexPath << ": " << index.error << "\n";
+		return 1;
+	}
+	std::vector<RiffMatch> matches = index.find(pitches);
+	double findTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	for (const RiffMatch &match : matches) {
+		std::string line = "{\"path\":\"" + jsonEscape(match.filePath) + "\"";
+		line += ",\"track\":" + std::to_string(match.trackNumber);
+		line += ",\"name\":\"" + jsonEscape(songTextToUtf8(match.trackName)) + "\"";
+		line += ",\"measures\":[";
+		for (size_t i = 0; i < match.measureNumbers.size(); i++) {
+			line += (i > 0 ? "," : "") + std::to_string(match.measureNumbers[i]);
+		}
+		line += "]}\n";
+		output << line;
+	}
+
+	char findTimeString[32];
+	snprintf(findTimeString, sizeof(findTimeString), "%.2f", findTime);
+	std::cerr << matches.size() << " tracks out of " << index.track_count() << " in " << findTimeString << " ms\n";
+	return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef RIFF_INDEX_H
+#define RIFF_INDEX_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#include "mapped_file.hpp"
+
+// riffs are searched by the intervals between their notes, so they're found in any key
+// every track is indexed as the line of the lowest note of each beat, tied and dead notes left out,
+// which follows the roots of power chords as well as single note lines
+
+// the number of intervals in each n-gram of the index, shorter riffs are found through the n-grams they start
+const int riffGramLength = 3;
+
+struct RiffMatch {
+	std::string filePath;
+	int trackNumber;	// counting from 1
+	std::string trackName;
+	std::vector<int> measureNumbers;	// where the riff starts, counting from 1
+};
+
+// an index written by buildRiffIndex, mapped into memory so opening it doesn't read it
+class RiffIndex {
+	public:
+		// returns 1 and sets error if the file isn't an index this version can read
+		int open(const std::string &indexPath);
+
+		int file_count() const { return this->header ? this->header->fileCount : 0; }
+		int track_count() const { return this->header ? this->header->trackCount : 0; }
+		long long note_count() const { return this->header ? this->header->noteCount : 0; }
+
+		// every track that plays the pitches in this order, transposed to any key
+		std::vector<RiffMatch> find(const std::vector<int> &pitches) const;
+
+		std::string error;
+
+		// the layout of the file, everything is stored in the byte order of the machine that built it
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t byteOrder;
+			uint32_t gramLength;
+			uint32_t fileCount;
+			uint32_t trackCount;
+			uint32_t noteCount;
+			uint32_t gramCount;
+			uint32_t stringsSize;
+		};
+		struct File {
+			uint32_t pathOffset;
+			uint32_t pathLength;
+		};
+		struct Track {
+			uint32_t fileIndex;
+			uint32_t trackNumber;
+			uint32_t nameOffset;
+			uint32_t nameLength;
+			uint32_t firstNote;
+			uint32_t noteCount;
+		};
+		// the notes that start the same intervals, postings[firstPosting] onwards
+		struct Gram {
+			uint32_t key;
+			uint32_t firstPosting;
+			uint32_t postingCount;
+		};
+
+	private:
+		MappedFile file;
+
+		const Header *header = nullptr;
+		const File *files = nullptr;
+		const Track *tracks = nullptr;
+		const Gram *grams = nullptr;
+		const uint32_t *postings = nullptr;	// indexes into the notes, sorted by the n-gram they start
+		const uint32_t *measures = nullptr;	// the measure of each note
+		const unsigned char *pitches = nullptr;	// every track's notes one after another
+		const char *strings = nullptr;
+
+		// whether every offset and count in the sections points inside them
+		bool check_sections(const Header &header) const;
+		std::string string_at(uint32_t offset, uint32_t length) const { return std::string(this->strings + offset, length); }
+		// the track the note belongs to
+		const Track &track_of(uint32_t note) const;
+};
+
+// reads every gp3 file in a directory tree on a thread pool and writes the index of their riffs,
+// files that can't be read are left out, returns 1 if there were any or the index couldn't be written
+int buildRiffIndex(const std::string &directoryPath, const std::string &indexPath, std::ostream &output);
+
+// reads a riff like "0 3 5 3", the pitches of its notes in semitones, returns 1 if it isn't one
+int parseRiffPattern(const std::string &pattern, std::vector<int> &pitches);
+
+// looks up a riff in an index, and writes one JSON object per track it's in
+int findRiff(const std::string &pattern, const std::string &indexPath, std::ostream &output);
+
+#endif // !RIFF_INDEX_H
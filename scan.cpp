@@ -0,0 +1,156 @@
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+
+#include "scan.hpp"
+#include "gp_file.hpp"
+#include "thread_pool.hpp"
+
+std::vector<std::string> findSongFiles(const std::string &directoryPath) {
+	std::vector<std::string> filePaths;
+
+	std::error_code error;
+	auto options = std::filesystem::directory_options::skip_permission_denied;
+	for (std::filesystem::recursive_directory_iterator entry(directoryPath, options, error), end; entry != end; entry.increment(error)) {
+		if (error) {
+			break;
+		}
+		if (!entry->is_regular_file(error)) {
+			continue;
+		}
+
+		std::string extension = entry->path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension == ".gp3") {
+			filePaths.push_back(entry->path().string());
+		}
+	}
+
+	std::sort(filePaths.begin(), filePaths.end());
+	return filePaths;
+}
+
+std::string jsonEscape(std::string_view value) {
+	std::string escaped;
+	escaped.reserve(value.length());
+
+	for (char character : value) {
+		switch (character) {
+			case '"':
+				escaped += "\\\"";
+				break;
+			case '\\':
+				escaped += "\\\\";
+				break;
+			case '\n':
+				escaped += "\\n";
+				break;
+			case '\r':
+				escaped += "\\r";
+				break;
+			case '\t':
+				escaped += "\\t";
+				break;
+			default:
+				if ((unsigned char)character < 0x20) {
+					char code[7];
+					snprintf(code, sizeof(code), "\\u%04x", (unsigned char)character);
+					escaped += code;
+				}
+				else {
+					escaped += character;
+				}
+				break;
+		}
+	}
+
+	return escaped;
+}
+
+// what 0x80 to 0x9f are in code page 1252, the five it leaves out are kept as the latin1 control characters
+static const unsigned short cp1252Controls[32] = {
+	0x20ac, 0x0081, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008d, 0x017d, 0x008f,
+	0x0090, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014, 0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0x009d, 0x017e, 0x0178
+};
+
+std::string songTextToUtf8(std::string_view value) {
+	std::string converted;
+	converted.reserve(value.length());
+
+	for (char character : value) {
+		unsigned int code = (unsigned char)character;
+		if (code >= 0x80 && code < 0xa0) {
+			code = cp1252Controls[code - 0x80];
+		}
+
+		if (code < 0x80) {
+			converted += (char)code;
+		}
+		else if (code < 0x800) {
+			converted += (char)(0xc0 | code >> 6);
+			converted += (char)(0x80 | (code & 0x3f));
+		}
+		else {
+			converted += (char)(0xe0 | code >> 12);
+			converted += (char)(0x80 | (code >> 6 & 0x3f));
+			converted += (char)(0x80 | (code & 0x3f));
+		}
+	}
+
+	return converted;
+}
+
+static std::string scanFile(const std::string &filePath) {
+	GPFile song;
+
+	auto startTime = std::chrono::steady_clock::now();
+	// the measures are only walked through, which still checks that the file is complete
+	int status = song.read_file(filePath, gp_open_string_views|gp_open_lazy_measures|gp_open_quiet);
+	double parseTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	char parseTimeString[32];
+	snprintf(parseTimeString, sizeof(parseTimeString), "%.3f", parseTime);
+
+	std::string line = "{\"path\":\"" + jsonEscape(filePath) + "\"";
+	if (status == 0) {
+		line += ",\"status\":\"ok\"";
+		line += ",\"title\":\"" + jsonEscape(songTextToUtf8(song.metadata.title)) + "\"";
+		line += ",\"artist\":\"" + jsonEscape(songTextToUtf8(song.metadata.artist)) + "\"";
+		line += ",\"tracks\":" + std::to_string(song.trackCount);
+		line += ",\"measures\":" + std::to_string(song.measureCount);
+	}
+	else {
+		line += ",\"status\":\"error\"";
+		line += ",\"error\":\"" + jsonEscape(song.readError) + "\"";
+	}
+	line += ",\"parse_ms\":" + std::string(parseTimeString) + "}\n";
+
+	return line;
+}
+
+int scanDirectory(const std::string &directoryPath, std::ostream &output) {
+	if (!std::filesystem::is_directory(directoryPath)) {
+		std::cerr << "Not a directory: " << directoryPath << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> filePaths = findSongFiles(directoryPath);
+
+	std::mutex outputMutex;
+	ThreadPool pool;
+
+	for (const std::string &filePath : filePaths) {
+		pool.submit([&output, &outputMutex, &filePath] {
+			std::string line = scanFile(filePath);
+
+			std::lock_guard<std::mutex> lock(outputMutex);
+			output << line << std::flush;
+		});
+	}
+	pool.wait();
+
+	return 0;
+}
\ No newline at end of file
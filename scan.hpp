@@ -0,0 +1,22 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+
+// finds every gp3 file in a directory tree, sorted by path
+std::vector<std::string> findSongFiles(const std::string &directoryPath);
+
+// escapes a string for use inside a JSON string literal, the string has to be UTF-8 already
+std::string jsonEscape(std::string_view value);
+// strings in a gp3 file are in the Windows code page they were written with, which is taken to be 1252,
+// the western one that latin1 is most of
+std::string songTextToUtf8(std::string_view value);
+
+// parses every gp3 file in a directory tree on a thread pool, and writes one JSON object per file
+// to the output as soon as it's done, so the order depends on which files finish first
+int scanDirectory(const std::string &directoryPath, std::ostream &output);
+
+#endif // !SCAN_H
\ No newline at end of file
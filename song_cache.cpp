@@ -0,0 +1,170 @@
+#include <filesystem>
+#include <cstring>
+
+#include "song_cache.hpp"
+#include "gp_file.hpp"
+#include "gp_read.hpp"
+#include "gp_write.hpp"
+
+static const char songCacheMagic[4] = { 'G', 'P', 'S', 'C' };
+static const uint32_t songCacheVersion = 1;
+static const uint32_t songCacheByteOrder = 0x01020304;
+
+std::string getSongCachePath(const std::string &filePath) {
+	return filePath + ".gpcache";
+}
+
+// only has to tell versions of the same song apart, so it takes 8 bytes at a time to keep up with the disk
+static uint64_t hashBytes(const char *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325 ^ size;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 0x100000001b3;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3;
+	}
+	return hash;
+}
+
+// the modification time, or 0 if the file isn't there
+static int64_t getFileTime(const std::string &filePath) {
+	std::error_code error;
+	auto time = std::filesystem::last_write_time(filePath, error);
+	return error ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+// every table starts 8 byte aligned, which is enough for any of them
+template <typename T>
+static void appendTable(std::vector<char> &buffer, SongCache::Table &table, const T *values, size_t count) {
+	buffer.resize((buffer.size() + 7) / 8 * 8);
+	table = { buffer.size(), (uint32_t)count, sizeof(T) };
+	const char *bytes = (const char *)values;
+	buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+template <typename T>
+static void appendTable(std::vector<char> &buffer, SongCache::Table &table, const CompactTable<T> &values) {
+	appendTable(buffer, table, values.data, values.count);
+}
+
+// points the table into the mapped file, returns false if it doesn't fit in the file or has a different layout
+template <typename T>
+static bool attachTable(CompactTable<T> &table, const SongCache::Table &stored, const char *data, size_t size) {
+	if (stored.elementSize != sizeof(T) || stored.offset % alignof(T) != 0 ||
+		 stored.offset > size || (size - stored.offset) / sizeof(T) < stored.count) {
+		return false;
+	}
+	table.data = (const T *)(data + stored.offset);
+	table.count = stored.count;
+	return true;
+}
+
+int SongCache::open(const std::string &filePath, const std::vector<char> &fileBytes) {
+	this->blockOffsets = nullptr;
+	this->blockOffsetCount = 0;
+	if (this->file.open(getSongCachePath(filePath)) != 0) {
+		return 1;
+	}
+
+	const char *data = this->file.data();
+	size_t size = this->file.size();
+	if (size < sizeof(Header) || memcmp(data, songCacheMagic, sizeof(songCacheMagic)) != 0) {
+		return 1;
+	}
+	const Header *header = (const Header *)data;
+	if (header->byteOrder != songCacheByteOrder || header->version != songCacheVersion) {
+		return 1;
+	}
+
+	// the cheap checks first, the hash only tells apart changes that kept the size and time
+	if (header->fileSize != fileBytes.size() || header->fileTime != getFileTime(filePath) ||
+		 header->fileHash != hashBytes(fileBytes.data(), fileBytes.size())) {
+		return 1;
+	}
+
+	CompactTable<uint64_t> offsets;
+	const Table *table = header->tables;
+	if (!attachTable(offsets, *table++, data, size) ||
+		 !attachTable(this->measures.measureBeats, *table++, data, size) ||
+		 !attachTable(this->measures.beats, *table++, data, size) ||
+		 !attachTable(this->measures.notes, *table++, data, size) ||
+		 !attachTable(this->measures.tuplets, *table++, data, size) ||
+		 !attachTable(this->measures.chords, *table++, data, size) ||
+		 !attachTable(this->measures.texts, *table++, data, size) ||
+		 !attachTable(this->measures.effects, *table++, data, size) ||
+		 !attachTable(this->measures.mixChanges, *table++, data, size) ||
+		 !attachTable(this->measures.noteDetails, *table++, data, size) ||
+		 !attachTable(this->measures.bends, *table++, data, size) ||
+		 !attachTable(this->measures.graceNotes, *table++, data, size) ||
+		 !attachTable(this->measures.bendPoints, *table++, data, size) ||
+		 !attachTable(this->measures.stringPool, *table++, data, size)) {
+		return 1;
+	}
+
+	// a damaged cache must not make the song read outside of the tables, so every index in them is checked
+	this->measures.measureCount = header->measureCount;
+	this->measures.trackCount = header->trackCount;
+	if (!this->measures.is_valid() || offsets.count != this->measures.measureBeats.count) {
+		return 1;
+	}
+	for (unsigned int i = 1; i < offsets.count; i++) {
+		if (offsets[i] < offsets[i-1]) {
+			return 1;
+		}
+	}
+
+	this->blockOffsets = offsets.data;
+	this->blockOffsetCount = offsets.count;
+	return 0;
+}
+
+int writeSongCache(const std::string &filePath, const std::vector<char> &fileBytes) {
+	// all of the measures are needed, so they're read the fastest way there is
+	gp_read::Cursor cursor(fileBytes);
+	GPFile song(cursor, gp_open_string_views|gp_open_arena|gp_open_parallel|gp_open_quiet);
+	if (!song.readError.empty()) {
+		return 1;
+	}
+
+	CompactSong measures;
+	measures.build(song);
+
+	SongCache::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, songCacheMagic, sizeof(songCacheMagic));
+	header.version = songCacheVersion;
+	header.byteOrder = songCacheByteOrder;
+	header.measureCount = song.measureCount;
+	header.trackCount = song.trackCount;
+	header.fileSize = fileBytes.size();
+	header.fileTime = getFileTime(filePath);
+	header.fileHash = hashBytes(fileBytes.data(), fileBytes.size());
+
+	std::vector<uint64_t> offsets(song.measureOffsets.begin(), song.measureOffsets.end());
+
+	std::vector<char> buffer(sizeof(header));
+	buffer.reserve(sizeof(header) + offsets.size() * sizeof(uint64_t) + measures.memory_size() + 16 * 8);
+	SongCache::Table *table = header.tables;
+	appendTable(buffer, *table++, offsets.data(), offsets.size());
+	appendTable(buffer, *table++, measures.measureBeats);
+	appendTable(buffer, *table++, measures.beats);
+	appendTable(buffer, *table++, measures.notes);
+	appendTable(buffer, *table++, measures.tuplets);
+	appendTable(buffer, *table++, measures.chords);
+	appendTable(buffer, *table++, measures.texts);
+	appendTable(buffer, *table++, measures.effects);
+	appendTable(buffer, *table++, measures.mixChanges);
+	appendTable(buffer, *table++, measures.noteDetails);
+	appendTable(buffer, *table++, measures.bends);
+	appendTable(buffer, *table++, measures.graceNotes);
+	appendTable(buffer, *table++, measures.bendPoints);
+	appendTable(buffer, *table++, measures.stringPool);
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	// synced like any other save, so a crash can't leave a cache that only looks up to date
+	return gp_write::save_file(getSongCachePath(filePath), buffer);
+}
@@ -0,0 +1,57 @@
+#ifndef SONG_CACHE_H
+#define SONG_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "mapped_file.hpp"
+#include "gp_compact.hpp"
+
+// a file kept next to a song, with what reading all of its measures found out:
+// where each measure block starts, and every measure as the tables of a CompactSong
+// the tables are stored as they are in memory, so the file is mapped and used in place without decoding it
+// it only counts while the song has the same size, modification time and contents as when it was written
+
+// where the cache of a song is kept
+std::string getSongCachePath(const std::string &filePath);
+
+class SongCache {
+	public:
+		// returns 1 if there's no cache of the song as it is now, fileBytes are its contents
+		int open(const std::string &filePath, const std::vector<char> &fileBytes);
+
+		// the measures, pointing into the mapped file
+		CompactSong measures;
+		// where each block starts in the song, measureIndex*trackCount + trackIndex, and then where the last one ends
+		const uint64_t *blockOffsets = nullptr;
+		size_t blockOffsetCount = 0;
+
+		// the layout of the file, everything is stored in the byte order and struct layout of the machine that wrote it
+		struct Table {
+			uint64_t offset;
+			uint32_t count;
+			uint32_t elementSize;	// a cache written with a different struct layout doesn't match
+		};
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t byteOrder;
+			int32_t measureCount;
+			int32_t trackCount;
+			uint64_t fileSize;
+			int64_t fileTime;
+			uint64_t fileHash;
+			// the block offsets, then the CompactSong tables in the order they're declared in
+			Table tables[14];
+		};
+
+	private:
+		MappedFile file;
+};
+
+// reads the song in fileBytes and writes its cache, returns 1 if it can't be read or the cache can't be written
+int writeSongCache(const std::string &filePath, const std::vector<char> &fileBytes);
+
+#endif // !SONG_CACHE_H
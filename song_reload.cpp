@@ -0,0 +1,128 @@
+#include <cstring>
+
+#include "song_reload.hpp"
+#include "gp_file.hpp"
+#include "gp_read.hpp"
+
+SongFileLayout getSongFileLayout(const GPFile &song) {
+	SongFileLayout layout;
+	layout.file = song.fileBuffer;
+	layout.headerOffsets.assign(song.headerOffsets.begin(), song.headerOffsets.end());
+	layout.measureOffsets.assign(song.measureOffsets.begin(), song.measureOffsets.end());
+	layout.measureCount = song.measureCount;
+	layout.trackCount = song.trackCount;
+
+	// the song info ends with the two counts, which are compared apart from it
+	layout.complete = layout.file && song.readError.empty() && !song.has_edits() &&
+		layout.headerOffsets.size() == (size_t)layout.measureCount + layout.trackCount + 1 &&
+		layout.measureOffsets.size() == (size_t)layout.measureCount * layout.trackCount + 1 &&
+		layout.headerOffsets[0] >= 8;
+	return layout;
+}
+
+static bool sameBytes(const SongFileLayout &before, size_t beforeStart, size_t beforeEnd,
+					  const SongFileLayout &after, size_t afterStart, size_t afterEnd) {
+	return beforeEnd - beforeStart == afterEnd - afterStart &&
+		memcmp(before.file->data() + beforeStart, after.file->data() + afterStart, afterEnd - afterStart) == 0;
+}
+
+SongChanges findSongChanges(const SongFileLayout &before, const SongFileLayout &after) {
+	SongChanges changes;
+	int measureCount = after.measureCount;
+	int trackCount = after.trackCount;
+
+	// a measure header or block is stored without referring to the ones around it, so comparing them one by one is enough
+	if (!before.complete || !after.complete || before.measureCount != measureCount || before.trackCount != trackCount ||
+		 !sameBytes(before, 0, before.headerOffsets[0] - 8, after, 0, after.headerOffsets[0] - 8) ||
+		 !sameBytes(before, before.headerOffsets[measureCount], before.headerOffsets[measureCount + trackCount],
+					after, after.headerOffsets[measureCount], after.headerOffsets[measureCount + trackCount])) {
+		changes.everything = true;
+		return changes;
+	}
+
+	for (int measureIndex = 0; measureIndex < measureCount; measureIndex++) {
+		MeasureChange change{ measureIndex, false, {} };
+		change.headerChanged = !sameBytes(before, before.headerOffsets[measureIndex], before.headerOffsets[measureIndex + 1],
+										  after, after.headerOffsets[measureIndex], after.headerOffsets[measureIndex + 1]);
+		for (int track = 0; track < trackCount; track++) {
+			size_t block = (size_t)measureIndex * trackCount + track;
+			if (!sameBytes(before, before.measureOffsets[block], before.measureOffsets[block + 1],
+						   after, after.measureOffsets[block], after.measureOffsets[block + 1])) {
+				change.tracks.push_back(track);
+			}
+		}
+
+		if (change.headerChanged || !change.tracks.empty()) {
+			changes.measures.push_back(std::move(change));
+		}
+	}
+	return changes;
+}
+
+SongReload::~SongReload() {
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+}
+
+void SongReload::start(const GPFile &song, const std::string &filePath, int openFlags) {
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+
+	this->filePath = filePath;
+	this->openFlags = openFlags;
+	this->shown = getSongFileLayout(song);
+	this->done = false;
+	this->thread = std::thread(&SongReload::read, this);
+}
+
+void SongReload::read() {
+	auto file = std::make_shared<std::vector<char>>();
+	this->song = nullptr;
+	this->changes = SongChanges();
+	this->status = gp_read::load_file(this->filePath, *file);
+
+	// the new version is read the same way the song was, and replaces it in apply as it is
+	if (this->status == 0) {
+		this->song = std::make_unique<GPFile>();
+		this->status = this->song->read_buffer(this->filePath, file, this->openFlags | gp_open_quiet);
+		if (this->status == 0) {
+			this->changes = findSongChanges(this->shown, getSongFileLayout(*this->song));
+		}
+	}
+	this->done = true;
+}
+
+bool SongReload::has_new_version() const {
+	return this->done && this->status == 0 && (this->changes.everything || !this->changes.measures.empty());
+}
+
+int SongReload::apply(GPFile &song, SongChanges &changes) {
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+	changes = SongChanges();
+	if (this->status != 0) {
+		this->song = nullptr;
+		return 1;
+	}
+
+	// nothing to replace if the file was saved without changing it
+	if (this->changes.everything || !this->changes.measures.empty()) {
+		song.replace(std::move(*this->song));
+		// the thread only read it quietly so it wouldn't print over the screen
+		song.openFlags = this->openFlags;
+	}
+	this->song = nullptr;
+	changes = std::move(this->changes);
+	return 0;
+}
+
+void SongReload::discard() {
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+	this->song = nullptr;
+	this->changes = SongChanges();
+}
@@ -0,0 +1,84 @@
+#ifndef SONG_RELOAD_H
+#define SONG_RELOAD_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+
+#include "gp_file.hpp"
+
+// a measure that's different in a new version of a song
+struct MeasureChange {
+	int measureIndex;
+	bool headerChanged;
+	std::vector<int> tracks;	// the tracks whose beats changed, in order
+};
+
+// what's different between two versions of a song
+struct SongChanges {
+	// the song info, the track headers or the number of measures or tracks changed, so everything has to be shown again
+	bool everything = false;
+	// otherwise the measures that changed, in order
+	std::vector<MeasureChange> measures;
+};
+
+// where the parts of a song are in the file it was read from, which is all that's needed to compare two versions
+// the measures are compared as they're stored, so none of them have to be decoded
+struct SongFileLayout {
+	std::shared_ptr<const std::vector<char>> file;
+	std::vector<size_t> headerOffsets;
+	std::vector<size_t> measureOffsets;
+	int measureCount = 0;
+	int trackCount = 0;
+	// false if the song didn't read cleanly, or has been edited since, so its file can't be compared
+	bool complete = false;
+};
+
+SongFileLayout getSongFileLayout(const GPFile &song);
+// the measures of after that aren't stored the same way as in before
+SongChanges findSongChanges(const SongFileLayout &before, const SongFileLayout &after);
+
+// reads a new version of a song's file on another thread, while the old version is still shown
+class SongReload {
+	public:
+		SongReload() = default;
+		~SongReload();
+
+		SongReload(const SongReload &) = delete;
+		SongReload &operator=(const SongReload &) = delete;
+
+		// the song is only looked at before start returns, openFlags are what it was opened with
+		void start(const GPFile &song, const std::string &filePath, int openFlags);
+		bool running() const { return this->thread.joinable(); }
+		// whether the thread is done, and apply won't have to wait for it
+		bool finished() const { return this->done; }
+
+		// whether the thread is done and has read a version that differs from the one it was started with
+		bool has_new_version() const;
+
+		// waits for the thread, and puts the version it read in the song if it differs from the one it was started with
+		// returns 1 if the thread couldn't read the file, the song is left as it was then
+		int apply(GPFile &song, SongChanges &changes);
+		// waits for the thread, and drops the version it read
+		void discard();
+
+	private:
+		std::thread thread;
+		std::atomic<bool> done{false};
+
+		std::string filePath;
+		int openFlags = gp_open_default;
+		SongFileLayout shown;
+
+		// written by the thread
+		std::unique_ptr<GPFile> song;
+		int status = 0;
+		SongChanges changes;
+
+		void read();
+};
+
+#endif // !SONG_RELOAD_H
@@ -0,0 +1,69 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+// a fixed size queue between exactly one producer thread and one consumer thread, without locks
+// neither side ever waits for the other inside push or pop, so the consumer can be a real time audio thread
+template <typename T>
+class SpscRing {
+	public:
+		// the capacity is rounded up to a power of two
+		SpscRing(size_t capacity) {
+			size_t size = 2;
+			while (size < capacity) {
+				size *= 2;
+			}
+			this->items.resize(size);
+			this->mask = size - 1;
+		}
+
+		SpscRing(const SpscRing &) = delete;
+		SpscRing &operator=(const SpscRing &) = delete;
+
+		size_t capacity() const { return this->items.size(); }
+
+		// producer only, returns false if the ring is full
+		bool push(const T &item) {
+			size_t tail = this->tail.load(std::memory_order_relaxed);
+			if (tail - this->cachedHead == this->items.size()) {
+				this->cachedHead = this->head.load(std::memory_order_acquire);
+				if (tail - this->cachedHead == this->items.size()) {
+					return false;
+				}
+			}
+			this->items[tail & this->mask] = item;
+			this->tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer only, returns false if the ring is empty
+		bool pop(T &item) {
+			size_t head = this->head.load(std::memory_order_relaxed);
+			if (head == this->cachedTail) {
+				this->cachedTail = this->tail.load(std::memory_order_acquire);
+				if (head == this->cachedTail) {
+					return false;
+				}
+			}
+			item = this->items[head & this->mask];
+			this->head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::vector<T> items;
+		size_t mask;
+
+		// the counters only ever grow, the index into items is the counter masked
+		// each side keeps its own copy of the other side's counter, so it only has to read
+		// the shared one when the ring looks full or empty, and the two stay on separate cache lines
+		alignas(64) std::atomic<size_t> head{0};	// written by the consumer
+		size_t cachedTail = 0;
+		alignas(64) std::atomic<size_t> tail{0};	// written by the producer
+		size_t cachedHead = 0;
+};
+
+#endif // !SPSC_RING_H
@@ -0,0 +1,459 @@
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+	#include <curses.h>
+#else
+	#include <ncurses.h>
+#endif
+
+#include "stacked_view.hpp"
+#include "gpedit.hpp"
+#include "gp_file.hpp"
+#include "windows.hpp"
+#include "tab_layout.hpp"
+#include "beat_index.hpp"
+#include "perf_hud.hpp"
+
+// the columns of a measure, shared by every track
+// each tick that a beat starts at in any track gets a column as wide as the widest beat starting there
+struct MeasureColumns {
+	bool computed = false;
+	std::vector<long long> ticks;	// from the start of the measure, in order
+	std::vector<int> offsets;	// the column of each tick, counted from the bar line
+	std::vector<std::vector<int>> beatOffsets;	// the column of every beat in every track, so printing doesn't decode the measure again
+	int width = 0;	// bar line included
+};
+
+// a track's row of tab, printed into a pad once per chunk and then only copied to the screen
+struct TrackRow {
+	WINDOW *pad = nullptr;
+	int printedChunk = -1;
+};
+
+// every track's beats have to be laid out to line the columns up, so the chunks only span a few screens
+static const int chunkScreens = 3;
+static const int rowLeft = 5;	// room for the string names
+static const int rowRightMargin = 2;
+
+static WINDOW *stackWindow = nullptr;
+
+// kept while the same song is open, the pads are freed when the view is closed
+static std::vector<std::unique_ptr<TrackLayout>> trackLayouts;
+static std::vector<MeasureColumns> measureColumns;
+static std::vector<TrackRow> trackRows;
+
+// the measures from chunkFirstMeasure up to chunkEndMeasure are in the pads
+static int chunk = 0;	// increases every time a new chunk is picked, so rows know they're out of date
+static int chunkFirstMeasure = 0;
+static int chunkEndMeasure = 0;
+static int chunkWidth = 0;
+static std::vector<int> chunkMeasureOffsets;
+
+static int firstTrack = 0;	// the top track on screen
+static int viewColumn = 0;	// the first pad column on screen
+static int selectedTrack = 0;
+static int selectedMeasure = 0;
+
+static int stringCount(int track) {
+	return std::min(std::max(song.trackHeaders[track].stringCount, 0), 7);
+}
+
+// the title line, then the tuplets, the durations and the strings
+static int rowHeight(int track) {
+	return stringCount(track) + 3;
+}
+
+static int viewWidth() {
+	return std::max(getmaxx(stackWindow) - rowLeft - rowRightMargin, 1);
+}
+
+static TrackLayout &getTrackLayout(int track) {
+	if (!trackLayouts[track]) {
+		trackLayouts[track] = std::make_unique<TrackLayout>(song, track);
+	}
+	return *trackLayouts[track];
+}
+
+static const MeasureColumns &getMeasureColumns(int measureIndex) {
+	MeasureColumns &columns = measureColumns[measureIndex];
+	if (columns.computed) {
+		return columns;
+	}
+
+	// where each beat starts and how wide it is, in every track
+	std::vector<std::pair<long long, int>> beatStarts;
+	std::vector<std::vector<long long>> beatTicks(song.trackCount);
+	for (int track = 0; track < song.trackCount; track++) {
+		const std::vector<BeatLayout> &layouts = getTrackLayout(track).measure(measureIndex);
+		// the layout may have decoded other measures, so the measure is only asked for after it
+		const Measure &measure = song.get_measure(measureIndex, track);
+
+		long long tick = 0;
+		for (size_t beatIndex = 0; beatIndex < layouts.size() && beatIndex < measure.beats.size(); beatIndex++) {
+			beatStarts.push_back(std::make_pair(tick, layouts[beatIndex].width));
+			beatTicks[track].push_back(tick);
+			tick += getBeatTicks(measure.beats[beatIndex]);
+		}
+	}
+	std::sort(beatStarts.begin(), beatStarts.end());
+
+	columns.ticks.clear();
+	columns.offsets.clear();
+	int offset = 2;	// bar line
+	for (size_t i = 0; i < beatStarts.size(); ) {
+		long long tick = beatStarts[i].first;
+		int width = 0;
+		for (; i < beatStarts.size() && beatStarts[i].first == tick; i++) {
+			width = std::max(width, beatStarts[i].second);
+		}
+		columns.ticks.push_back(tick);
+		columns.offsets.push_back(offset);
+		offset += width;
+	}
+	columns.width = std::max(offset, 4);
+
+	columns.beatOffsets.assign(song.trackCount, std::vector<int>());
+	for (int track = 0; track < song.trackCount; track++) {
+		for (long long tick : beatTicks[track]) {
+			size_t column = std::lower_bound(columns.ticks.begin(), columns.ticks.end(), tick) - columns.ticks.begin();
+			columns.beatOffsets[track].push_back(columns.offsets[column]);
+		}
+	}
+	columns.computed = true;
+	return columns;
+}
+
+// picks the measures around centerMeasure that fit in a pad, the rows are printed once they're shown
+static void pickChunk(int centerMeasure) {
+	auto startTime = std::chrono::steady_clock::now();
+	int maxWidth = chunkScreens * viewWidth();
+	int firstMeasure = centerMeasure;
+	int width = getMeasureColumns(centerMeasure).width;
+	while (firstMeasure > 0 && width + getMeasureColumns(firstMeasure-1).width < maxWidth/2) {
+		firstMeasure--;
+		width += getMeasureColumns(firstMeasure).width;
+	}
+	int endMeasure = centerMeasure+1;
+	while (endMeasure < song.measureCount && width + getMeasureColumns(endMeasure).width < maxWidth) {
+		width += getMeasureColumns(endMeasure).width;
+		endMeasure++;
+	}
+
+	chunk++;
+	chunkFirstMeasure = firstMeasure;
+	chunkEndMeasure = endMeasure;
+	chunkWidth = width + 1;	// closing bar line
+
+	chunkMeasureOffsets.clear();
+	int offset = 0;
+	for (int measureIndex = firstMeasure; measureIndex < endMeasure; measureIndex++) {
+		chunkMeasureOffsets.push_back(offset);
+		offset += getMeasureColumns(measureIndex).width;
+	}
+	editorTimings.trackChunks.add(millisecondsSince(startTime));
+}
+
+// prints the chunk into the track's pad, unless it's already there
+static WINDOW *getTrackRow(int track) {
+	TrackRow &row = trackRows[track];
+	if (row.printedChunk == chunk) {
+		return row.pad;
+	}
+	auto startTime = std::chrono::steady_clock::now();
+
+	int strings = stringCount(track);
+	int width = std::max(chunkWidth, viewWidth());
+	if (row.pad == nullptr || getmaxx(row.pad) != width) {
+		if (row.pad != nullptr) {
+			delwin(row.pad);
+		}
+		row.pad = newpad(strings+2, width);
+	}
+	werase(row.pad);
+
+	TrackLayout &layout = getTrackLayout(track);
+	for (int measureIndex = chunkFirstMeasure; measureIndex < chunkEndMeasure; measureIndex++) {
+		const MeasureColumns &columns = getMeasureColumns(measureIndex);
+		int measureOffset = chunkMeasureOffsets[measureIndex - chunkFirstMeasure];
+
+		const char *barLine = (measureIndex == chunkFirstMeasure && measureIndex > 0) ? ":" : "|";
+		for (int stringIndex = 0; stringIndex < strings; stringIndex++) {
+			mvwaddstr(row.pad, 2+stringIndex, measureOffset, barLine);
+			mvwhline(row.pad, 2+stringIndex, measureOffset+1, '-', columns.width-1);
+		}
+
+		const std::vector<BeatLayout> &layouts = layout.measure(measureIndex);
+		const std::vector<int> &beatOffsets = columns.beatOffsets[track];
+		for (size_t beatIndex = 0; beatIndex < layouts.size() && beatIndex < beatOffsets.size(); beatIndex++) {
+			const BeatLayout &beat = layouts[beatIndex];
+			int beatOffset = measureOffset + beatOffsets[beatIndex];
+
+			mvwaddstr(row.pad, 0, beatOffset, beat.tuplet.c_str());
+			mvwaddstr(row.pad, 1, beatOffset, beat.duration.c_str());
+			for (int stringIndex = 0; stringIndex < strings; stringIndex++) {
+				mvwaddstr(row.pad, 2+stringIndex, beatOffset, beat.strings[stringIndex].c_str());
+			}
+		}
+	}
+
+	const char *ending = chunkEndMeasure >= song.measureCount ? "|" : ":";
+	for (int stringIndex = 0; stringIndex < strings; stringIndex++) {
+		mvwaddstr(row.pad, 2+stringIndex, chunkWidth-1, ending);
+	}
+
+	row.printedChunk = chunk;
+	editorTimings.trackChunks.add(millisecondsSince(startTime));
+	return row.pad;
+}
+
+// marks the selected measure on the duration line of the selected track
+static void highlightSelection(attr_t attributes) {
+	TrackRow &row = trackRows[selectedTrack];
+	if (row.printedChunk != chunk) {
+		return;
+	}
+	int offset = chunkMeasureOffsets[selectedMeasure - chunkFirstMeasure];
+	mvwchgat(row.pad, 1, offset+1, getMeasureColumns(selectedMeasure).width-1, attributes, 0, NULL);
+}
+
+// scrolls as little as possible to get the selected measure and track on the screen
+static void scrollToSelection() {
+	if (selectedMeasure < chunkFirstMeasure || selectedMeasure >= chunkEndMeasure) {
+		pickChunk(selectedMeasure);
+		viewColumn = 0;
+	}
+
+	int offset = chunkMeasureOffsets[selectedMeasure - chunkFirstMeasure];
+	int width = getMeasureColumns(selectedMeasure).width;
+	if (offset < viewColumn) {
+		viewColumn = offset;
+	}
+	else if (offset + width > viewColumn + viewWidth()) {
+		viewColumn = std::min(offset, offset + width - viewWidth());
+	}
+	viewColumn = std::max(std::min(viewColumn, chunkWidth - viewWidth()), 0);
+
+	if (selectedTrack < firstTrack) {
+		firstTrack = selectedTrack;
+	}
+	int height = getmaxy(stackWindow) - 2;
+	while (firstTrack < selectedTrack) {
+		int rows = 0;
+		for (int track = firstTrack; track <= selectedTrack; track++) {
+			rows += rowHeight(track);
+		}
+		if (rows <= height) {
+			break;
+		}
+		firstTrack++;
+	}
+}
+
+void openStackedView() {
+	int top = getmaxy(songInfoWindow);
+	stackWindow = newwin(std::max(getmaxy(stdscr) - top, 3), getmaxx(stdscr), top, 0);
+	keypad(stackWindow, true);
+
+	trackLayouts.resize(song.trackCount);
+	measureColumns.resize(song.measureCount);
+	trackRows.resize(song.trackCount);
+
+	selectedTrack = std::min(std::max(trackIndex, 0), std::max(song.trackCount-1, 0));
+	selectedMeasure = 0;
+	firstTrack = 0;
+	viewColumn = 0;
+	chunkFirstMeasure = chunkEndMeasure = 0;
+}
+
+bool drawStackedFrame() {
+	if (song.trackCount == 0 || song.measureCount == 0) {
+		return false;
+	}
+	auto startTime = std::chrono::steady_clock::now();
+	scrollToSelection();
+
+	werase(stackWindow);
+	box(stackWindow, 0, 0);
+	wattron(stackWindow, A_REVERSE);
+	mvwprintw(stackWindow, 0, 0, "All tracks, measure %d", selectedMeasure+1);
+	wattroff(stackWindow, A_REVERSE);
+
+	// the names and the string names are printed into the window, the tab is copied over it from the pads
+	int height = getmaxy(stackWindow) - 2;
+	int line = 1;
+	int lastTrack = firstTrack;
+	for (int track = firstTrack; track < song.trackCount && line + rowHeight(track) <= height+1; track++) {
+		const TrackHeader &header = song.trackHeaders[track];
+		if (track == selectedTrack) {
+			wattron(stackWindow, A_REVERSE);
+		}
+		mvwprintw(stackWindow, line, 1, "%d. %.*s", track+1, header.name.length(), header.name.data());
+		wattroff(stackWindow, A_REVERSE);
+
+		for (int stringIndex = 0; stringIndex < stringCount(track); stringIndex++) {
+			mvwprintw(stackWindow, line+3+stringIndex, 1, "%s", getStringName(header.stringTuning[stringIndex]).c_str());
+		}
+		line += rowHeight(track);
+		lastTrack = track+1;
+	}
+	wnoutrefresh(stackWindow);
+
+	int top = getbegy(stackWindow) + 1;
+	int left = getbegx(stackWindow) + rowLeft;
+	for (int track = firstTrack; track < lastTrack; track++) {
+		WINDOW *pad = getTrackRow(track);
+		if (track == selectedTrack) {
+			highlightSelection(A_REVERSE);
+		}
+		int padTop = top + 1;
+		pnoutrefresh(pad, 0, viewColumn, padTop, left, padTop + getmaxy(pad)-1, left + viewWidth()-1);
+		top += rowHeight(track);
+	}
+	doupdate();
+	frameDrawn(startTime);
+	return true;
+}
+
+void handleStackedKey(int key) {
+	if (song.trackCount == 0 || song.measureCount == 0) {
+		return;
+	}
+	highlightSelection(A_NORMAL);
+
+	switch (key) {
+		case KEY_LEFT:
+			if (selectedMeasure > 0) {
+				selectedMeasure--;
+			}
+			break;
+		case KEY_RIGHT:
+			if (selectedMeasure < song.measureCount-1) {
+				selectedMeasure++;
+			}
+			break;
+		case KEY_UP:
+			if (selectedTrack > 0) {
+				selectedTrack--;
+			}
+			break;
+		case KEY_DOWN:
+			if (selectedTrack < song.trackCount-1) {
+				selectedTrack++;
+			}
+			break;
+	}
+}
+
+void updateStackedView(const SongChanges &changes) {
+	// the layouts and columns are kept while the view is closed, so they're updated either way
+	if (changes.everything) {
+		for (TrackRow &row : trackRows) {
+			if (row.pad != nullptr) {
+				delwin(row.pad);
+			}
+		}
+		trackLayouts.clear();
+		measureColumns.clear();
+		trackRows.clear();
+		if (stackWindow == nullptr) {
+			return;
+		}
+
+		trackLayouts.resize(song.trackCount);
+		measureColumns.resize(song.measureCount);
+		trackRows.resize(song.trackCount);
+		selectedTrack = std::min(selectedTrack, std::max(song.trackCount-1, 0));
+		selectedMeasure = std::min(selectedMeasure, std::max(song.measureCount-1, 0));
+		firstTrack = 0;
+		// a new chunk is picked on the next frame
+		chunkFirstMeasure = chunkEndMeasure = 0;
+		return;
+	}
+
+	// nothing has been laid out before the view is first opened
+	if (measureColumns.empty()) {
+		return;
+	}
+
+	bool columnsMoved = false;
+	for (const MeasureChange &change : changes.measures) {
+		for (int track : change.tracks) {
+			if (trackLayouts[track]) {
+				trackLayouts[track]->invalidate_measure(change.measureIndex);
+			}
+		}
+		if (change.tracks.empty()) {
+			continue;
+		}
+
+		// the last beats of the measure before are laid out again too, which can widen its columns
+		int firstMeasure = std::max(change.measureIndex-1, 0);
+		for (int measureIndex = firstMeasure; measureIndex <= change.measureIndex; measureIndex++) {
+			MeasureColumns &columns = measureColumns[measureIndex];
+			if (!columns.computed) {
+				continue;
+			}
+			MeasureColumns before = std::move(columns);
+			columns = MeasureColumns();
+			bool inChunk = measureIndex >= chunkFirstMeasure && measureIndex < chunkEndMeasure;
+			if (stackWindow != nullptr && inChunk) {
+				const MeasureColumns &after = getMeasureColumns(measureIndex);
+				columnsMoved = columnsMoved || after.width != before.width || after.beatOffsets != before.beatOffsets;
+			}
+		}
+
+		// with the columns where they were, only the changed tracks have to be printed again
+		if (change.measureIndex-1 < chunkEndMeasure && change.measureIndex >= chunkFirstMeasure) {
+			for (int track : change.tracks) {
+				trackRows[track].printedChunk = -1;
+			}
+		}
+	}
+
+	if (columnsMoved) {
+		// the selected measure stays where it is on the screen
+		int screenColumn = chunkMeasureOffsets[selectedMeasure - chunkFirstMeasure] - viewColumn;
+		pickChunk(selectedMeasure);
+		viewColumn = chunkMeasureOffsets[selectedMeasure - chunkFirstMeasure] - screenColumn;
+	}
+}
+
+void closeStackedView() {
+	for (TrackRow &row : trackRows) {
+		if (row.pad != nullptr) {
+			delwin(row.pad);
+		}
+		row = TrackRow();
+	}
+
+	wclear(stackWindow);
+	wrefresh(stackWindow);
+	delwin(stackWindow);
+	stackWindow = nullptr;
+
+	refresh();
+}
+
+int stackedViewTrack() {
+	return selectedTrack;
+}
+
+void viewAllTracks() {
+	openStackedView();
+
+	while (drawStackedFrame()) {
+		keyboardInput = waitForKey(stackWindow);
+		if (keyboardInput == 27 || keyboardInput == 10) {
+			break;
+		}
+		handleStackedKey(keyboardInput);
+	}
+
+	if (keyboardInput == 10) {
+		trackIndex = selectedTrack;
+	}
+	closeStackedView();
+}
@@ -0,0 +1,24 @@
+#ifndef STACKED_VIEW_H
+#define STACKED_VIEW_H
+
+#include "song_reload.hpp"
+
+// every track of the song below each other, with the beats that are played at the same time in the same column
+// only the tracks that fit on the screen are printed, and only the measures around the selected one
+
+// the view, split up so it can also be driven without a keyboard
+void openStackedView();
+// returns false if the song has no tracks or measures
+bool drawStackedFrame();
+void handleStackedKey(int key);
+void closeStackedView();
+// call after the song has been read again, only the measures that changed are laid out and printed again
+void updateStackedView(const SongChanges &changes);
+
+// the track the selection is on
+int stackedViewTrack();
+
+// shows the view until escape or enter is pressed, enter selects the track the selection is on
+void viewAllTracks();
+
+#endif // !STACKED_VIEW_H
@@ -0,0 +1,280 @@
+#include <string>
+
+#include "tab_layout.hpp"
+#include "gp_file.hpp"
+
+// the string tuning value is stored as an integer corresponding to its MIDI note value
+// the MIDI note value represents the number of semitones above the lowest note, C(-1)
+std::string getStringName(int tuningValue) {
+	std::string noteNames[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+	int noteIndex = tuningValue % 12;
+	int octave = (tuningValue / 12) - 1;
+
+	return noteNames[noteIndex] + std::to_string(octave);
+}
+
+std::string getDurationSymbol(const Beat &beat) {
+	std::string beatDuration;
+	switch (beat.duration) {
+		case gp_duration_whole:
+			beatDuration = "w";
+			break;
+		case gp_duration_half:
+			beatDuration = "h";
+			break;
+		case gp_duration_quarter:
+			beatDuration = "q";
+			break;
+		case gp_duration_eighth:
+			beatDuration = "e";
+			break;
+		case gp_duration_sixteenth:
+			beatDuration = "s";
+			break;
+		case gp_duration_thirty_second:
+			beatDuration = "t";
+			break;
+		case gp_duration_sixty_fourth:
+			beatDuration = "S";
+			break;
+	}
+	if (beat.beatFlags & gp_beat_is_dotted) {
+		beatDuration.append(".");
+	}
+	return beatDuration;
+}
+
+// returns the glyphs for one string of a beat, and adds the number of columns they take up to beatWidth
+static std::string layoutNote(const Beat &beat, const Note &note, const Note *followingNote, int &beatWidth) {
+	std::string glyphs;
+
+	if (note.noteFlags & gp_note_is_ghost) {
+		glyphs += "(";
+		beatWidth++;
+	}
+
+	if (note.noteType == gp_notetype_dead) {
+		glyphs += "x";
+		beatWidth++;
+	}
+	else if (note.noteType == gp_notetype_tied) {
+		glyphs += "*";
+		beatWidth++;
+	}
+	else {	// note.noteType = gp_notetype_normal
+		std::string fret = std::to_string(note.fretNumber);
+		glyphs += fret;
+		beatWidth += fret.length();
+	}
+
+	if (note.noteFlags & gp_note_is_ghost) {
+		glyphs += ")";
+		beatWidth++;
+	}
+
+	if (note.noteFlags & gp_note_is_accent) {
+		glyphs += ">";
+		beatWidth++;
+	}
+
+	if (note.noteFlags & gp_note_is_heavy_accent) {
+		glyphs += "t^";
+		beatWidth++;
+	}
+
+	if (beat.beatFlags & gp_beat_has_effects) {
+		if (beat.effects.beatEffectFlags & gp_beatfx_vibrato) {
+			glyphs += "~";
+			beatWidth++;
+		}
+
+		if (beat.effects.beatEffectFlags & gp_beatfx_natural_harmonic) {
+			glyphs += "+";
+			beatWidth++;
+		}
+
+		if (beat.effects.beatEffectFlags & gp_beatfx_tremolo_or_tap) {
+			switch (beat.effects.tremoloOrTap) {
+				case 0:	// tremolo bar
+					glyphs += "v";
+					beatWidth++;
+					break;
+				case 1:	// tap
+					glyphs += "t";
+					beatWidth++;
+					break;
+				case 2:	// slap
+					glyphs += "s";
+					beatWidth++;
+					break;
+				case 3:	// pop
+					glyphs += "P";
+					beatWidth++;
+					break;
+			}
+		}
+	}
+
+	if (note.noteFlags & gp_note_has_effects) {
+		if (note.noteEffectFlags & gp_notefx_bend) {
+			switch (note.noteBend.type) {
+				case gp_bendtype_bend:
+					glyphs += "b";
+					beatWidth++;
+					break;
+				case gp_bendtype_bend_release:
+					glyphs += "br";
+					beatWidth += 2;
+					break;
+				case gp_bendtype_bend_release_bend:
+					glyphs += "brb";
+					beatWidth += 3;
+					break;
+				case gp_bendtype_prebend:
+					glyphs += "pb";
+					beatWidth += 2;
+					break;
+				case gp_bendtype_prebend_release:
+					glyphs += "pbr";
+					beatWidth += 3;
+					break;
+				default:
+					break;
+			}
+		}
+
+		// going down if the following note is on a lower fret, up otherwise
+		bool followingIsLower = followingNote && followingNote->fretNumber < note.fretNumber;
+
+		if (note.noteEffectFlags & gp_notefx_hammer_pull) {
+			glyphs += followingIsLower ? "p" : "h";
+			// beatWidth is not incremented, cause there shouldn't be any space before the next note
+		}
+
+		if (note.noteEffectFlags & gp_notefx_slide) {
+			glyphs += followingIsLower ? "\\" : "/";
+			// beatWidth is not incremented, cause there shouldn't be any space before the next note
+		}
+
+		if (note.noteEffectFlags & gp_notefx_let_ring) {
+			// TODO: figure something out
+		}
+
+		if (note.noteEffectFlags & gp_notefx_grace_note) {
+			// TODO: figure something out
+			// being a grace note is not a property of a note,
+			// but rather a grace note is attatched to the note it preceeds,
+			// meaning it has to be printed before it
+		}
+	}
+
+	return glyphs;
+}
+
+BeatLayout layoutBeat(const TrackHeader &track, const Beat &beat, const Beat *followingBeat) {
+	BeatLayout layout;
+
+	if (beat.beatFlags & gp_beat_is_tuplet) {
+		layout.tuplet = std::to_string(beat.tupletDivision);
+	}
+	layout.duration = getDurationSymbol(beat);
+
+	int maxBeatWidth = 0;	// keeps track of the maximum printed width of the beat
+	int beatWidth;	// printed beat width of current string
+
+	for (int stringIndex = 0; stringIndex < track.stringCount && stringIndex < 7; stringIndex++) {	// loop through the strings
+		beatWidth = 1;
+
+		if (beat.beatNotes.stringsPlayed & (0x40 >> stringIndex)) {	// check if string is played
+			const Note *followingNote = nullptr;
+			if (followingBeat && (followingBeat->beatNotes.stringsPlayed & (0x40 >> stringIndex))) {
+				followingNote = &followingBeat->beatNotes.strings[stringIndex];
+			}
+
+			layout.strings[stringIndex] = layoutNote(beat, beat.beatNotes.strings[stringIndex], followingNote, beatWidth);
+
+			// some glyphs (like t^) are wider than they count for, don't let the next beat cover them
+			if ((int)layout.strings[stringIndex].length() > beatWidth) {
+				beatWidth = layout.strings[stringIndex].length();
+			}
+		}
+		else {	// string is not played
+			beatWidth++;
+		}
+
+		maxBeatWidth = beatWidth > maxBeatWidth ? beatWidth : maxBeatWidth;
+	}
+
+	layout.width = maxBeatWidth;
+	return layout;
+}
+
+TrackLayout::TrackLayout(GPFile &song, int trackIndex) : song(song), trackIndex(trackIndex) {
+	invalidate_all();
+}
+
+BeatLayout TrackLayout::layout_beat(int measureIndex, int beatIndex) {
+	const TrackHeader &track = this->song.trackHeaders[this->trackIndex];
+	const Measure &measure = this->song.get_measure(measureIndex, this->trackIndex);
+
+	// the following beat decides if slides and hammer-ons go up or down
+	// with lazy measures this relies on the song's cache holding at least the two measures involved
+	const Beat *followingBeat = nullptr;
+	if (beatIndex+1 < (int)measure.beats.size()) {
+		followingBeat = &measure.beats[beatIndex + 1];
+	}
+	else if (measureIndex+1 < this->song.measureCount) {
+		const Measure &followingMeasure = this->song.get_measure(measureIndex+1, this->trackIndex);
+		if (!followingMeasure.beats.empty()) {
+			followingBeat = &followingMeasure.beats[0];
+		}
+	}
+
+	return layoutBeat(track, measure.beats[beatIndex], followingBeat);
+}
+
+const std::vector<BeatLayout> &TrackLayout::measure(int measureIndex) {
+	std::vector<BeatLayout> &layouts = this->measures[measureIndex];
+	if (this->laidOut[measureIndex]) {
+		return layouts;
+	}
+
+	int beatCount = this->song.get_measure(measureIndex, this->trackIndex).beats.size();
+
+	layouts.clear();
+	layouts.reserve(beatCount);
+	for (int beatIndex = 0; beatIndex < beatCount; beatIndex++) {
+		layouts.push_back(layout_beat(measureIndex, beatIndex));
+	}
+
+	this->laidOut[measureIndex] = true;
+	return layouts;
+}
+
+void TrackLayout::invalidate_beat(int measureIndex, int beatIndex) {
+	if (beatIndex == 0) {
+		// the first beat of a measure is what the last beat of the previous one looks ahead to
+		invalidate_measure(measureIndex);
+		return;
+	}
+
+	if (this->laidOut[measureIndex]) {
+		std::vector<BeatLayout> &layouts = this->measures[measureIndex];
+		for (int i = beatIndex-1; i <= beatIndex && i < (int)layouts.size(); i++) {
+			layouts[i] = layout_beat(measureIndex, i);
+		}
+	}
+}
+
+void TrackLayout::invalidate_measure(int measureIndex) {
+	this->laidOut[measureIndex] = false;
+	if (measureIndex > 0) {
+		this->laidOut[measureIndex-1] = false;
+	}
+}
+
+void TrackLayout::invalidate_all() {
+	this->measures.assign(this->song.measureCount, std::vector<BeatLayout>());
+	this->laidOut.assign(this->song.measureCount, false);
+}
@@ -0,0 +1,56 @@
+#ifndef TAB_LAYOUT_H
+#define TAB_LAYOUT_H
+
+#include <string>
+#include <vector>
+
+#include "gp_file.hpp"
+
+// how a beat is drawn in the tab, shared by the editor and the text renderer
+struct BeatLayout {
+	std::string tuplet;	// printed above the duration, empty if the beat isn't a tuplet
+	std::string duration;	// "q", "e.", ...
+	std::string strings[7];	// what's printed on each string, the rest of the beat's width is left as '-'
+	int width;	// number of columns the beat takes up, including the '-' separating it from the next one
+};
+
+std::string getStringName(int tuningValue);
+
+// the duration symbol of a beat, "w", "h", "q", "e", "s", "t" or "S", followed by a '.' if it's dotted
+std::string getDurationSymbol(const Beat &beat);
+
+// lays out a beat, followingBeat is used to tell hammer-ons from pull-offs and up from down slides,
+// and can be nullptr at the end of the song
+BeatLayout layoutBeat(const TrackHeader &track, const Beat &beat, const Beat *followingBeat);
+
+// the layouts of every beat in a track, each measure is laid out the first time it's asked for
+// and then kept until one of its beats is invalidated, so scrolling only copies strings to the screen
+class TrackLayout {
+	public:
+		TrackLayout(GPFile &song, int trackIndex);
+
+		int track_index() const { return this->trackIndex; }
+
+		// the references stay valid until the measure or the one after it is invalidated
+		const std::vector<BeatLayout> &measure(int measureIndex);
+		const BeatLayout &beat(int measureIndex, int beatIndex) { return measure(measureIndex)[beatIndex]; }
+
+		// call after a beat has been edited, the beat before it is laid out again too,
+		// since its hammer-ons and slides depend on the edited beat
+		void invalidate_beat(int measureIndex, int beatIndex);
+		// call after beats have been added to or removed from a measure
+		void invalidate_measure(int measureIndex);
+		// call after the track header has been edited, or the whole song has changed
+		void invalidate_all();
+
+	private:
+		GPFile &song;
+		int trackIndex;
+
+		std::vector<std::vector<BeatLayout>> measures;
+		std::vector<bool> laidOut;
+
+		BeatLayout layout_beat(int measureIndex, int beatIndex);
+};
+
+#endif // !TAB_LAYOUT_H
\ No newline at end of file
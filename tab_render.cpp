@@ -0,0 +1,151 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "tab_render.hpp"
+#include "tab_layout.hpp"
+#include "gp_file.hpp"
+
+// one line of tab while it's being filled up
+class TabLine {
+	public:
+		TabLine(const TrackHeader &track) {
+			int stringCount = std::min(std::max(track.stringCount, 0), 7);
+
+			for (int stringIndex = 0; stringIndex < stringCount; stringIndex++) {
+				this->stringNames.push_back(getStringName(track.stringTuning[stringIndex]));
+				this->nameWidth = std::max(this->nameWidth, (int)this->stringNames.back().length() + 1);
+			}
+			this->strings.resize(stringCount);
+		}
+
+		int length() const { return this->durations.length(); }
+		bool empty() const { return this->length() <= this->startLength; }
+
+		void start(const std::string &beginning) {
+			for (size_t stringIndex = 0; stringIndex < this->strings.size(); stringIndex++) {
+				this->strings[stringIndex] = this->stringNames[stringIndex];
+				this->strings[stringIndex].resize(this->nameWidth, ' ');
+				this->strings[stringIndex] += beginning;
+			}
+			this->startLength = this->nameWidth + beginning.length();
+			this->tuplets.assign(this->startLength, ' ');
+			this->durations.assign(this->startLength, ' ');
+		}
+
+		void add_beat(const BeatLayout &layout) {
+			append_padded(this->tuplets, layout.tuplet, layout.width, ' ');
+			append_padded(this->durations, layout.duration, layout.width, ' ');
+			for (size_t stringIndex = 0; stringIndex < this->strings.size(); stringIndex++) {
+				append_padded(this->strings[stringIndex], layout.strings[stringIndex], layout.width, '-');
+			}
+		}
+
+		void add_bar_line() {
+			this->tuplets += "  ";
+			this->durations += "  ";
+			for (std::string &string : this->strings) {
+				string += "|-";
+			}
+		}
+
+		void write(const std::string &ending, std::ostream &output) {
+			if (this->tuplets.find_first_not_of(' ') != std::string::npos) {
+				write_line(this->tuplets, output);
+			}
+			write_line(this->durations, output);
+			for (std::string &string : this->strings) {
+				string += ending;
+				write_line(string, output);
+			}
+			output.put('\n');
+		}
+
+	private:
+		std::vector<std::string> stringNames;
+		int nameWidth = 0;
+		int startLength = 0;
+
+		std::string tuplets;
+		std::string durations;
+		std::vector<std::string> strings;
+
+		static void append_padded(std::string &line, const std::string &text, int width, char padding) {
+			line += text;
+			if ((int)text.length() < width) {
+				line.append(width - text.length(), padding);
+			}
+		}
+
+		static void write_line(const std::string &line, std::ostream &output) {
+			size_t end = line.find_last_not_of(' ');
+			output.write(line.data(), end == std::string::npos ? 0 : end + 1);
+			output.put('\n');
+		}
+};
+
+int renderTrack(GPFile &song, int trackIndex, int lineWidth, std::ostream &output) {
+	if (trackIndex < 0 || trackIndex >= song.trackCount) {
+		std::cerr << "There is no track " << trackIndex+1 << ".\n";
+		return 1;
+	}
+	const TrackHeader &track = song.trackHeaders[trackIndex];
+
+	TabLine line(track);
+	line.start("|-");
+
+	for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+		const Measure &measure = song.get_measure(measureIndex, trackIndex);
+
+		for (int beatIndex = 0; beatIndex < (int)measure.beats.size(); beatIndex++) {
+			// the following beat decides if slides and hammer-ons go up or down
+			const Beat *followingBeat = nullptr;
+			if (beatIndex+1 < (int)measure.beats.size()) {
+				followingBeat = &measure.beats[beatIndex + 1];
+			}
+			else if (measureIndex+1 < song.measureCount) {
+				const Measure &followingMeasure = song.get_measure(measureIndex+1, trackIndex);
+				if (!followingMeasure.beats.empty()) {
+					followingBeat = &followingMeasure.beats[0];
+				}
+			}
+
+			BeatLayout layout = layoutBeat(track, measure.beats[beatIndex], followingBeat);
+
+			// leave room for the ':' or '|' that ends the line
+			if (line.length() + layout.width + 1 > lineWidth && !line.empty()) {
+				line.write(":", output);
+				line.start(":-");
+			}
+			line.add_beat(layout);
+		}
+
+		if (measureIndex+1 >= song.measureCount) {	// end of song
+			line.write("|", output);
+		}
+		else if (line.length() + 3 > lineWidth) {	// no room for a bar line and a beat after it
+			line.write("|", output);
+			line.start("|-");
+		}
+		else {
+			line.add_bar_line();
+		}
+	}
+
+	output.flush();
+	return output ? 0 : 1;
+}
+
+int renderFile(const std::string &filePath, int trackNumber, int lineWidth, bool useCache, std::ostream &output) {
+	GPFile song;
+	int openFlags = gp_open_string_views|gp_open_lazy_measures;
+	if (useCache) {
+		openFlags |= gp_open_cache;
+	}
+	if (song.read_file(filePath, openFlags) != 0) {
+		return 1;
+	}
+
+	return renderTrack(song, trackNumber - 1, lineWidth, output);
+}
\ No newline at end of file
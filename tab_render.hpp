@@ -0,0 +1,17 @@
+#ifndef TAB_RENDER_H
+#define TAB_RENDER_H
+
+#include <ostream>
+
+#include "gp_file.hpp"
+
+// writes a whole track as plain text tab, wrapped at lineWidth columns
+// each line of tab is written as soon as it's full, so only one line is held in memory,
+// and with a lazily opened song only a couple of measures are decoded at a time
+int renderTrack(GPFile &song, int trackIndex, int lineWidth, std::ostream &output);
+
+// opens a file and renders one of its tracks, trackNumber counts from 1
+// with useCache the measures come from FILE.gpcache, which is written if it isn't up to date
+int renderFile(const std::string &filePath, int trackNumber, int lineWidth, bool useCache, std::ostream &output);
+
+#endif // !TAB_RENDER_H
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <vector>
+#include <algorithm>
+
+#include "tempo_map.hpp"
+#include "beat_index.hpp"
+#include "gp_file.hpp"
+#include "edit_history.hpp"
+
+int TempoMap::build(GPFile &song) {
+	if ((int)song.measureRows.size() < song.measureCount) {
+		return 1;
+	}
+	this->initialTempo = song.tempo;
+
+	count_measure_ticks(song, 0);
+
+	this->changes.clear();
+	// a lazily read song has noted the changes while it skipped the measures, decoding them all here would undo that
+	// they're where they were in the file, so only as long as nothing has been edited
+	const std::vector<MixTempoChange> *readChanges = song.read_tempo_changes();
+	if (readChanges && !song.has_edits()) {
+		for (const MixTempoChange &change : *readChanges) {
+			this->changes.push_back(TempoChange{ change.fileMeasure, change.measureOffset, change.tempo, change.rampBeats, change.rampTicks });
+		}
+		// they're in the order of the file, track after track within a measure, like find_changes goes through them
+		std::stable_sort(this->changes.begin(), this->changes.end(), [](const TempoChange &a, const TempoChange &b) {
+			return std::make_pair(a.measureIndex, a.measureOffset) < std::make_pair(b.measureIndex, b.measureOffset);
+		});
+	}
+	else {
+		for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+			find_changes(song, measureIndex);
+		}
+	}
+	build_segments();
+	return 0;
+}
+
+void TempoMap::count_measure_ticks(GPFile &song, int fromMeasure) {
+	this->measureTicks.resize(fromMeasure+1);
+	if (fromMeasure == 0) {
+		this->measureTicks[0] = 0;
+	}
+
+	// the time signature only appears in the header of the measure that changes it
+	int numerator = 4;
+	int denominator = 4;
+	for (int measureIndex = 0; measureIndex < song.measureCount; measureIndex++) {
+		const MeasureHeader &header = song.measure_header(measureIndex);
+		if (header.measureFlags & gp_measure_keysig_numerator) {
+			numerator = std::max((int)header.keysigNumerator, 1);
+		}
+		if (header.measureFlags & gp_measure_keysig_denominator) {
+			denominator = std::max((int)header.keysigDenominator, 1);
+		}
+
+		if (measureIndex >= fromMeasure) {
+			this->measureTicks.push_back(this->measureTicks.back() + (long long)ticksPerQuarter*4 * numerator / denominator);
+		}
+	}
+}
+
+long long TempoMap::beat_tick(int measureIndex, const Measure &measure, int beatIndex) const {
+	long long offset = 0;
+	for (int i = 0; i < beatIndex && i < (int)measure.beats.size(); i++) {
+		offset += getBeatTicks(measure.beats[i]);
+	}
+	long long measureLength = this->measureTicks[measureIndex+1] - this->measureTicks[measureIndex];
+	return this->measureTicks[measureIndex] + std::min(offset, measureLength);
+}
+
+void TempoMap::find_changes(GPFile &song, int measureIndex) {
+	for (int trackIndex = 0; trackIndex < song.trackCount; trackIndex++) {
+		const Measure &measure = song.get_measure(measureIndex, trackIndex);
+
+		long long offset = 0;
+		for (int beatIndex = 0; beatIndex < (int)measure.beats.size(); beatIndex++) {
+			const Beat &beat = measure.beats[beatIndex];
+			if ((beat.beatFlags & gp_beat_has_mix_change) && beat.mixTableChange.tempo > 0) {
+				TempoChange change = { measureIndex, offset, beat.mixTableChange.tempo, 0, 0 };
+
+				// the ramp may go on into the following measures
+				change.rampBeats = std::max((int)beat.mixTableChange.tempoDuration, 0);
+				int rampMeasure = measureIndex;
+				int rampBeat = beatIndex;
+				for (int i = 0; i < change.rampBeats && rampMeasure < song.measureCount; i++) {
+					const Measure &current = song.get_measure(rampMeasure, trackIndex);
+					if (rampBeat < (int)current.beats.size()) {
+						change.rampTicks += getBeatTicks(current.beats[rampBeat]);
+					}
+					if (++rampBeat >= (int)current.beats.size()) {
+						rampMeasure++;
+						rampBeat = 0;
+					}
+				}
+
+				this->changes.push_back(change);
+			}
+			offset += getBeatTicks(beat);
+		}
+	}
+
+	// the tracks are gone through one after another, but the changes have to be in order within the measure too
+	auto measureChanges = std::find_if(this->changes.begin(), this->changes.end(),
+		[&](const TempoChange &change) { return change.measureIndex == measureIndex; });
+	std::stable_sort(measureChanges, this->changes.end(),
+		[](const TempoChange &a, const TempoChange &b) { return a.measureOffset < b.measureOffset; });
+}
+
+void TempoMap::build_segments() {
+	this->segments.assign(1, TempoSegment{ 0, (double)std::max(this->initialTempo, 1), 0 });
+
+	auto addSegment = [&](long long tick, double tempo) {
+		TempoSegment &last = this->segments.back();
+		if (tick <= last.tick) {
+			last.tempo = tempo;
+			return;
+		}
+		double seconds = last.seconds + (tick - last.tick) * 60.0 / (last.tempo * ticksPerQuarter);
+		this->segments.push_back(TempoSegment{ tick, tempo, seconds });
+	};
+
+	for (size_t i = 0; i < this->changes.size(); i++) {
+		const TempoChange &change = this->changes[i];
+		long long tick = std::min(this->measureTicks[change.measureIndex] + change.measureOffset,
+			this->measureTicks[change.measureIndex+1]);
+
+		if (change.rampBeats <= 1 || change.rampTicks <= 0) {
+			addSegment(tick, change.tempo);
+			continue;
+		}
+
+		// a ramp changes the tempo a bit on each of its beats, until the next change interrupts it
+		long long nextChangeTick = this->measureTicks.back();
+		if (i+1 < this->changes.size()) {
+			const TempoChange &next = this->changes[i+1];
+			nextChangeTick = this->measureTicks[next.measureIndex] + next.measureOffset;
+		}
+		double startTempo = this->segments.back().tempo;
+		for (int step = 1; step <= change.rampBeats; step++) {
+			long long stepTick = tick + change.rampTicks * (step-1) / change.rampBeats;
+			if (step > 1 && stepTick >= nextChangeTick) {
+				break;
+			}
+			addSegment(stepTick, startTempo + (change.tempo - startTempo) * step / change.rampBeats);
+		}
+	}
+}
+
+void TempoMap::update_measure(GPFile &song, int measureIndex) {
+	// the ramps of earlier measures that go on into this one are counted again too,
+	// each of their beats takes them a measure further at most
+	int fromMeasure = measureIndex;
+	for (const TempoChange &change : this->changes) {
+		if (change.measureIndex < fromMeasure && change.measureIndex + change.rampBeats > measureIndex) {
+			fromMeasure = change.measureIndex;
+		}
+	}
+
+	// the measures' changes go between the ones before and after them
+	auto first = std::find_if(this->changes.begin(), this->changes.end(),
+		[&](const TempoChange &change) { return change.measureIndex >= fromMeasure; });
+	auto later = std::find_if(first, this->changes.end(),
+		[&](const TempoChange &change) { return change.measureIndex > measureIndex; });
+	std::vector<TempoChange> laterChanges(later, this->changes.end());
+	this->changes.erase(first, this->changes.end());
+
+	for (int i = fromMeasure; i <= measureIndex; i++) {
+		find_changes(song, i);
+	}
+	this->changes.insert(this->changes.end(), laterChanges.begin(), laterChanges.end());
+	build_segments();
+}
+
+void TempoMap::update_measure_header(GPFile &song, int measureIndex) {
+	count_measure_ticks(song, measureIndex);
+	build_segments();
+}
+
+void TempoMap::update_edits(GPFile &song, const EditCommand &command) {
+	int firstHeader = -1;
+	for (const EditStep &step : command.steps) {
+		if (step.type == edit_step_insert || step.type == edit_step_remove || step.type == edit_step_move) {
+			build(song);
+			return;
+		}
+		if (step.type == edit_step_header && (firstHeader < 0 || step.measureIndex < firstHeader)) {
+			firstHeader = step.measureIndex;
+		}
+	}
+
+	// the first changed header moves every measure after it, so one update covers the rest
+	if (firstHeader >= 0) {
+		update_measure_header(song, firstHeader);
+	}
+	for (const EditStep &step : command.steps) {
+		if (step.type == edit_step_change) {
+			update_measure(song, step.measureIndex);
+		}
+	}
+}
+
+int TempoMap::measure_at_tick(long long tick) const {
+	auto measure = std::upper_bound(this->measureTicks.begin(), this->measureTicks.end() - 1, tick);
+	return std::max((int)(measure - this->measureTicks.begin()) - 1, 0);
+}
+
+const TempoMap::TempoSegment &TempoMap::segment_at_tick(long long tick) const {
+	auto segment = std::upper_bound(this->segments.begin()+1, this->segments.end(), tick,
+		[](long long tick, const TempoSegment &segment) { return tick < segment.tick; });
+	return *(segment - 1);
+}
+
+double TempoMap::tick_to_seconds(long long tick) const {
+	const TempoSegment &segment = segment_at_tick(tick);
+	return segment.seconds + (tick - segment.tick) * 60.0 / (segment.tempo * ticksPerQuarter);
+}
+
+long long TempoMap::seconds_to_tick(double seconds) const {
+	auto found = std::upper_bound(this->segments.begin()+1, this->segments.end(), seconds,
+		[](double seconds, const TempoSegment &segment) { return seconds < segment.seconds; });
+	const TempoSegment &segment = *(found - 1);
+	return std::max(segment.tick + (long long)((seconds - segment.seconds) * segment.tempo * ticksPerQuarter / 60.0), 0LL);
+}
+
+double TempoMap::tempo_at_tick(long long tick) const {
+	return segment_at_tick(tick).tempo;
+}
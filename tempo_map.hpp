@@ -0,0 +1,75 @@
+#ifndef TEMPO_MAP_H
+#define TEMPO_MAP_H
+
+#include <vector>
+
+#include "gp_file.hpp"
+
+struct EditCommand;
+
+// where the measures of a song start, and how fast it's played at any point
+// the measures start where the time signatures say, so every track shares the same ticks,
+// and the tempo follows the tempo changes of the mix tables in any track, ramps included
+// everything that needs to know when something is played should ask this instead of walking the song
+class TempoMap {
+	public:
+		// from tick on the tempo stays the same until the next segment
+		struct TempoSegment {
+			long long tick;
+			double tempo;
+			double seconds;	// when the segment starts
+		};
+
+		// decodes every measure of every track once, unless the song noted its tempo changes when it was read lazily
+		// returns 1 if the song has no measure headers for its measures
+		int build(GPFile &song);
+
+		int measure_count() const { return (int)this->measureTicks.size() - 1; }
+
+		// the tick the measure starts at, measure_tick(measureCount) is the end of the song
+		long long measure_tick(int measureIndex) const { return this->measureTicks[measureIndex]; }
+		// the measure playing at the tick, ticks past the end give the last measure
+		int measure_at_tick(long long tick) const;
+
+		// the tick of a beat of a measure, beats past the length of their measure are put at its end
+		long long beat_tick(int measureIndex, const Measure &measure, int beatIndex) const;
+
+		double tick_to_seconds(long long tick) const;
+		long long seconds_to_tick(double seconds) const;
+		// in beats per minute
+		double tempo_at_tick(long long tick) const;
+		// every tempo the song is played at in order, for writing them out
+		const std::vector<TempoSegment> &tempo_segments() const { return this->segments; }
+
+		// call after the beats of a measure have been edited in any track
+		void update_measure(GPFile &song, int measureIndex);
+		// call after a measure header has been edited, the measures after it may have moved
+		void update_measure_header(GPFile &song, int measureIndex);
+		// call after a command of the edit history has been committed, undone or redone
+		// inserted, removed or moved measures move the changes of every measure after them, so the map is built again
+		void update_edits(GPFile &song, const EditCommand &command);
+
+	private:
+		// a tempo change in a mix table, placed in its measure so it moves along with it
+		struct TempoChange {
+			int measureIndex;
+			long long measureOffset;	// ticks from the start of the measure
+			int tempo;
+			int rampBeats;	// the tempo goes there over this many beats, 0 for a sudden change
+			long long rampTicks;	// how long those beats are
+		};
+
+		int initialTempo = 120;
+		std::vector<long long> measureTicks = { 0 };
+		std::vector<TempoChange> changes;	// in order of their measures
+		std::vector<TempoSegment> segments = { TempoSegment{ 0, 120, 0 } };
+
+		void count_measure_ticks(GPFile &song, int fromMeasure);
+		// adds the tempo changes of a measure in every track to the end of changes
+		void find_changes(GPFile &song, int measureIndex);
+		void build_segments();
+		// the segment playing at the tick, the first one for ticks before the song
+		const TempoSegment &segment_at_tick(long long tick) const;
+};
+
+#endif // !TEMPO_MAP_H
@@ -0,0 +1,122 @@
+#include <thread>
+#include <mutex>
+
+#include "thread_pool.hpp"
+
+// which worker the current thread is, -1 if it isn't one
+static thread_local int currentWorker = -1;
+static thread_local const ThreadPool *currentPool = nullptr;
+
+ThreadPool::ThreadPool(int threadCount) {
+	if (threadCount <= 0) {
+		threadCount = std::thread::hardware_concurrency();
+	}
+	if (threadCount <= 0) {
+		threadCount = 1;
+	}
+
+	for (int i = 0; i < threadCount; i++) {
+		this->queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (int i = 0; i < threadCount; i++) {
+		this->threads.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(this->stateMutex);
+		this->stopping = true;
+	}
+	this->workAvailable.notify_all();
+
+	for (std::thread &thread : this->threads) {
+		thread.join();
+	}
+}
+
+bool ThreadPool::on_worker_thread() {
+	return currentWorker >= 0;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	int queueIndex;
+	if (currentPool == this) {
+		queueIndex = currentWorker;
+	}
+	else {
+		queueIndex = this->nextQueue++ % this->queues.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->queues[queueIndex]->mutex);
+		this->queues[queueIndex]->tasks.push_back(std::move(task));
+	}
+
+	// counted under the state lock, so a worker can't miss it between checking and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(this->stateMutex);
+		this->queuedTasks++;
+		this->unfinishedTasks++;
+	}
+	this->workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(this->stateMutex);
+	this->allDone.wait(lock, [this] { return this->unfinishedTasks == 0; });
+}
+
+bool ThreadPool::take_task(int workerIndex, std::function<void()> &task) {
+	int queueCount = this->queues.size();
+
+	for (int i = 0; i < queueCount; i++) {
+		WorkQueue &queue = *this->queues[(workerIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty()) {
+			continue;
+		}
+
+		if (i == 0) {	// own queue, newest first
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {	// someone else's, oldest first
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		this->queuedTasks--;
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::worker_loop(int workerIndex) {
+	currentWorker = workerIndex;
+	currentPool = this;
+
+	std::function<void()> task;
+
+	while (true) {
+		if (take_task(workerIndex, task)) {
+			task();
+			task = nullptr;
+
+			std::lock_guard<std::mutex> lock(this->stateMutex);
+			if (--this->unfinishedTasks == 0) {
+				this->allDone.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->stateMutex);
+		this->workAvailable.wait(lock, [this] { return this->queuedTasks > 0 || this->stopping; });
+		if (this->stopping && this->queuedTasks == 0) {
+			return;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+// a fixed set of worker threads, each with its own task queue
+// a worker takes tasks from the back of its own queue, and when that's empty
+// it steals from the front of the other workers' queues
+class ThreadPool {
+	public:
+		// 0 threads means one per hardware thread
+		ThreadPool(int threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		int thread_count() const { return threads.size(); }
+		// whether the calling thread is a worker of any pool, work it does shouldn't start another pool
+		static bool on_worker_thread();
+
+		// tasks submitted from a worker go to that worker's queue, others are spread out over all queues
+		void submit(std::function<void()> task);
+
+		// blocks until every submitted task has finished
+		void wait();
+
+	private:
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::vector<std::thread> threads;
+
+		std::mutex stateMutex;
+		std::condition_variable workAvailable;
+		std::condition_variable allDone;
+		std::atomic<size_t> queuedTasks{0};	// waiting in a queue
+		size_t unfinishedTasks = 0;	// queued or running, guarded by stateMutex
+		bool stopping = false;
+
+		std::atomic<size_t> nextQueue{0};
+
+		bool take_task(int workerIndex, std::function<void()> &task);
+		void worker_loop(int workerIndex);
+};
+
+#endif // !THREAD_POOL_H
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "editing.hpp"
 #include <vector>
+#include <algorithm>
+#include <chrono>
 
 #ifdef _WIN32
 	#include <curses.h>
@@ -10,12 +12,35 @@
 #include "windows.hpp"
 #include "gpedit.hpp"
 #include "gp_file.hpp"
+#include "stacked_view.hpp"
+#include "perf_hud.hpp"
 
 WINDOW* songInfoWindow;
 WINDOW* tabDisplayWindow;
 WINDOW* beatInfoWindow;
 
+// how often the file is checked for changes while waiting for a key, in milliseconds
+static const int fileCheckInterval = 200;
+
+// the song is opened quietly, so what went wrong reading it goes on the bottom border of the song info instead of the terminal
+// measures are decoded while scrolling, so it can go wrong after the song info has been shown too
+static std::string shownReadError;
+
+static void printReadError() {
+	int line = getmaxy(songInfoWindow)-1;
+	mvwhline(songInfoWindow, line, 1, ACS_HLINE, getmaxx(songInfoWindow)-2);
+	if (!song.readError.empty()) {
+		mvwprintw(songInfoWindow, line, 1, "Error: %s", song.readError.c_str());
+	}
+	shownReadError = song.readError;
+}
+
 void displaySongInfo() {
+	// shown again when the song is read again
+	if (songInfoWindow != nullptr) {
+		delwin(songInfoWindow);
+	}
+	
 	// create window with height, width, yTop, xLeft
 	songInfoWindow = newwin(7, getmaxx(stdscr), 0, 0);
 	box(songInfoWindow, 0, 0);
@@ -37,22 +62,18 @@ void displaySongInfo() {
 	wattroff(songInfoWindow, A_BOLD);
 	
 	wmove(songInfoWindow, 2, 12);
-	wprintw(songInfoWindow, "%s", song.metadata.title.c_str());
+	wprintw(songInfoWindow, "%.*s", song.metadata.title.length(), song.metadata.title.data());
 	wmove(songInfoWindow, 3, 12);
-	wprintw(songInfoWindow, "%s", song.metadata.artist.c_str());
+	wprintw(songInfoWindow, "%.*s", song.metadata.artist.length(), song.metadata.artist.data());
 	wmove(songInfoWindow, 4, 12);
-	wprintw(songInfoWindow, "%s", song.metadata.instructions.c_str());
+	wprintw(songInfoWindow, "%.*s", song.metadata.instructions.length(), song.metadata.instructions.data());
+	printReadError();
 	
 	refresh();
 	wrefresh(songInfoWindow);
 }
 
 void selectTrack() {
-	std::string trackList[song.trackCount];
-	for (int i = 0; i < song.trackCount; i++) {
-		trackList[i] = song.trackHeaders[i].name;
-	}
-	
 	WINDOW* selectTrack = newwin(song.trackCount + 4, 15, getmaxy(songInfoWindow), 0);
 	box(selectTrack, 0, 0);
 	
@@ -66,16 +87,22 @@ void selectTrack() {
 	// allow reading non-character keypresses
 	keypad(selectTrack, true);
 	
+	mvwprintw(selectTrack, song.trackCount + 2, 1, "a: all tracks");
+	
 	while (true) {
 		for (int i = 0; i < song.trackCount; i++) {
 			if (i == trackIndex) {
 				wattron(selectTrack, A_REVERSE);
 			}
-			mvwprintw(selectTrack, i+2, 2, "%s", trackList[i].c_str());
+			const GPString &trackName = song.trackHeaders[i].name;
+			mvwprintw(selectTrack, i+2, 2, "%.*s", trackName.length(), trackName.data());
 			wattroff(selectTrack, A_REVERSE);
 		}
 		
-		keyboardInput = wgetch(selectTrack);
+		keyboardInput = waitForKey(selectTrack);
+		if (keyboardInput == ERR) {
+			break;
+		}
 		
 		switch (keyboardInput) {
 			case KEY_UP:
@@ -89,7 +116,7 @@ void selectTrack() {
 				}
 				break;
 		}
-		if (keyboardInput == 10 || keyboardInput == 27) {
+		if (keyboardInput == 10 || keyboardInput == 27 || keyboardInput == 'a') {
 			break;
 		}
 	}
@@ -98,6 +125,11 @@ void selectTrack() {
 	wrefresh(selectTrack);
 	delwin(selectTrack);
 	refresh();
+	
+	// the tracks may have changed, so the list is made again
+	if (keyboardInput == ERR) {
+		::selectTrack();
+	}
 }
 
 void initTabDisplay() {
@@ -108,7 +140,8 @@ void initTabDisplay() {
 	tabDisplayWindow = newwin(tabWindowHeight, getmaxx(stdscr), yTop, 0);
 	box(tabDisplayWindow, 0, 0);
 	wattron(tabDisplayWindow, A_REVERSE);
-	wprintw(tabDisplayWindow, "Track: %s", song.trackHeaders[trackIndex].name.c_str());
+	const GPString &trackName = song.trackHeaders[trackIndex].name;
+	wprintw(tabDisplayWindow, "Track: %.*s", trackName.length(), trackName.data());
 	wattroff(tabDisplayWindow, A_REVERSE);
 	
 	// create beat info window
@@ -123,17 +156,22 @@ void initTabDisplay() {
 	wrefresh(beatInfoWindow);
 }
 
-void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
-	Beat beat = song.measures[selectedBeat.measureIndex][trackIndex].beats[selectedBeat.beatIndex];
+void printBeatInfo(const DisplayedBeat &selectedBeat, const Measure &measure, int stringIndex) {
+	auto startTime = std::chrono::steady_clock::now();
+	const Beat &beat = measure.beats[selectedBeat.beatIndex];
 	int line = 0;
 	
-	wclear(beatInfoWindow);
+	// werase instead of wclear, so the whole screen isn't sent again on every keypress
+	werase(beatInfoWindow);
 	
 	mvwprintw(beatInfoWindow, line++, 1, "Measure: %d", selectedBeat.measureIndex+1);
 	mvwprintw(beatInfoWindow, line++, 1, "Beat: %d", selectedBeat.beatIndex+1);
+	
+	double seconds = tempoMap.tick_to_seconds(tempoMap.beat_tick(selectedBeat.measureIndex, measure, selectedBeat.beatIndex));
+	mvwprintw(beatInfoWindow, line++, 1, "Time: %d:%04.1f", (int)seconds / 60, seconds - (int)seconds / 60 * 60);
 	mvwprintw(beatInfoWindow, line++, 1, "Rest: %s", beat.isRest ? "Yes" : "No");
 	
-	std::string duration;
+	const char *duration = "";
 	switch (beat.duration) {
 		case gp_duration_whole:
 		duration = "1/1";
@@ -157,7 +195,7 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 		duration = "1/64";
 		break;
 	}
-	mvwprintw(beatInfoWindow, line++, 1, "Duration: %s%s", duration.c_str(), (beat.beatFlags & gp_beat_is_dotted) ? "." : "");
+	mvwprintw(beatInfoWindow, line++, 1, "Duration: %s%s", duration, (beat.beatFlags & gp_beat_is_dotted) ? "." : "");
 	if (beat.beatFlags & gp_beat_is_tuplet) {
 		mvwprintw(beatInfoWindow, line++, 1, "Tuplet: %d", beat.tupletDivision);
 	}
@@ -167,22 +205,22 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 	
 	
 	if (beat.beatFlags & gp_beat_has_chord) {
-		mvwprintw(beatInfoWindow, line++, 1, "Chord: %s", beat.chordDiagram.name.c_str());
+		mvwprintw(beatInfoWindow, line++, 1, "Chord: %.*s", beat.chordDiagram.name.length(), beat.chordDiagram.name.data());
 	}
 	if (beat.beatFlags & gp_beat_has_text) {
-		mvwprintw(beatInfoWindow, line++, 1, "Text: %s...", beat.text.substr(0,5).c_str());
+		mvwprintw(beatInfoWindow, line++, 1, "Text: %.*s...", std::min(beat.text.length(), 5), beat.text.data());
 	}
 	
 	
 	
 	if (beat.beatNotes.stringsPlayed & (0x40 >> stringIndex)) {	// check if string is played
-		Note note = beat.beatNotes.strings[stringIndex];
+		const Note &note = beat.beatNotes.strings[stringIndex];
 		
 		// next column
 		line = 0;
 		
 		if (note.noteFlags & gp_note_has_fret) {
-			std::string noteType;
+			const char *noteType = "";
 			switch (note.noteType) {
 				case gp_notetype_normal:
 					noteType = "normal";
@@ -194,7 +232,7 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 					noteType = "dead";
 					break;
 			}
-			mvwprintw(beatInfoWindow, line++, 16, "Note type: %s", noteType.c_str());
+			mvwprintw(beatInfoWindow, line++, 16, "Note type: %s", noteType);
 		}
 		if (note.noteFlags & gp_note_is_ghost) {
 			mvwprintw(beatInfoWindow, line++, 16, "Ghost note");
@@ -204,7 +242,7 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 			mvwprintw(beatInfoWindow, line++, 16, "Note effects:");
 			
 			if (note.noteEffectFlags & gp_notefx_bend) {
-				std::string bendType;
+				const char *bendType = "";
 				switch (note.noteBend.type) {
 					case gp_bendtype_none:
 					bendType = "NONE";
@@ -225,7 +263,7 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 					bendType = "pbr";
 					break;
 				}
-				mvwprintw(beatInfoWindow, line++, 16, "\tBend: %s", bendType.c_str());
+				mvwprintw(beatInfoWindow, line++, 16, "\tBend: %s", bendType);
 			}
 			if (note.noteEffectFlags & gp_notefx_hammer_pull) {
 				mvwprintw(beatInfoWindow, line++, 16, "\tHammer/Pull");
@@ -271,4 +309,64 @@ void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex) {
 	}
 	
 	wrefresh(beatInfoWindow);
+	editorTimings.beatInfo.add(millisecondsSince(startTime));
+}
+
+// asks on the top line of the screen whether the edits can be dropped for the new version of the file
+static bool confirmReload() {
+	WINDOW *promptWindow = newwin(1, getmaxx(stdscr), 0, 0);
+	wbkgd(promptWindow, A_REVERSE);
+	mvwprintw(promptWindow, 0, 1, "%s changed, reload it and lose your edits? (y/n)", songFilePath.c_str());
+	
+	int key = wgetch(promptWindow);
+	while (key != 'y' && key != 'n') {
+		key = wgetch(promptWindow);
+	}
+	delwin(promptWindow);
+	
+	// the song info and the overlay are all that's under it
+	touchwin(songInfoWindow);
+	wnoutrefresh(songInfoWindow);
+	doupdate();
+	drawPerfHud();
+	return key == 'y';
+}
+
+// reads the song again if the file has changed, and updates whatever shows it
+static bool showFileChanges() {
+	SongChanges changes;
+	if (!reloadChangedFile(changes, confirmReload)) {
+		return false;
+	}
+	
+	if (changes.everything) {
+		displaySongInfo();
+	}
+	updateTabView(changes);
+	updateStackedView(changes);
+	drawPerfHud();
+	return true;
+}
+
+int waitForKey(WINDOW *window) {
+	if (song.readError != shownReadError) {
+		printReadError();
+		wrefresh(songInfoWindow);
+	}
+	
+	wtimeout(window, fileCheckInterval);
+	int key = wgetch(window);
+	while ((key == ERR && !showFileChanges()) || key == perfHudKey) {
+		if (key == perfHudKey) {
+			togglePerfHud();
+		}
+		key = wgetch(window);
+	}
+	if (key != ERR) {
+		keyRead();
+	}
+	
+	// prompts read from the same window, and should wait for the whole line
+	wtimeout(window, -1);
+	return key;
 }
\ No newline at end of file
@@ -15,6 +15,11 @@ extern WINDOW* beatInfoWindow;
 void displaySongInfo();
 void selectTrack();
 void initTabDisplay();
-void printBeatInfo(DisplayedBeat selectedBeat, int stringIndex);
+// measure is the one the beat is in, the caller keeps it so it doesn't have to be decoded for every frame
+void printBeatInfo(const DisplayedBeat &selectedBeat, const Measure &measure, int stringIndex);
+// waits for a key in the window, and shows new versions of the file in the meantime
+// returns ERR if the song has been read again, before a key was pressed
+// the key that toggles the performance overlay is handled here, and never returned
+int waitForKey(WINDOW *window);
 
 #endif // !WINDOWS_H
\ No newline at end of file